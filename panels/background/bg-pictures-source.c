@@ -49,8 +49,25 @@ struct _BgPicturesSource
   GFileMonitor *cache_dir_monitor;
 
   GHashTable *known_items;
+
+  /* Pictures are loaded by a pool of worker threads, and
+   * added to the store in batches from the main thread */
+  GThreadPool *thread_pool;
+  GMutex loaded_pictures_lock;
+  GPtrArray *loaded_pictures;
+  guint loaded_pictures_idle_id;
 };
 
+typedef struct
+{
+  BgPicturesSource *source;
+  CcBackgroundItem *item;
+  GFile *file;
+  gint thumbnail_width;
+  gint thumbnail_height;
+  gboolean is_valid;
+} PictureTask;
+
 G_DEFINE_TYPE (BgPicturesSource, bg_pictures_source, BG_TYPE_SOURCE)
 
 const char * const content_types[] = {
@@ -70,7 +87,14 @@ const char * const screenshot_types[] = {
 
 static char *bg_pictures_source_get_unique_filename (const char *uri);
 
-static void picture_opened_for_read (GObject *source_object, GAsyncResult *res, gpointer user_data);
+static void
+picture_task_free (PictureTask *task)
+{
+  g_clear_object (&task->item);
+  g_clear_object (&task->file);
+  g_clear_object (&task->source);
+  g_free (task);
+}
 
 static void
 bg_pictures_source_dispose (GObject *object)
@@ -78,9 +102,15 @@ bg_pictures_source_dispose (GObject *object)
   BgPicturesSource *source = BG_PICTURES_SOURCE (object);
 
   if (source->cancellable)
+    g_cancellable_cancel (source->cancellable);
+
+  /* The queued tasks are cancelled, and don't need to be waited for:
+   * each holds a reference on the source, and is dropped by
+   * add_loaded_pictures_idle_cb() once handed back */
+  if (source->thread_pool)
     {
-      g_cancellable_cancel (source->cancellable);
-      g_clear_object (&source->cancellable);
+      g_thread_pool_free (source->thread_pool, FALSE, FALSE);
+      source->thread_pool = NULL;
     }
 
   g_clear_object (&source->grl_miner);
@@ -98,6 +128,10 @@ bg_pictures_source_finalize (GObject *object)
   g_clear_object (&bg_source->picture_dir_monitor);
   g_clear_object (&bg_source->cache_dir_monitor);
 
+  g_clear_pointer (&bg_source->loaded_pictures, g_ptr_array_unref);
+  g_mutex_clear (&bg_source->loaded_pictures_lock);
+  g_clear_object (&bg_source->cancellable);
+
   G_OBJECT_CLASS (bg_pictures_source_parent_class)->finalize (object);
 }
 
@@ -110,55 +144,226 @@ bg_pictures_source_class_init (BgPicturesSourceClass *klass)
   object_class->finalize = bg_pictures_source_finalize;
 }
 
-static void
-remove_placeholder (BgPicturesSource *bg_source,
-                    CcBackgroundItem *item)
+static guint
+read_uint16 (const guchar *data,
+             gboolean      big_endian)
 {
-  GListStore *store;
+  return big_endian ? (data[0] << 8 | data[1]) : (data[1] << 8 | data[0]);
+}
+
+static guint32
+read_uint32 (const guchar *data,
+             gboolean      big_endian)
+{
+  return big_endian ?
+    ((guint32) data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3]) :
+    ((guint32) data[3] << 24 | data[2] << 16 | data[1] << 8 | data[0]);
+}
+
+/* Looks for the Orientation tag in the first IFD of EXIF data */
+static gint
+get_tiff_orientation (const guchar *tiff,
+                      gsize         len)
+{
+  gboolean big_endian;
+  guint32 ifd_offset;
+  guint n_entries;
   guint i;
 
-  store = bg_source_get_liststore (BG_SOURCE (bg_source));
+  if (len < 8)
+    return 1;
 
-  for (i = 0; i < g_list_model_get_n_items (G_LIST_MODEL (store)); i++)
+  if (tiff[0] == 'M' && tiff[1] == 'M')
+    big_endian = TRUE;
+  else if (tiff[0] == 'I' && tiff[1] == 'I')
+    big_endian = FALSE;
+  else
+    return 1;
+
+  ifd_offset = read_uint32 (tiff + 4, big_endian);
+  if (ifd_offset > len - 2)
+    return 1;
+
+  n_entries = read_uint16 (tiff + ifd_offset, big_endian);
+  for (i = 0; i < n_entries; i++)
     {
-      g_autoptr(CcBackgroundItem) item_n = NULL;
+      const guchar *entry = tiff + ifd_offset + 2 + i * 12;
+      guint orientation;
+
+      if (entry + 12 > tiff + len)
+        break;
+
+      if (read_uint16 (entry, big_endian) != 0x0112)
+        continue;
+
+      orientation = read_uint16 (entry + 8, big_endian);
+      return (orientation >= 1 && orientation <= 8) ? orientation : 1;
+    }
+
+  return 1;
+}
+
+/* Reads the EXIF orientation from the header of JPEG files, so that
+ * pictures are decoded at the right size the first time. Returns 1,
+ * the default orientation, for anything else. */
+static gint
+get_exif_orientation (const guchar *data,
+                      gsize         len)
+{
+  gsize pos = 2;
+
+  if (len < 4 || data[0] != 0xFF || data[1] != 0xD8)
+    return 1;
+
+  while (pos + 4 <= len)
+    {
+      guint marker;
+      gsize segment_len;
 
-      item_n = g_list_model_get_item (G_LIST_MODEL (store), i);
+      if (data[pos] != 0xFF)
+        return 1;
 
-      if (item_n == item)
+      /* The metadata comes before the start of scan */
+      marker = data[pos + 1];
+      if (marker == 0xD9 || marker == 0xDA)
+        return 1;
+
+      segment_len = data[pos + 2] << 8 | data[pos + 3];
+      if (segment_len < 2)
+        return 1;
+
+      if (marker == 0xE1 &&
+          segment_len >= 8 &&
+          pos + 2 + segment_len <= len &&
+          memcmp (data + pos + 4, "Exif\0\0", 6) == 0)
         {
-          g_list_store_remove (store, i);
-          break;
+          return get_tiff_orientation (data + pos + 10, segment_len - 8);
         }
+
+      pos += 2 + segment_len;
     }
+
+  return 1;
+}
+
+#define PICTURE_HEADER_SIZE (64 * 1024)
+
+static GdkPixbuf *
+load_picture (PictureTask   *task,
+              GCancellable  *cancellable,
+              GError       **error)
+{
+  g_autoptr(GFileInputStream) stream = NULL;
+  g_autofree guchar *header = NULL;
+  gsize header_len = 0;
+  gint orientation;
+  gint width, height;
+
+  stream = g_file_read (task->file, cancellable, error);
+  if (stream == NULL)
+    return NULL;
+
+  header = g_malloc (PICTURE_HEADER_SIZE);
+  if (!g_input_stream_read_all (G_INPUT_STREAM (stream), header, PICTURE_HEADER_SIZE,
+                                &header_len, cancellable, error))
+    return NULL;
+
+  /* Decode from the start of the file, reopening it if it can't be rewound */
+  if (!g_seekable_can_seek (G_SEEKABLE (stream)) ||
+      !g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_SET, cancellable, NULL))
+    {
+      g_clear_object (&stream);
+      stream = g_file_read (task->file, cancellable, error);
+      if (stream == NULL)
+        return NULL;
+    }
+
+  /* The width and height are swapped for EXIF orientations 5, 6, 7 and 8 */
+  orientation = get_exif_orientation (header, header_len);
+  if (orientation >= 5)
+    {
+      width = task->thumbnail_height;
+      height = task->thumbnail_width;
+    }
+  else
+    {
+      width = task->thumbnail_width;
+      height = task->thumbnail_height;
+    }
+
+  return gdk_pixbuf_new_from_stream_at_scale (G_INPUT_STREAM (stream),
+                                              width, height,
+                                              TRUE,
+                                              cancellable,
+                                              error);
 }
 
 static gboolean
-picture_needs_rotation (GdkPixbuf *pixbuf)
+add_loaded_pictures_idle_cb (gpointer user_data);
+
+static void
+load_picture_thread_func (gpointer data,
+                          gpointer user_data)
 {
-  const gchar *str;
+  PictureTask *task = data;
+  BgPicturesSource *bg_source = task->source;
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *uri = NULL;
+  const char *software;
 
-  str = gdk_pixbuf_get_option (pixbuf, "orientation");
-  if (str == NULL)
-    return FALSE;
+  /* Tasks are always handed back, so that the items are
+   * only released from the main thread */
+  if (g_cancellable_is_cancelled (bg_source->cancellable))
+    goto out;
 
-  if (*str == '5' || *str == '6' || *str == '7' || *str == '8')
-    return TRUE;
+  pixbuf = load_picture (task, bg_source->cancellable, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    goto out;
+
+  uri = g_file_get_uri (task->file);
+  if (pixbuf == NULL)
+    {
+      g_warning ("Failed to load picture '%s': %s", uri, error->message);
+    }
+  else
+    {
+      /* Ignore screenshots */
+      software = gdk_pixbuf_get_option (pixbuf, "tEXt::Software");
+      if (software != NULL &&
+          g_str_equal (software, "gnome-screenshot"))
+        g_debug ("Ignored URL '%s' as it's a screenshot from gnome-screenshot", uri);
+      else
+        task->is_valid = TRUE;
+    }
 
-  return FALSE;
+ out:
+  g_mutex_lock (&bg_source->loaded_pictures_lock);
+  g_ptr_array_add (bg_source->loaded_pictures, task);
+  if (bg_source->loaded_pictures_idle_id == 0)
+    bg_source->loaded_pictures_idle_id = g_idle_add (add_loaded_pictures_idle_cb, bg_source);
+  g_mutex_unlock (&bg_source->loaded_pictures_lock);
 }
 
-static GdkPixbuf *
-swap_rotated_pixbuf (GdkPixbuf *pixbuf)
+static void
+queue_picture (BgPicturesSource *bg_source,
+               CcBackgroundItem *item,
+               GFile            *file)
 {
-  GdkPixbuf *tmp_pixbuf;
+  PictureTask *task;
+
+  /* Disposed */
+  if (bg_source->thread_pool == NULL)
+    return;
 
-  tmp_pixbuf = gdk_pixbuf_apply_embedded_orientation (pixbuf);
-  if (tmp_pixbuf == NULL)
-    return pixbuf;
+  task = g_new0 (PictureTask, 1);
+  task->source = g_object_ref (bg_source);
+  task->item = g_object_ref (item);
+  task->file = g_object_ref (file);
+  task->thumbnail_width = bg_source_get_thumbnail_width (BG_SOURCE (bg_source));
+  task->thumbnail_height = bg_source_get_thumbnail_height (BG_SOURCE (bg_source));
 
-  g_object_unref (pixbuf);
-  return tmp_pixbuf;
+  g_thread_pool_push (bg_source->thread_pool, task, NULL);
 }
 
 static int
@@ -170,152 +375,137 @@ sort_func (gconstpointer a,
   CcBackgroundItem *item_b;
   guint64 modified_a;
   guint64 modified_b;
-  int retval;
 
   item_a = (CcBackgroundItem *) a;
   item_b = (CcBackgroundItem *) b;
   modified_a = cc_background_item_get_modified (item_a);
   modified_b = cc_background_item_get_modified (item_b);
 
-  retval = modified_b - modified_a;
+  if (modified_a > modified_b)
+    return -1;
+  else if (modified_a < modified_b)
+    return 1;
 
-  return retval;
+  return 0;
 }
 
-static void
-picture_scaled (GObject *source_object,
-                GAsyncResult *res,
-                gpointer user_data)
+static int
+sort_items_func (gconstpointer a,
+                 gconstpointer b)
 {
-  BgPicturesSource *bg_source;
-  CcBackgroundItem *item;
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GdkPixbuf) pixbuf = NULL;
-  const char *software;
-  const char *uri;
-  GListStore *store;
-  cairo_surface_t *surface = NULL;
-  int scale_factor;
-  gboolean rotation_applied;
+  return sort_func (*(CcBackgroundItem **) a, *(CcBackgroundItem **) b, NULL);
+}
 
-  item = g_object_get_data (source_object, "item");
-  pixbuf = gdk_pixbuf_new_from_stream_finish (res, &error);
-  if (pixbuf == NULL)
+/* Returns the position after the items of @store, starting at @start,
+ * that @item doesn't sort before */
+static guint
+find_insert_position (GListStore       *store,
+                      CcBackgroundItem *item,
+                      guint             start)
+{
+  guint low = start;
+  guint high = g_list_model_get_n_items (G_LIST_MODEL (store));
+
+  while (low < high)
     {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("Failed to load image: %s", error->message);
-          remove_placeholder (BG_PICTURES_SOURCE (user_data), item);
-        }
+      g_autoptr(CcBackgroundItem) item_n = NULL;
+      guint mid = low + (high - low) / 2;
 
-      return;
+      item_n = g_list_model_get_item (G_LIST_MODEL (store), mid);
+      if (sort_func (item, item_n, NULL) < 0)
+        high = mid;
+      else
+        low = mid + 1;
     }
 
-  /* since we were not cancelled, we can now cast user_data
-   * back to BgPicturesSource.
-   */
-  bg_source = BG_PICTURES_SOURCE (user_data);
-  store = bg_source_get_liststore (BG_SOURCE (bg_source));
-  uri = cc_background_item_get_uri (item);
-  if (uri == NULL)
-    uri = cc_background_item_get_source_url (item);
-
-  /* Ignore screenshots */
-  software = gdk_pixbuf_get_option (pixbuf, "tEXt::Software");
-  if (software != NULL &&
-      g_str_equal (software, "gnome-screenshot"))
-    {
-      g_debug ("Ignored URL '%s' as it's a screenshot from gnome-screenshot", uri);
-      remove_placeholder (BG_PICTURES_SOURCE (user_data), item);
-      return;
-    }
+  return low;
+}
 
-  /* Process embedded orientation */
-  rotation_applied = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "rotation-applied"));
+/* Inserts the sorted @items into the store, with a single
+ * splice for each run of items going to the same place */
+static void
+insert_items_sorted (BgPicturesSource *bg_source,
+                     GPtrArray        *items)
+{
+  GListStore *store;
+  guint position = 0;
+  guint i = 0;
+
+  store = bg_source_get_liststore (BG_SOURCE (bg_source));
 
-  if (!rotation_applied && picture_needs_rotation (pixbuf))
+  while (i < items->len)
     {
-      /* the width and height of pixbuf we requested are wrong for EXIF
-       * orientations 5, 6, 7 and 8. the file has to be reloaded. */
-      g_autoptr(GFile) file = NULL;
+      guint n_items;
+      guint j;
 
-      file = g_file_new_for_uri (uri);
-      g_object_set_data (G_OBJECT (item), "needs-rotation", GINT_TO_POINTER (TRUE));
-      g_object_set_data_full (G_OBJECT (file), "item", g_object_ref (item), g_object_unref);
-      g_file_read_async (G_FILE (file), G_PRIORITY_DEFAULT,
-                         bg_source->cancellable,
-                         picture_opened_for_read, bg_source);
-      return;
-    }
+      position = find_insert_position (store, g_ptr_array_index (items, i), position);
+      n_items = g_list_model_get_n_items (G_LIST_MODEL (store));
 
-  pixbuf = swap_rotated_pixbuf (pixbuf);
+      for (j = i + 1; j < items->len; j++)
+        {
+          g_autoptr(CcBackgroundItem) next = NULL;
 
-  scale_factor = bg_source_get_scale_factor (BG_SOURCE (bg_source));
-  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
-  cc_background_item_load (item, NULL);
+          if (position == n_items)
+            continue;
 
-  /* insert the item into the liststore */
-  g_list_store_insert_sorted (store, item, sort_func, bg_source);
+          next = g_list_model_get_item (G_LIST_MODEL (store), position);
+          if (sort_func (g_ptr_array_index (items, j), next, NULL) >= 0)
+            break;
+        }
 
-  g_hash_table_insert (bg_source->known_items,
-                       bg_pictures_source_get_unique_filename (uri),
-                       GINT_TO_POINTER (TRUE));
+      g_list_store_splice (store, position, 0, &items->pdata[i], j - i);
 
-  g_clear_pointer (&surface, cairo_surface_destroy);
+      position += j - i;
+      i = j;
+    }
 }
 
-static void
-picture_opened_for_read (GObject *source_object,
-                         GAsyncResult *res,
-                         gpointer user_data)
+static gboolean
+add_loaded_pictures_idle_cb (gpointer user_data)
 {
-  BgPicturesSource *bg_source;
-  CcBackgroundItem *item;
-  g_autoptr(GFileInputStream) stream = NULL;
-  g_autoptr(GError) error = NULL;
-  gint thumbnail_height;
-  gint thumbnail_width;
-  gboolean needs_rotation;
+  /* Released last, as the tasks hold references on the source */
+  g_autoptr(BgPicturesSource) bg_source = g_object_ref (BG_PICTURES_SOURCE (user_data));
+  g_autoptr(GPtrArray) tasks = NULL;
+  g_autoptr(GPtrArray) items = NULL;
+  guint i;
 
-  item = g_object_get_data (source_object, "item");
-  stream = g_file_read_finish (G_FILE (source_object), res, &error);
-  if (stream == NULL)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_autofree gchar *filename = g_file_get_path (G_FILE (source_object));
-          g_warning ("Failed to load picture '%s': %s", filename, error->message);
-          remove_placeholder (BG_PICTURES_SOURCE (user_data), item);
-        }
+  g_mutex_lock (&bg_source->loaded_pictures_lock);
+  tasks = g_steal_pointer (&bg_source->loaded_pictures);
+  bg_source->loaded_pictures = g_ptr_array_new_with_free_func ((GDestroyNotify) picture_task_free);
+  bg_source->loaded_pictures_idle_id = 0;
+  g_mutex_unlock (&bg_source->loaded_pictures_lock);
 
-      return;
-    }
+  /* Disposed, the tasks which were still running are only released */
+  if (bg_source->thread_pool == NULL)
+    return G_SOURCE_REMOVE;
 
-  /* since we were not cancelled, we can now cast user_data
-   * back to BgPicturesSource.
-   */
-  bg_source = BG_PICTURES_SOURCE (user_data);
+  items = g_ptr_array_new_full (tasks->len, g_object_unref);
 
-  needs_rotation = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "needs-rotation"));
-  if (needs_rotation)
-    {
-      /* swap width and height for EXIF orientations that need it */
-      thumbnail_width = bg_source_get_thumbnail_height (BG_SOURCE (bg_source));
-      thumbnail_height = bg_source_get_thumbnail_width (BG_SOURCE (bg_source));
-      g_object_set_data (G_OBJECT (item), "rotation-applied", GINT_TO_POINTER (TRUE));
-    }
-  else
+  for (i = 0; i < tasks->len; i++)
     {
-      thumbnail_width = bg_source_get_thumbnail_width (BG_SOURCE (bg_source));
-      thumbnail_height = bg_source_get_thumbnail_height (BG_SOURCE (bg_source));
+      PictureTask *task = g_ptr_array_index (tasks, i);
+      const char *uri;
+
+      if (!task->is_valid)
+        continue;
+
+      uri = cc_background_item_get_uri (task->item);
+      if (uri == NULL)
+        uri = cc_background_item_get_source_url (task->item);
+
+      cc_background_item_load (task->item, NULL);
+
+      g_hash_table_insert (bg_source->known_items,
+                           bg_pictures_source_get_unique_filename (uri),
+                           GINT_TO_POINTER (TRUE));
+
+      g_ptr_array_add (items, g_object_ref (task->item));
     }
 
-  g_object_set_data_full (G_OBJECT (stream), "item", g_object_ref (item), g_object_unref);
-  gdk_pixbuf_new_from_stream_at_scale_async (G_INPUT_STREAM (stream),
-                                             thumbnail_width, thumbnail_height,
-                                             TRUE,
-                                             bg_source->cancellable,
-                                             picture_scaled, bg_source);
+  g_ptr_array_sort (items, sort_items_func);
+  insert_items_sorted (bg_source, items);
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
@@ -347,12 +537,7 @@ picture_copied_for_read (GObject *source_object,
 
   native_file = g_object_get_data (G_OBJECT (thumbnail_file), "native-file");
   item = g_object_get_data (G_OBJECT (thumbnail_file), "item");
-  g_object_set_data_full (G_OBJECT (native_file), "item", g_object_ref (item), g_object_unref);
-  g_file_read_async (native_file,
-                     G_PRIORITY_DEFAULT,
-                     bg_source->cancellable,
-                     picture_opened_for_read,
-                     bg_source);
+  queue_picture (bg_source, item, native_file);
 }
 
 static gboolean
@@ -435,10 +620,7 @@ add_single_file (BgPicturesSource     *bg_source,
   media = g_object_get_data (G_OBJECT (file), "grl-media");
   if (media == NULL)
     {
-      g_object_set_data_full (G_OBJECT (file), "item", g_object_ref (item), g_object_unref);
-      g_file_read_async (file, G_PRIORITY_DEFAULT,
-                         bg_source->cancellable,
-                         picture_opened_for_read, bg_source);
+      queue_picture (bg_source, item, file);
     }
   else
     {
@@ -825,6 +1007,13 @@ bg_pictures_source_init (BgPicturesSource *self)
   g_autofree gchar *cache_path = NULL;
 
   self->cancellable = g_cancellable_new ();
+  self->thread_pool = g_thread_pool_new (load_picture_thread_func,
+                                         NULL,
+                                         g_get_num_processors (),
+                                         FALSE,
+                                         NULL);
+  g_mutex_init (&self->loaded_pictures_lock);
+  self->loaded_pictures = g_ptr_array_new_with_free_func ((GDestroyNotify) picture_task_free);
   self->known_items = g_hash_table_new_full (g_str_hash,
 					     g_str_equal,
 					     (GDestroyNotify) g_free,
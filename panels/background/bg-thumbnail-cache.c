@@ -0,0 +1,527 @@
+/* bg-thumbnail-cache.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <gdk/gdk.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+
+#include "bg-pictures-source.h"
+#include "bg-thumbnail-cache.h"
+
+/*
+ * Thumbnails of background items are shared by all the sources, so that
+ * they survive the items being recreated when a source reloads. The most
+ * recently used surfaces are kept in memory, and the thumbnails of files
+ * are also written to disk, next to the cached pictures.
+ *
+ * The in-memory cache is only accessed from the main thread, and threads
+ * only read and write the thumbnail files.
+ */
+
+#define MAX_CACHED_THUMBNAILS 512
+
+#define MAX_DISK_CACHE_SIZE (64 * 1024 * 1024)
+#define MAX_DISK_CACHE_AGE (30 * G_TIME_SPAN_DAY)
+
+typedef struct
+{
+  gchar           *key;
+  cairo_surface_t *surface;
+} CacheEntry;
+
+typedef struct
+{
+  CcBackgroundItem             *item;
+  GnomeDesktopThumbnailFactory *factory;
+  gchar                        *key;
+  gchar                        *filename;
+  gchar                        *thumbnail_path;
+  gint                          width;
+  gint                          height;
+  gint                          scale_factor;
+  gint                          frame;
+} LoadData;
+
+typedef struct
+{
+  GdkPixbuf *pixbuf;
+  gchar     *thumbnail_path;
+} SaveData;
+
+typedef struct
+{
+  gchar  *path;
+  time_t  mtime;
+  goffset size;
+} ThumbnailFile;
+
+/* key → GList link in the LRU queue */
+static GHashTable *cache_entries = NULL;
+static GQueue cache_lru = G_QUEUE_INIT;
+
+/* Loads waiting for their thumbnail to be created in the main loop */
+static GQueue pending_loads = G_QUEUE_INIT;
+static guint create_thumbnail_idle_id = 0;
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+  g_free (entry->key);
+  cairo_surface_destroy (entry->surface);
+  g_free (entry);
+}
+
+static void
+load_data_free (LoadData *data)
+{
+  g_clear_object (&data->item);
+  g_clear_object (&data->factory);
+  g_free (data->key);
+  g_free (data->filename);
+  g_free (data->thumbnail_path);
+  g_free (data);
+}
+
+static void
+save_data_free (SaveData *data)
+{
+  g_object_unref (data->pixbuf);
+  g_free (data->thumbnail_path);
+  g_free (data);
+}
+
+static gchar *
+get_cache_key (CcBackgroundItem *item,
+               gint              width,
+               gint              height,
+               gint              scale_factor,
+               gint              frame)
+{
+  const gchar *uri;
+
+  uri = cc_background_item_get_uri (item);
+
+  return g_strdup_printf ("%s\x1f%s\x1f%s\x1f%d\x1f%d\x1f%" G_GUINT64_FORMAT "\x1f%d\x1f%d\x1f%d\x1f%d",
+                          uri != NULL ? uri : "",
+                          cc_background_item_get_pcolor (item) ? cc_background_item_get_pcolor (item) : "",
+                          cc_background_item_get_scolor (item) ? cc_background_item_get_scolor (item) : "",
+                          cc_background_item_get_shading (item),
+                          cc_background_item_get_placement (item),
+                          cc_background_item_get_modified (item),
+                          width,
+                          height,
+                          scale_factor,
+                          frame);
+}
+
+static gchar *
+get_thumbnail_path (const gchar *key)
+{
+  g_autofree gchar *cache_path = NULL;
+  g_autofree gchar *basename = NULL;
+  g_autofree gchar *checksum = NULL;
+
+  cache_path = bg_pictures_source_get_cache_path ();
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key, -1);
+  basename = g_strconcat (checksum, ".png", NULL);
+
+  return g_build_filename (cache_path, "thumbnails", basename, NULL);
+}
+
+static void
+cache_insert (gchar           *key,
+              cairo_surface_t *surface)
+{
+  CacheEntry *entry;
+  GList *link;
+
+  if (cache_entries == NULL)
+    cache_entries = g_hash_table_new (g_str_hash, g_str_equal);
+
+  link = g_hash_table_lookup (cache_entries, key);
+  if (link != NULL)
+    {
+      entry = link->data;
+      cairo_surface_destroy (entry->surface);
+      entry->surface = cairo_surface_reference (surface);
+      g_free (key);
+
+      g_queue_unlink (&cache_lru, link);
+      g_queue_push_head_link (&cache_lru, link);
+      return;
+    }
+
+  entry = g_new0 (CacheEntry, 1);
+  entry->key = key;
+  entry->surface = cairo_surface_reference (surface);
+
+  g_queue_push_head (&cache_lru, entry);
+  g_hash_table_insert (cache_entries, entry->key, cache_lru.head);
+
+  if (cache_lru.length > MAX_CACHED_THUMBNAILS)
+    {
+      entry = g_queue_pop_tail (&cache_lru);
+      g_hash_table_remove (cache_entries, entry->key);
+      cache_entry_free (entry);
+    }
+}
+
+/**
+ * bg_thumbnail_cache_lookup:
+ *
+ * Returns: (transfer full) (nullable): the cached thumbnail of @item
+ * at the given size, or %NULL if it still has to be loaded.
+ */
+cairo_surface_t *
+bg_thumbnail_cache_lookup (CcBackgroundItem *item,
+                           gint              width,
+                           gint              height,
+                           gint              scale_factor,
+                           gint              frame)
+{
+  g_autofree gchar *key = NULL;
+  CacheEntry *entry;
+  GList *link;
+
+  g_return_val_if_fail (CC_IS_BACKGROUND_ITEM (item), NULL);
+
+  if (cache_entries == NULL)
+    return NULL;
+
+  key = get_cache_key (item, width, height, scale_factor, frame);
+  link = g_hash_table_lookup (cache_entries, key);
+  if (link == NULL)
+    return NULL;
+
+  g_queue_unlink (&cache_lru, link);
+  g_queue_push_head_link (&cache_lru, link);
+
+  entry = link->data;
+  return cairo_surface_reference (entry->surface);
+}
+
+/* The thumbnail on disk is only used if it is newer than the file. Using
+ * it bumps its modification time, which the pruning takes as last use. */
+static GdkPixbuf *
+load_thumbnail_from_disk (LoadData *data)
+{
+  GdkPixbuf *pixbuf;
+  GStatBuf thumbnail_buf;
+  GStatBuf file_buf;
+
+  if (g_stat (data->thumbnail_path, &thumbnail_buf) != 0 ||
+      g_stat (data->filename, &file_buf) != 0 ||
+      thumbnail_buf.st_mtime < file_buf.st_mtime)
+    return NULL;
+
+  pixbuf = gdk_pixbuf_new_from_file (data->thumbnail_path, NULL);
+  if (pixbuf != NULL)
+    g_utime (data->thumbnail_path, NULL);
+
+  return pixbuf;
+}
+
+static gint
+compare_thumbnail_files (gconstpointer a,
+                         gconstpointer b)
+{
+  const ThumbnailFile *file_a = a;
+  const ThumbnailFile *file_b = b;
+
+  /* Most recently used first */
+  if (file_a->mtime != file_b->mtime)
+    return file_a->mtime < file_b->mtime ? 1 : -1;
+
+  return 0;
+}
+
+/* Removes the thumbnails that weren't used for MAX_DISK_CACHE_AGE, then
+ * the least recently used ones until they fit in MAX_DISK_CACHE_SIZE */
+static void
+prune_thumbnails (const gchar *dir_path)
+{
+  g_autoptr(GArray) files = NULL;
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+  gint64 now;
+  goffset total_size = 0;
+  guint i;
+
+  dir = g_dir_open (dir_path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  files = g_array_new (FALSE, FALSE, sizeof (ThumbnailFile));
+  now = g_get_real_time () / G_USEC_PER_SEC;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *path = NULL;
+      ThumbnailFile file;
+      GStatBuf buf;
+
+      if (!g_str_has_suffix (name, ".png"))
+        continue;
+
+      path = g_build_filename (dir_path, name, NULL);
+      if (g_lstat (path, &buf) != 0 || !S_ISREG (buf.st_mode))
+        continue;
+
+      if ((now - buf.st_mtime) * G_USEC_PER_SEC > MAX_DISK_CACHE_AGE)
+        {
+          g_unlink (path);
+          continue;
+        }
+
+      file.path = g_steal_pointer (&path);
+      file.mtime = buf.st_mtime;
+      file.size = buf.st_size;
+      g_array_append_val (files, file);
+    }
+
+  g_array_sort (files, compare_thumbnail_files);
+
+  for (i = 0; i < files->len; i++)
+    {
+      ThumbnailFile *file = &g_array_index (files, ThumbnailFile, i);
+
+      total_size += file->size;
+      if (total_size > MAX_DISK_CACHE_SIZE)
+        g_unlink (file->path);
+
+      g_free (file->path);
+    }
+}
+
+static void
+save_thread_func (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  static gint pruned = FALSE;
+  SaveData *data = task_data;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *buffer = NULL;
+  g_autofree gchar *dir = NULL;
+  gsize buffer_size;
+
+  dir = g_path_get_dirname (data->thumbnail_path);
+
+  /* Once per run is enough to keep the directory bounded */
+  if (g_atomic_int_compare_and_exchange (&pruned, FALSE, TRUE))
+    prune_thumbnails (dir);
+
+  if (!gdk_pixbuf_save_to_buffer (data->pixbuf, &buffer, &buffer_size, "png", &error, NULL))
+    {
+      g_debug ("Failed to encode thumbnail: %s", error->message);
+      return;
+    }
+
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  if (!g_file_set_contents (data->thumbnail_path, buffer, buffer_size, &error))
+    g_debug ("Failed to write thumbnail '%s': %s", data->thumbnail_path, error->message);
+}
+
+static void
+save_thumbnail_to_disk (LoadData  *load_data,
+                        GdkPixbuf *pixbuf)
+{
+  g_autoptr(GTask) task = NULL;
+  SaveData *data;
+
+  data = g_new0 (SaveData, 1);
+  data->pixbuf = g_object_ref (pixbuf);
+  data->thumbnail_path = g_strdup (load_data->thumbnail_path);
+
+  task = g_task_new (NULL, NULL, NULL, NULL);
+  g_task_set_task_data (task, data, (GDestroyNotify) save_data_free);
+  g_task_run_in_thread (task, save_thread_func);
+}
+
+/* GnomeBG and GDK may only be used from the main thread, so the thumbnails
+ * which aren't on disk are created there, one per idle iteration */
+static gboolean
+create_thumbnail_idle_cb (gpointer user_data)
+{
+  g_autoptr(GTask) task = g_queue_pop_head (&pending_loads);
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+  LoadData *data;
+
+  if (!g_task_return_error_if_cancelled (task))
+    {
+      data = g_task_get_task_data (task);
+      pixbuf = cc_background_item_get_frame_thumbnail (data->item,
+                                                       data->factory,
+                                                       data->width,
+                                                       data->height,
+                                                       data->scale_factor,
+                                                       data->frame,
+                                                       FALSE);
+
+      if (pixbuf == NULL)
+        {
+          g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                                   "Could not create the thumbnail of '%s'",
+                                   cc_background_item_get_uri (data->item));
+        }
+      else
+        {
+          if (data->filename != NULL)
+            save_thumbnail_to_disk (data, pixbuf);
+
+          g_task_return_pointer (task, g_steal_pointer (&pixbuf), g_object_unref);
+        }
+    }
+
+  if (g_queue_is_empty (&pending_loads))
+    {
+      create_thumbnail_idle_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+create_thumbnail (GTask *task)
+{
+  g_queue_push_tail (&pending_loads, g_object_ref (task));
+
+  if (create_thumbnail_idle_id == 0)
+    create_thumbnail_idle_id = g_idle_add_full (G_PRIORITY_LOW, create_thumbnail_idle_cb, NULL, NULL);
+}
+
+static void
+read_thread_func (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  LoadData *data = task_data;
+
+  g_task_return_pointer (task, load_thumbnail_from_disk (data), g_object_unref);
+}
+
+static void
+on_thumbnail_read_cb (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  g_autoptr(GTask) task = G_TASK (user_data);
+  GdkPixbuf *pixbuf;
+
+  pixbuf = g_task_propagate_pointer (G_TASK (result), NULL);
+  if (pixbuf != NULL)
+    {
+      g_task_return_pointer (task, pixbuf, g_object_unref);
+      return;
+    }
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  create_thumbnail (task);
+}
+
+/**
+ * bg_thumbnail_cache_load_async:
+ *
+ * Reads the thumbnail of @item from disk in a thread, or creates it in
+ * the main loop, and adds it to the cache once
+ * bg_thumbnail_cache_load_finish() is called.
+ */
+void
+bg_thumbnail_cache_load_async (CcBackgroundItem             *item,
+                               GnomeDesktopThumbnailFactory *factory,
+                               gint                          width,
+                               gint                          height,
+                               gint                          scale_factor,
+                               gint                          frame,
+                               GCancellable                 *cancellable,
+                               GAsyncReadyCallback           callback,
+                               gpointer                      user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  LoadData *data;
+  const gchar *uri;
+
+  g_return_if_fail (CC_IS_BACKGROUND_ITEM (item));
+
+  data = g_new0 (LoadData, 1);
+  data->item = g_object_ref (item);
+  data->factory = g_object_ref (factory);
+  data->key = get_cache_key (item, width, height, scale_factor, frame);
+  data->width = width;
+  data->height = height;
+  data->scale_factor = scale_factor;
+  data->frame = frame;
+
+  uri = cc_background_item_get_uri (item);
+  if (uri != NULL)
+    data->filename = g_filename_from_uri (uri, NULL, NULL);
+  if (data->filename != NULL)
+    data->thumbnail_path = get_thumbnail_path (data->key);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, bg_thumbnail_cache_load_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) load_data_free);
+
+  if (data->filename != NULL)
+    {
+      g_autoptr(GTask) read_task = NULL;
+
+      /* The data is owned by @task, which outlives the read */
+      read_task = g_task_new (NULL, cancellable, on_thumbnail_read_cb, g_object_ref (task));
+      g_task_set_task_data (read_task, data, NULL);
+      g_task_run_in_thread (read_task, read_thread_func);
+    }
+  else
+    {
+      create_thumbnail (task);
+    }
+}
+
+/**
+ * bg_thumbnail_cache_load_finish:
+ *
+ * Returns: (transfer full): the thumbnail, or %NULL on error
+ */
+cairo_surface_t *
+bg_thumbnail_cache_load_finish (GAsyncResult  *result,
+                                GError       **error)
+{
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+  cairo_surface_t *surface;
+  LoadData *data;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == bg_thumbnail_cache_load_async, NULL);
+
+  pixbuf = g_task_propagate_pointer (G_TASK (result), error);
+  if (pixbuf == NULL)
+    return NULL;
+
+  data = g_task_get_task_data (G_TASK (result));
+  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, data->scale_factor, NULL);
+  cache_insert (g_strdup (data->key), surface);
+
+  return surface;
+}
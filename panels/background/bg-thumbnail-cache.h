@@ -0,0 +1,47 @@
+/* bg-thumbnail-cache.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <cairo.h>
+#include <libgnome-desktop/gnome-desktop-thumbnail.h>
+
+#include "cc-background-item.h"
+
+G_BEGIN_DECLS
+
+cairo_surface_t *bg_thumbnail_cache_lookup      (CcBackgroundItem              *item,
+                                                 gint                           width,
+                                                 gint                           height,
+                                                 gint                           scale_factor,
+                                                 gint                           frame);
+
+void             bg_thumbnail_cache_load_async  (CcBackgroundItem              *item,
+                                                 GnomeDesktopThumbnailFactory  *factory,
+                                                 gint                           width,
+                                                 gint                           height,
+                                                 gint                           scale_factor,
+                                                 gint                           frame,
+                                                 GCancellable                  *cancellable,
+                                                 GAsyncReadyCallback            callback,
+                                                 gpointer                       user_data);
+
+cairo_surface_t *bg_thumbnail_cache_load_finish (GAsyncResult                  *result,
+                                                 GError                       **error);
+
+G_END_DECLS
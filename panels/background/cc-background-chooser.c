@@ -27,6 +27,7 @@
 #include "bg-colors-source.h"
 #include "bg-pictures-source.h"
 #include "bg-recent-source.h"
+#include "bg-thumbnail-cache.h"
 #include "bg-wallpapers-source.h"
 #include "cc-background-chooser.h"
 
@@ -85,13 +86,33 @@ on_delete_background_clicked_cb (GtkButton *button,
   bg_recent_source_remove_item (source, item);
 }
 
+static void
+on_thumbnail_loaded_cb (GObject      *source_object,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+  g_autoptr(GtkImage) image = GTK_IMAGE (user_data);
+  g_autoptr(GError) error = NULL;
+  cairo_surface_t *surface;
+
+  surface = bg_thumbnail_cache_load_finish (result, &error);
+  if (!surface)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to load background thumbnail: %s", error->message);
+      return;
+    }
+
+  gtk_image_set_from_surface (image, surface);
+  cairo_surface_destroy (surface);
+}
+
 static GtkWidget*
 create_widget_func (gpointer model_item,
                     gpointer user_data)
 {
-  g_autoptr(GdkPixbuf) pixbuf = NULL;
   CcBackgroundItem *item;
-  cairo_surface_t *cr;
+  cairo_surface_t *surface;
   GtkWidget *overlay;
   GtkWidget *child;
   GtkWidget *image;
@@ -99,18 +120,44 @@ create_widget_func (gpointer model_item,
   GtkWidget *button_image;
   GtkWidget *button = NULL;
   BgSource *source;
+  gint scale_factor;
+  gint width;
+  gint height;
 
   source = BG_SOURCE (user_data);
   item = CC_BACKGROUND_ITEM (model_item);
-  pixbuf = cc_background_item_get_thumbnail (item,
-                                             bg_source_get_thumbnail_factory (source),
-                                             bg_source_get_thumbnail_width (source),
-                                             bg_source_get_thumbnail_height (source),
-                                             bg_source_get_scale_factor (source));
-
-  cr = gdk_cairo_surface_create_from_pixbuf (pixbuf, bg_source_get_scale_factor (source), NULL);
-  image = gtk_image_new_from_surface (cr);
-  cairo_surface_destroy (cr);
+
+  width = bg_source_get_thumbnail_width (source);
+  height = bg_source_get_thumbnail_height (source);
+  scale_factor = bg_source_get_scale_factor (source);
+
+  /* Thumbnails which aren't cached yet are loaded in the background,
+   * and a placeholder of the same size is shown meanwhile */
+  surface = bg_thumbnail_cache_lookup (item, width, height, scale_factor, -1);
+  if (surface)
+    {
+      image = gtk_image_new_from_surface (surface);
+      cairo_surface_destroy (surface);
+    }
+  else
+    {
+      g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+
+      image = gtk_image_new ();
+      gtk_widget_set_size_request (image, width / scale_factor, height / scale_factor);
+
+      g_signal_connect_object (image, "destroy", G_CALLBACK (g_cancellable_cancel), cancellable, G_CONNECT_SWAPPED);
+
+      bg_thumbnail_cache_load_async (item,
+                                     bg_source_get_thumbnail_factory (source),
+                                     width,
+                                     height,
+                                     scale_factor,
+                                     -1,
+                                     cancellable,
+                                     on_thumbnail_loaded_cb,
+                                     g_object_ref (image));
+    }
   gtk_widget_show (image);
 
   icon = g_object_new (GTK_TYPE_IMAGE,
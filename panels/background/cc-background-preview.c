@@ -22,6 +22,9 @@
 
 #include "cc-background-preview.h"
 
+/* Time the size has to stay the same before the preview is rendered again */
+#define RENDER_DELAY_MS 150
+
 struct _CcBackgroundPreview
 {
   GtkBox            parent;
@@ -37,12 +40,27 @@ struct _CcBackgroundPreview
   CcBackgroundItem *item;
   GSettings        *desktop_settings;
 
+  /* The last rendered preview, scaled while a new one is rendered */
+  cairo_surface_t  *surface;
+  gboolean          surface_is_current;
+  gint              render_width;
+  gint              render_height;
+  guint             render_timeout_id;
+  GCancellable     *render_cancellable;
+
   guint             lock_screen_time_timeout_id;
   gboolean          is_lock_screen;
   GDateTime        *previous_time;
   gboolean          is_24h_format;
 };
 
+typedef struct
+{
+  gchar *filename;
+  gint   width;
+  gint   height;
+} RenderData;
+
 G_DEFINE_TYPE (CcBackgroundPreview, cc_background_preview, GTK_TYPE_BOX)
 
 enum
@@ -147,6 +165,237 @@ stop_monitor_time (CcBackgroundPreview *self)
     }
 }
 
+static void
+render_data_free (RenderData *data)
+{
+  g_free (data->filename);
+  g_free (data);
+}
+
+/* Only plain pictures zoomed to fill the preview are rendered in a thread,
+ * with GdkPixbuf alone; anything else needs GnomeBG, which may only be used
+ * from the main thread. */
+static gchar *
+get_thread_renderable_filename (CcBackgroundItem *item)
+{
+  g_autofree gchar *filename = NULL;
+  const gchar *uri;
+
+  uri = cc_background_item_get_uri (item);
+  if (uri == NULL ||
+      cc_background_item_get_placement (item) != G_DESKTOP_BACKGROUND_STYLE_ZOOM ||
+      cc_background_item_changes_with_time (item))
+    return NULL;
+
+  filename = g_filename_from_uri (uri, NULL, NULL);
+  if (filename == NULL || g_str_has_suffix (filename, ".xml"))
+    return NULL;
+
+  return g_steal_pointer (&filename);
+}
+
+static void
+render_thread_func (GTask        *task,
+                    gpointer      source_object,
+                    gpointer      task_data,
+                    GCancellable *cancellable)
+{
+  RenderData *data = task_data;
+  g_autoptr(GdkPixbuf) original = NULL;
+  g_autoptr(GdkPixbuf) oriented = NULL;
+  g_autoptr(GError) error = NULL;
+  GdkPixbuf *pixbuf;
+  gdouble scale;
+  gint width;
+  gint height;
+
+  if (!gdk_pixbuf_get_file_info (data->filename, &width, &height))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                               "Unknown picture format of '%s'", data->filename);
+      return;
+    }
+
+  /* The picture is decoded at just enough pixels to cover the preview.
+   * Whether it gets rotated is only known once decoded, so it has to
+   * cover the preview either way. */
+  scale = MAX (MAX ((gdouble) data->width / width, (gdouble) data->height / height),
+               MAX ((gdouble) data->height / width, (gdouble) data->width / height));
+
+  if (scale < 1.0)
+    original = gdk_pixbuf_new_from_file_at_scale (data->filename,
+                                                  MIN (width, (gint) (width * scale) + 1),
+                                                  MIN (height, (gint) (height * scale) + 1),
+                                                  FALSE,
+                                                  &error);
+  else
+    original = gdk_pixbuf_new_from_file (data->filename, &error);
+
+  if (!original)
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  /* Translucent pictures are blended over the background colors, which
+   * is left to GnomeBG */
+  oriented = gdk_pixbuf_apply_embedded_orientation (original);
+  if (gdk_pixbuf_get_has_alpha (oriented))
+    {
+      g_task_return_pointer (task, NULL, NULL);
+      return;
+    }
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  /* Scaled the rest of the way to cover the whole preview, and cropped
+   * around the center */
+  width = gdk_pixbuf_get_width (oriented);
+  height = gdk_pixbuf_get_height (oriented);
+  scale = MAX ((gdouble) data->width / width, (gdouble) data->height / height);
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, data->width, data->height);
+  gdk_pixbuf_scale (oriented,
+                    pixbuf,
+                    0, 0,
+                    data->width, data->height,
+                    -(width * scale - data->width) / 2,
+                    -(height * scale - data->height) / 2,
+                    scale, scale,
+                    GDK_INTERP_BILINEAR);
+
+  g_task_return_pointer (task, pixbuf, g_object_unref);
+}
+
+static void
+set_rendered_pixbuf (CcBackgroundPreview *self,
+                     GdkPixbuf           *pixbuf)
+{
+  g_clear_pointer (&self->surface, cairo_surface_destroy);
+  self->surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, 1, NULL);
+  self->surface_is_current = TRUE;
+
+  self->render_width = 0;
+  self->render_height = 0;
+  g_clear_object (&self->render_cancellable);
+
+  gtk_widget_queue_draw (self->drawing_area);
+}
+
+static void
+render_with_gnome_bg (CcBackgroundPreview *self)
+{
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+
+  pixbuf = cc_background_item_get_frame_thumbnail (self->item,
+                                                   self->thumbnail_factory,
+                                                   self->render_width,
+                                                   self->render_height,
+                                                   gtk_widget_get_scale_factor (self->drawing_area),
+                                                   0,
+                                                   TRUE);
+
+  if (!pixbuf)
+    {
+      g_warning ("Failed to render the background");
+      self->render_width = 0;
+      self->render_height = 0;
+      g_clear_object (&self->render_cancellable);
+      return;
+    }
+
+  set_rendered_pixbuf (self, pixbuf);
+}
+
+static void
+on_render_finished_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  CcBackgroundPreview *self = CC_BACKGROUND_PREVIEW (source_object);
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+  g_autoptr(GError) error = NULL;
+
+  pixbuf = g_task_propagate_pointer (G_TASK (result), &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  /* The picture couldn't be rendered on its own */
+  if (!pixbuf)
+    {
+      if (error)
+        g_debug ("Failed to render the background in a thread: %s", error->message);
+      render_with_gnome_bg (self);
+      return;
+    }
+
+  set_rendered_pixbuf (self, pixbuf);
+}
+
+static gboolean
+render_timeout_cb (gpointer user_data)
+{
+  CcBackgroundPreview *self = user_data;
+  g_autoptr(GTask) task = NULL;
+  g_autofree gchar *filename = NULL;
+  RenderData *data;
+
+  self->render_timeout_id = 0;
+
+  filename = get_thread_renderable_filename (self->item);
+  if (!filename)
+    {
+      render_with_gnome_bg (self);
+      return G_SOURCE_REMOVE;
+    }
+
+  data = g_new0 (RenderData, 1);
+  data->filename = g_steal_pointer (&filename);
+  data->width = self->render_width;
+  data->height = self->render_height;
+
+  self->render_cancellable = g_cancellable_new ();
+
+  task = g_task_new (self, self->render_cancellable, on_render_finished_cb, NULL);
+  g_task_set_task_data (task, data, (GDestroyNotify) render_data_free);
+  g_task_run_in_thread (task, render_thread_func);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+cancel_render (CcBackgroundPreview *self)
+{
+  g_cancellable_cancel (self->render_cancellable);
+  g_clear_object (&self->render_cancellable);
+  g_clear_handle_id (&self->render_timeout_id, g_source_remove);
+
+  self->render_width = 0;
+  self->render_height = 0;
+}
+
+static void
+queue_render (CcBackgroundPreview *self,
+              gint                 width,
+              gint                 height)
+{
+  /* Already queued, or being rendered */
+  if (width == self->render_width && height == self->render_height)
+    return;
+
+  cancel_render (self);
+
+  self->render_width = width;
+  self->render_height = height;
+
+  /* While resizing, wait for the size to settle, unless there
+   * is nothing up to date to show in the meantime */
+  self->render_timeout_id = g_timeout_add (self->surface_is_current ? RENDER_DELAY_MS : 0,
+                                           render_timeout_cb,
+                                           self);
+}
+
 
 /* Callbacks */
 
@@ -155,37 +404,57 @@ on_preview_draw_cb (GtkWidget           *widget,
                     cairo_t             *cr,
                     CcBackgroundPreview *self)
 {
-  g_autoptr(GdkPixbuf) pixbuf = NULL;
   GtkAllocation allocation;
-  gint scale_factor;
+  gint surface_width;
+  gint surface_height;
 
   if (!self->item)
     return FALSE;
 
-  scale_factor = gtk_widget_get_scale_factor (widget);
   gtk_widget_get_allocation (widget, &allocation);
-  pixbuf = cc_background_item_get_frame_thumbnail (self->item,
-                                                   self->thumbnail_factory,
-                                                   allocation.width,
-                                                   allocation.height,
-                                                   scale_factor,
-                                                   0,
-                                                   TRUE);
 
+  if (self->surface)
+    {
+      surface_width = cairo_image_surface_get_width (self->surface);
+      surface_height = cairo_image_surface_get_height (self->surface);
+
+      cairo_save (cr);
+      cairo_scale (cr,
+                   (gdouble) allocation.width / surface_width,
+                   (gdouble) allocation.height / surface_height);
+      cairo_set_source_surface (cr, self->surface, 0, 0);
+      cairo_paint (cr);
+      cairo_restore (cr);
+
+      if (self->surface_is_current &&
+          surface_width == allocation.width &&
+          surface_height == allocation.height)
+        return TRUE;
+    }
 
-  gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
-  cairo_paint (cr);
+  queue_render (self, allocation.width, allocation.height);
 
   return TRUE;
 }
 
 /* GObject overrides */
 
+static void
+cc_background_preview_dispose (GObject *object)
+{
+  CcBackgroundPreview *self = (CcBackgroundPreview *)object;
+
+  cancel_render (self);
+
+  G_OBJECT_CLASS (cc_background_preview_parent_class)->dispose (object);
+}
+
 static void
 cc_background_preview_finalize (GObject *object)
 {
   CcBackgroundPreview *self = (CcBackgroundPreview *)object;
 
+  g_clear_pointer (&self->surface, cairo_surface_destroy);
   g_clear_object (&self->desktop_settings);
   g_clear_object (&self->item);
   g_clear_object (&self->thumbnail_factory);
@@ -300,6 +569,7 @@ cc_background_preview_class_init (CcBackgroundPreviewClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->dispose = cc_background_preview_dispose;
   object_class->finalize = cc_background_preview_finalize;
   object_class->get_property = cc_background_preview_get_property;
   object_class->set_property = cc_background_preview_set_property;
@@ -373,6 +643,10 @@ cc_background_preview_set_item (CcBackgroundPreview *self,
   gtk_widget_set_visible (self->animated_background_icon,
                           cc_background_item_changes_with_time (item));
 
+  /* The previous preview is shown until the new one is rendered */
+  cancel_render (self);
+  self->surface_is_current = FALSE;
+
   gtk_widget_queue_draw (self->drawing_area);
 
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_ITEM]);
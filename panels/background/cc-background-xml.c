@@ -20,24 +20,27 @@
  */
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 #include <gdesktop-enums.h>
 
 #include "gdesktop-enums-types.h"
 #include "cc-background-item.h"
 #include "cc-background-xml.h"
 
-/* The number of items we signal as "added" before
- * returning to the main loop */
-#define NUM_ITEMS_PER_BATCH 1
+#define NONE "(none)"
+#define DEFAULT_COLOR "#000000000000"
 
 struct _CcBackgroundXml
 {
   GObject      parent_instance;
 
+  GMutex       lock;         /* protects wp_hash and loaded_files */
   GHashTable  *wp_hash;
-  GAsyncQueue *item_added_queue;
+  GHashTable  *loaded_files; /* filename → FileStamp */
+  GAsyncQueue *item_added_queue; /* GAsyncQueue of GPtrArray of items */
   guint        item_added_id;
   GSList      *monitors; /* GSList of GFileMonitor */
 };
@@ -51,17 +54,99 @@ static guint signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE (CcBackgroundXml, cc_background_xml, G_TYPE_OBJECT)
 
+typedef struct
+{
+  gint64  mtime;
+  goffset size;
+} FileStamp;
+
+/* The contents of a <wallpaper> element */
+typedef struct
+{
+  gchar                     *name;            /* untranslated, used in the ID */
+  gchar                     *translated_name;
+  gint                       translated_name_priority;
+  gchar                     *uri;
+  gchar                     *pcolor;
+  gchar                     *scolor;
+  gchar                     *source_url;
+  GDesktopBackgroundStyle    placement;
+  GDesktopBackgroundShading  shading;
+  CcBackgroundItemFlags      flags;
+  gboolean                   deleted;
+} WallpaperEntry;
+
+typedef struct
+{
+  FileStamp  stamp;
+  GPtrArray *entries; /* GPtrArray of WallpaperEntry */
+} ParsedFile;
+
+/* The parsed wallpaper lists are shared by all the CcBackgroundXml
+ * instances, so that a file is only parsed again when it changes */
+G_LOCK_DEFINE_STATIC (parsed_files);
+static GHashTable *parsed_files = NULL; /* filename → ParsedFile */
+
+static WallpaperEntry *
+wallpaper_entry_new (void)
+{
+  WallpaperEntry *entry;
+
+  entry = g_new0 (WallpaperEntry, 1);
+  entry->translated_name_priority = G_MAXINT;
+  entry->pcolor = g_strdup (DEFAULT_COLOR);
+  entry->scolor = g_strdup (DEFAULT_COLOR);
+  entry->placement = G_DESKTOP_BACKGROUND_STYLE_SCALED;
+  entry->shading = G_DESKTOP_BACKGROUND_SHADING_SOLID;
+
+  return entry;
+}
+
+static void
+wallpaper_entry_free (WallpaperEntry *entry)
+{
+  g_free (entry->name);
+  g_free (entry->translated_name);
+  g_free (entry->uri);
+  g_free (entry->pcolor);
+  g_free (entry->scolor);
+  g_free (entry->source_url);
+  g_free (entry);
+}
+
+static void
+parsed_file_free (ParsedFile *parsed)
+{
+  g_ptr_array_unref (parsed->entries);
+  g_free (parsed);
+}
+
+static gboolean
+get_file_stamp (const gchar *filename,
+                FileStamp   *stamp)
+{
+  GStatBuf buf;
+
+  if (g_stat (filename, &buf) != 0)
+    return FALSE;
+
+  stamp->mtime = buf.st_mtime;
+  stamp->size = buf.st_size;
+
+  return TRUE;
+}
+
 static gboolean
-cc_background_xml_get_bool (const xmlNode *parent,
-			    const gchar   *prop_name)
+cc_background_xml_get_bool (xmlTextReaderPtr  reader,
+			    const gchar      *prop_name)
 {
   xmlChar *prop;
   gboolean ret_val = FALSE;
 
-  g_return_val_if_fail (parent != NULL, FALSE);
+  g_return_val_if_fail (reader != NULL, FALSE);
   g_return_val_if_fail (prop_name != NULL, FALSE);
 
-  prop = xmlGetProp ((xmlNode *) parent, (xmlChar*)prop_name);
+  prop = xmlTextReaderGetAttribute (reader, (xmlChar*)prop_name);
   if (prop != NULL) {
     if (!g_ascii_strcasecmp ((gchar *)prop, "true") || !g_ascii_strcasecmp ((gchar *)prop, "1")) {
       ret_val = TRUE;
@@ -88,236 +173,338 @@ enum_string_to_value (GType type,
 {
 	GEnumClass *eclass;
 	GEnumValue *value;
+	int ret = 0;
 
-	eclass = G_ENUM_CLASS (g_type_class_peek (type));
+	/* Lists can be parsed before any item has been created,
+	 * so the enum class might not have been referenced yet */
+	eclass = G_ENUM_CLASS (g_type_class_ref (type));
 	value = g_enum_get_value_by_nick (eclass, string);
 
 	/* Here's a bit of hand-made parsing, bad bad */
 	if (value == NULL) {
 		guint i;
 		for (i = 0; i < G_N_ELEMENTS (lookups); i++) {
-			if (g_str_equal (lookups[i].string, string))
-				return lookups[i].value;
+			if (g_str_equal (lookups[i].string, string)) {
+				ret = lookups[i].value;
+				break;
+			}
 		}
-		g_warning ("Unhandled value '%s' for enum '%s'",
-			   string, G_FLAGS_CLASS_TYPE_NAME (eclass));
-		return 0;
+		if (i == G_N_ELEMENTS (lookups))
+			g_warning ("Unhandled value '%s' for enum '%s'",
+				   string, G_FLAGS_CLASS_TYPE_NAME (eclass));
+	} else {
+		ret = value->value;
 	}
 
-	return value->value;
+	g_type_class_unref (eclass);
+
+	return ret;
 }
 
 static gboolean
 idle_emit (CcBackgroundXml *xml)
 {
-	gint i;
+	g_autoptr(GPtrArray) items = NULL;
+	gboolean keep_going = TRUE;
+	guint i;
 
 	g_async_queue_lock (xml->item_added_queue);
 
-	for (i = 0; i < NUM_ITEMS_PER_BATCH; i++) {
-		g_autoptr(GObject) item = NULL;
-
-		item = g_async_queue_try_pop_unlocked (xml->item_added_queue);
-		if (item == NULL)
-			break;
-		g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
+	items = g_async_queue_try_pop_unlocked (xml->item_added_queue);
+	if (g_async_queue_length_unlocked (xml->item_added_queue) <= 0) {
+		xml->item_added_id = 0;
+		keep_going = FALSE;
 	}
 
 	g_async_queue_unlock (xml->item_added_queue);
 
-        if (g_async_queue_length (xml->item_added_queue) > 0) {
-                return TRUE;
-        } else {
-                xml->item_added_id = 0;
-                return FALSE;
-        }
+	for (i = 0; items != NULL && i < items->len; i++)
+		g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, g_ptr_array_index (items, i));
+
+	return keep_going;
 }
 
+/* Takes ownership of @items, the new items of one file */
 static void
 emit_added_in_idle (CcBackgroundXml *xml,
-		    GObject         *object)
+		    GPtrArray       *items)
 {
 	g_async_queue_lock (xml->item_added_queue);
-	g_async_queue_push_unlocked (xml->item_added_queue, object);
+	g_async_queue_push_unlocked (xml->item_added_queue, items);
 	if (xml->item_added_id == 0)
 		xml->item_added_id = g_idle_add ((GSourceFunc) idle_emit, xml);
 	g_async_queue_unlock (xml->item_added_queue);
 }
 
-#define NONE "(none)"
-#define UNSET_FLAG(flag) G_STMT_START{ (flags&=~(flag)); }G_STMT_END
-#define SET_FLAG(flag) G_STMT_START{ (flags|=flag); }G_STMT_END
+static void
+parse_wallpaper_property (WallpaperEntry     *entry,
+			  const gchar        *filename,
+			  const gchar        *tag,
+			  const gchar        *lang,
+			  const gchar        *content)
+{
+  if (!strcmp (tag, "filename")) {
+    g_clear_pointer (&entry->uri, g_free);
+
+    /* FIXME same rubbish as in other parts of the code */
+    if (strcmp (content, NONE) != 0) {
+      g_autoptr(GFile) file = NULL;
+      g_autofree gchar *dirname = NULL;
+
+      dirname = g_path_get_dirname (filename);
+      file = g_file_new_for_commandline_arg_and_cwd (content, dirname);
+      entry->uri = g_file_get_uri (file);
+    }
+    entry->flags |= CC_BACKGROUND_ITEM_HAS_URI;
+  } else if (!strcmp (tag, "name")) {
+    if (lang == NULL) {
+      if (entry->name == NULL)
+        entry->name = g_strdup (content);
+    } else {
+      const gchar * const *syslangs;
+      gint i;
+
+      /* Keep the translation the user prefers the most */
+      syslangs = g_get_language_names ();
+      for (i = 0; syslangs[i] != NULL && i < entry->translated_name_priority; i++) {
+        if (!strcmp (syslangs[i], lang)) {
+          g_free (entry->translated_name);
+          entry->translated_name = g_strdup (content);
+          entry->translated_name_priority = i;
+          break;
+        }
+      }
+    }
+  } else if (!strcmp (tag, "options")) {
+    entry->placement = enum_string_to_value (G_DESKTOP_TYPE_DESKTOP_BACKGROUND_STYLE, content);
+    entry->flags |= CC_BACKGROUND_ITEM_HAS_PLACEMENT;
+  } else if (!strcmp (tag, "shade_type")) {
+    entry->shading = enum_string_to_value (G_DESKTOP_TYPE_DESKTOP_BACKGROUND_SHADING, content);
+    entry->flags |= CC_BACKGROUND_ITEM_HAS_SHADING;
+  } else if (!strcmp (tag, "pcolor")) {
+    g_free (entry->pcolor);
+    entry->pcolor = g_strdup (content);
+    entry->flags |= CC_BACKGROUND_ITEM_HAS_PCOLOR;
+  } else if (!strcmp (tag, "scolor")) {
+    g_free (entry->scolor);
+    entry->scolor = g_strdup (content);
+    entry->flags |= CC_BACKGROUND_ITEM_HAS_SCOLOR;
+  } else if (!strcmp (tag, "source_url")) {
+    g_free (entry->source_url);
+    entry->source_url = g_strdup (content);
+  } else {
+    g_debug ("Unknown Tag in %s: %s", filename, tag);
+  }
+}
+
+/* Reads the <wallpaper> elements of @filename without building a tree,
+ * returns %NULL if the file is not a valid wallpaper list */
+static GPtrArray *
+parse_wallpaper_list (const gchar *filename)
+{
+  g_autoptr(GPtrArray) entries = NULL;
+  WallpaperEntry *entry = NULL;
+  xmlTextReaderPtr reader;
+  int ret;
+
+  reader = xmlReaderForFile (filename, NULL, XML_PARSE_NONET);
+  if (reader == NULL)
+    return NULL;
+
+  entries = g_ptr_array_new_with_free_func ((GDestroyNotify) wallpaper_entry_free);
+
+  while ((ret = xmlTextReaderRead (reader)) == 1) {
+    const gchar *tag;
+    const gchar *lang;
+    xmlChar *content;
+    int depth;
+
+    depth = xmlTextReaderDepth (reader);
+    tag = (const gchar *) xmlTextReaderConstLocalName (reader);
+
+    if (depth == 1 && entry != NULL &&
+        xmlTextReaderNodeType (reader) == XML_READER_TYPE_END_ELEMENT) {
+      g_ptr_array_add (entries, entry);
+      entry = NULL;
+      continue;
+    }
+
+    if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT)
+      continue;
+
+    if (depth == 1 && !strcmp (tag, "wallpaper")) {
+      entry = wallpaper_entry_new ();
+      entry->deleted = cc_background_xml_get_bool (reader, "deleted");
+
+      if (xmlTextReaderIsEmptyElement (reader)) {
+        g_ptr_array_add (entries, entry);
+        entry = NULL;
+      }
+      continue;
+    }
+
+    if (depth != 2 || entry == NULL)
+      continue;
+
+    content = xmlTextReaderReadString (reader);
+    if (content == NULL)
+      continue;
+
+    lang = (const gchar *) xmlTextReaderConstXmlLang (reader);
+    g_strstrip ((gchar *) content);
+    if (*content != '\0')
+      parse_wallpaper_property (entry, filename, tag, lang, (const gchar *) content);
+    xmlFree (content);
+  }
+
+  g_clear_pointer (&entry, wallpaper_entry_free);
+  xmlFreeTextReader (reader);
+
+  if (ret != 0)
+    return NULL;
+
+  return g_steal_pointer (&entries);
+}
+
+/* Returns the entries of @filename, parsing it only if it changed
+ * since it was last parsed */
+static GPtrArray *
+get_wallpaper_list (const gchar     *filename,
+                    const FileStamp *stamp)
+{
+  ParsedFile *parsed;
+  GPtrArray *entries;
+
+  G_LOCK (parsed_files);
+
+  if (parsed_files == NULL)
+    parsed_files = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, (GDestroyNotify) parsed_file_free);
+
+  parsed = g_hash_table_lookup (parsed_files, filename);
+  if (parsed != NULL &&
+      parsed->stamp.mtime == stamp->mtime &&
+      parsed->stamp.size == stamp->size) {
+    entries = g_ptr_array_ref (parsed->entries);
+    G_UNLOCK (parsed_files);
+    return entries;
+  }
+
+  G_UNLOCK (parsed_files);
+
+  /* Invalid files are remembered too, as an empty list */
+  entries = parse_wallpaper_list (filename);
+  if (entries == NULL)
+    entries = g_ptr_array_new_with_free_func ((GDestroyNotify) wallpaper_entry_free);
+
+  parsed = g_new0 (ParsedFile, 1);
+  parsed->stamp = *stamp;
+  parsed->entries = g_ptr_array_ref (entries);
+
+  G_LOCK (parsed_files);
+  g_hash_table_replace (parsed_files, g_strdup (filename), parsed);
+  G_UNLOCK (parsed_files);
+
+  return entries;
+}
+
+static CcBackgroundItem *
+create_item (WallpaperEntry *entry,
+             const gchar    *filename)
+{
+  return g_object_new (CC_TYPE_BACKGROUND_ITEM,
+                       "name", entry->translated_name != NULL ? entry->translated_name : entry->name,
+                       "uri", entry->uri,
+                       "placement", entry->placement,
+                       "shading", entry->shading,
+                       "primary-color", entry->pcolor,
+                       "secondary-color", entry->scolor,
+                       "is-deleted", entry->deleted,
+                       "source-url", entry->source_url,
+                       "source-xml", filename,
+                       "needs-download", entry->source_url == NULL,
+                       "flags", entry->flags,
+                       NULL);
+}
 
 static gboolean
 cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
 				     const gchar     *filename,
 				     gboolean         in_thread)
 {
-  xmlDoc * wplist;
-  xmlNode * root, * list, * wpa;
-  xmlChar * nodelang;
-  const gchar * const * syslangs;
-  gint i;
-  gboolean retval;
-
-  wplist = xmlParseFile (filename);
-  retval = FALSE;
-
-  if (!wplist)
-    return retval;
-
-  syslangs = g_get_language_names ();
-
-  root = xmlDocGetRootElement (wplist);
-
-  for (list = root->children; list != NULL; list = list->next) {
-    if (!strcmp ((gchar *)list->name, "wallpaper")) {
-      g_autoptr(CcBackgroundItem) item = NULL;
-      CcBackgroundItemFlags flags;
-      g_autofree gchar *uri = NULL;
-      g_autofree gchar *cname = NULL;
-      g_autofree gchar *id = NULL;
-
-      flags = 0;
-      item = cc_background_item_new (NULL);
-
-      g_object_set (G_OBJECT (item),
-		    "is-deleted", cc_background_xml_get_bool (list, "deleted"),
-		    "source-xml", filename,
-		    NULL);
-
-      for (wpa = list->children; wpa != NULL; wpa = wpa->next) {
-	if (wpa->type == XML_COMMENT_NODE) {
-	  continue;
-	} else if (!strcmp ((gchar *)wpa->name, "filename")) {
-	  if (wpa->last != NULL && wpa->last->content != NULL) {
-	    gchar *content = g_strstrip ((gchar *)wpa->last->content);
-	    g_autofree gchar *bg_uri = NULL;
-
-	    /* FIXME same rubbish as in other parts of the code */
-	    if (strcmp (content, NONE) == 0) {
-	      bg_uri = NULL;
-	    } else {
-	      g_autoptr(GFile) file = NULL;
-	      g_autofree gchar *dirname = NULL;
-
-	      dirname = g_path_get_dirname (filename);
-	      file = g_file_new_for_commandline_arg_and_cwd (content, dirname);
-	      bg_uri = g_file_get_uri (file);
-	    }
-	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_URI);
-	    g_object_set (G_OBJECT (item), "uri", bg_uri, NULL);
-	  } else {
-	    break;
-	  }
-	} else if (!strcmp ((gchar *)wpa->name, "name")) {
-	  if (wpa->last != NULL && wpa->last->content != NULL) {
-	    g_autofree gchar *name = NULL;
-	    nodelang = xmlNodeGetLang (wpa->last);
-
-	    g_object_get (G_OBJECT (item), "name", &name, NULL);
-
-	    if (name == NULL && nodelang == NULL) {
-	       g_free (cname);
-	       cname = g_strdup (g_strstrip ((gchar *)wpa->last->content));
-	       g_object_set (G_OBJECT (item), "name", cname, NULL);
-            } else {
-	       for (i = 0; syslangs[i] != NULL; i++) {
-	         if (!strcmp (syslangs[i], (gchar *)nodelang)) {
-		   g_object_set (G_OBJECT (item), "name",
-				 g_strstrip ((gchar *)wpa->last->content), NULL);
-	           break;
-	         }
-	       }
-	    }
-
-	    xmlFree (nodelang);
-	  } else {
-	    break;
-	  }
-	} else if (!strcmp ((gchar *)wpa->name, "options")) {
-	  if (wpa->last != NULL) {
-	    g_object_set (G_OBJECT (item), "placement",
-			  enum_string_to_value (G_DESKTOP_TYPE_DESKTOP_BACKGROUND_STYLE,
-						g_strstrip ((gchar *)wpa->last->content)), NULL);
-	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_PLACEMENT);
-	  }
-	} else if (!strcmp ((gchar *)wpa->name, "shade_type")) {
-	  if (wpa->last != NULL) {
-	    g_object_set (G_OBJECT (item), "shading",
-			  enum_string_to_value (G_DESKTOP_TYPE_DESKTOP_BACKGROUND_SHADING,
-						g_strstrip ((gchar *)wpa->last->content)), NULL);
-	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_SHADING);
-	  }
-	} else if (!strcmp ((gchar *)wpa->name, "pcolor")) {
-	  if (wpa->last != NULL) {
-	    g_object_set (G_OBJECT (item), "primary-color",
-			  g_strstrip ((gchar *)wpa->last->content), NULL);
-	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_PCOLOR);
-	  }
-	} else if (!strcmp ((gchar *)wpa->name, "scolor")) {
-	  if (wpa->last != NULL) {
-	    g_object_set (G_OBJECT (item), "secondary-color",
-			  g_strstrip ((gchar *)wpa->last->content), NULL);
-	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_SCOLOR);
-	  }
-	} else if (!strcmp ((gchar *)wpa->name, "source_url")) {
-	   if (wpa->last != NULL) {
-             g_object_set (G_OBJECT (item),
-			   "source-url", g_strstrip ((gchar *)wpa->last->content),
-			   "needs-download", FALSE,
-			   NULL);
-	   }
-	} else if (!strcmp ((gchar *)wpa->name, "text")) {
-	  /* Do nothing here, libxml2 is being weird */
-	} else {
-	  g_debug ("Unknown Tag in %s: %s", filename, wpa->name);
-	}
-      }
+  g_autoptr(GPtrArray) entries = NULL;
+  g_autoptr(GPtrArray) items = NULL;
+  g_autofree gchar *uri = NULL;
+  FileStamp stamp;
+  FileStamp *loaded;
+  guint i;
+
+  if (!get_file_stamp (filename, &stamp))
+    return FALSE;
+
+  /* Nothing new to add if the file did not change since we loaded it */
+  g_mutex_lock (&xml->lock);
+  loaded = g_hash_table_lookup (xml->loaded_files, filename);
+  if (loaded != NULL &&
+      loaded->mtime == stamp.mtime &&
+      loaded->size == stamp.size) {
+    g_mutex_unlock (&xml->lock);
+    return FALSE;
+  }
+  loaded = g_new (FileStamp, 1);
+  *loaded = stamp;
+  g_hash_table_replace (xml->loaded_files, g_strdup (filename), loaded);
+  g_mutex_unlock (&xml->lock);
 
-      /* Check whether the target file exists */
-      {
-        const char *uri;
-
-	uri = cc_background_item_get_uri (item);
-	if (uri != NULL)
-	  {
-            g_autoptr(GFile) file = NULL;
-
-            file = g_file_new_for_uri (uri);
-	    if (g_file_query_exists (file, NULL) == FALSE)
-	      {
-	        g_clear_pointer (&cname, g_free);
-	        g_clear_object (&item);
-	        continue;
-	      }
-	  }
-      }
+  entries = get_wallpaper_list (filename, &stamp);
+  if (entries->len == 0)
+    return FALSE;
 
-      /* FIXME, this is a broken way of doing,
-       * need to use proper code here */
-      uri = g_filename_to_uri (filename, NULL, NULL);
-      id = g_strdup_printf ("%s#%s", uri, cname);
+  uri = g_filename_to_uri (filename, NULL, NULL);
+  items = g_ptr_array_new_with_free_func (g_object_unref);
 
-      /* Make sure we don't already have this one and that filename exists */
-      if (g_hash_table_lookup (xml->wp_hash, id) != NULL) {
-	continue;
-      }
+  for (i = 0; i < entries->len; i++) {
+    WallpaperEntry *entry = g_ptr_array_index (entries, i);
+    g_autofree gchar *id = NULL;
+
+    /* Check whether the target file exists */
+    if (entry->uri != NULL) {
+      g_autoptr(GFile) file = NULL;
+
+      file = g_file_new_for_uri (entry->uri);
+      if (g_file_query_exists (file, NULL) == FALSE)
+        continue;
+    }
 
-      g_object_set (G_OBJECT (item), "flags", flags, NULL);
+    /* FIXME, this is a broken way of doing,
+     * need to use proper code here */
+    id = g_strdup_printf ("%s#%s", uri, entry->name);
+
+    /* Make sure we don't already have this one */
+    g_mutex_lock (&xml->lock);
+    if (g_hash_table_lookup (xml->wp_hash, id) == NULL) {
+      CcBackgroundItem *item;
+
+      item = create_item (entry, filename);
       g_hash_table_insert (xml->wp_hash,
-                           g_strdup (id),
+                           g_steal_pointer (&id),
                            g_object_ref (item));
-      if (in_thread)
-        emit_added_in_idle (xml, g_object_ref (G_OBJECT (item)));
-      else
-        g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
-      retval = TRUE;
+      g_ptr_array_add (items, item);
     }
+    g_mutex_unlock (&xml->lock);
+  }
+
+  if (items->len == 0)
+    return FALSE;
+
+  if (in_thread) {
+    emit_added_in_idle (xml, g_steal_pointer (&items));
+  } else {
+    for (i = 0; i < items->len; i++)
+      g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, g_ptr_array_index (items, i));
   }
-  xmlFreeDoc (wplist);
 
-  return retval;
+  return TRUE;
 }
 
 static void
@@ -606,6 +793,8 @@ cc_background_xml_finalize (GObject *object)
         g_slist_free_full (xml->monitors, g_object_unref);
 
 	g_clear_pointer (&xml->wp_hash, g_hash_table_destroy);
+	g_clear_pointer (&xml->loaded_files, g_hash_table_destroy);
+	g_mutex_clear (&xml->lock);
 	if (xml->item_added_id != 0) {
 		g_source_remove (xml->item_added_id);
 		xml->item_added_id = 0;
@@ -638,7 +827,9 @@ cc_background_xml_init (CcBackgroundXml *xml)
                                               g_str_equal,
                                               (GDestroyNotify) g_free,
                                               (GDestroyNotify) g_object_unref);
-	xml->item_added_queue = g_async_queue_new_full ((GDestroyNotify) g_object_unref);
+        xml->loaded_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	g_mutex_init (&xml->lock);
+	xml->item_added_queue = g_async_queue_new_full ((GDestroyNotify) g_ptr_array_unref);
 }
 
 CcBackgroundXml *
@@ -25,6 +25,7 @@
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 
 #include <fontconfig/fontconfig.h>
@@ -84,8 +85,8 @@ cc_common_language_get_iter_for_language (GtkTreeModel *model,
   return iter_for_language (model, lang, iter, FALSE);
 }
 
-gboolean
-cc_common_language_has_font (const gchar *locale)
+static gboolean
+language_has_font (const gchar *locale)
 {
         const FcCharSet  *charset;
         FcPattern        *pattern;
@@ -140,6 +141,307 @@ cc_common_language_has_font (const gchar *locale)
         return is_displayable;
 }
 
+/* Whether the languages of all the locales can be displayed with the
+ * installed fonts. Listing the fonts for each language is slow when
+ * there are many fonts, so this is computed with a single pass over the
+ * fonts, in a thread, and saved until the fontconfig caches change. */
+
+#define FONT_COVERAGE_GROUP "Fonts"
+
+/* language code → whether it is displayable, only used from the main thread */
+static GHashTable *font_coverage = NULL;
+static GPtrArray *font_coverage_waiters = NULL;
+
+static gchar *
+get_font_coverage_path (void)
+{
+        return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "font-coverage", NULL);
+}
+
+static gchar *
+get_fontconfig_stamp (void)
+{
+        FcStrList *dirs;
+        FcChar8 *dir;
+        gint64 mtime = 0;
+
+        dirs = FcConfigGetCacheDirs (NULL);
+        if (dirs != NULL) {
+                while ((dir = FcStrListNext (dirs)) != NULL) {
+                        GStatBuf buf;
+
+                        if (g_stat ((const gchar *) dir, &buf) == 0)
+                                mtime = MAX (mtime, buf.st_mtime);
+                }
+                FcStrListDone (dirs);
+        }
+
+        return g_strdup_printf ("%d:%" G_GINT64_FORMAT, FcGetVersion (), mtime);
+}
+
+static GHashTable *
+load_font_coverage (const gchar  *stamp,
+                    gchar       **languages)
+{
+        g_autoptr(GKeyFile) key_file = NULL;
+        g_autoptr(GHashTable) coverage = NULL;
+        g_autofree gchar *path = NULL;
+        g_autofree gchar *saved_stamp = NULL;
+        g_auto(GStrv) displayable = NULL;
+        g_auto(GStrv) not_displayable = NULL;
+        gchar **l;
+
+        key_file = g_key_file_new ();
+        path = get_font_coverage_path ();
+        if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL))
+                return NULL;
+
+        saved_stamp = g_key_file_get_string (key_file, FONT_COVERAGE_GROUP, "Stamp", NULL);
+        if (g_strcmp0 (saved_stamp, stamp) != 0)
+                return NULL;
+
+        displayable = g_key_file_get_string_list (key_file, FONT_COVERAGE_GROUP, "Displayable", NULL, NULL);
+        not_displayable = g_key_file_get_string_list (key_file, FONT_COVERAGE_GROUP, "NotDisplayable", NULL, NULL);
+
+        coverage = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        for (l = displayable; l != NULL && *l != NULL; l++)
+                g_hash_table_insert (coverage, g_strdup (*l), GINT_TO_POINTER (TRUE));
+        for (l = not_displayable; l != NULL && *l != NULL; l++)
+                g_hash_table_insert (coverage, g_strdup (*l), GINT_TO_POINTER (FALSE));
+
+        /* Locales may have been installed since */
+        for (l = languages; *l != NULL; l++) {
+                if (!g_hash_table_contains (coverage, *l))
+                        return NULL;
+        }
+
+        return g_steal_pointer (&coverage);
+}
+
+static void
+save_font_coverage (const gchar *stamp,
+                    GHashTable  *coverage)
+{
+        g_autoptr(GKeyFile) key_file = NULL;
+        g_autoptr(GPtrArray) displayable = NULL;
+        g_autoptr(GPtrArray) not_displayable = NULL;
+        g_autoptr(GError) error = NULL;
+        g_autofree gchar *path = NULL;
+        g_autofree gchar *dir = NULL;
+        GHashTableIter iter;
+        gpointer key, value;
+
+        displayable = g_ptr_array_new ();
+        not_displayable = g_ptr_array_new ();
+
+        g_hash_table_iter_init (&iter, coverage);
+        while (g_hash_table_iter_next (&iter, &key, &value))
+                g_ptr_array_add (GPOINTER_TO_INT (value) ? displayable : not_displayable, key);
+
+        key_file = g_key_file_new ();
+        g_key_file_set_string (key_file, FONT_COVERAGE_GROUP, "Stamp", stamp);
+        g_key_file_set_string_list (key_file, FONT_COVERAGE_GROUP, "Displayable",
+                                    (const gchar * const *) displayable->pdata, displayable->len);
+        g_key_file_set_string_list (key_file, FONT_COVERAGE_GROUP, "NotDisplayable",
+                                    (const gchar * const *) not_displayable->pdata, not_displayable->len);
+
+        path = get_font_coverage_path ();
+        dir = g_path_get_dirname (path);
+        g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+        if (!g_key_file_save_to_file (key_file, path, &error))
+                g_debug ("Failed to save the font coverage: %s", error->message);
+}
+
+static gboolean
+langset_has_language (FcLangSet   *langs,
+                      const gchar *language)
+{
+        FcLangSet *language_set;
+        gboolean result;
+
+        language_set = FcLangSetCreate ();
+        FcLangSetAdd (language_set, (const FcChar8 *) language);
+        result = FcLangSetContains (langs, language_set);
+        FcLangSetDestroy (language_set);
+
+        return result;
+}
+
+static GHashTable *
+compute_font_coverage (gchar **languages)
+{
+        GHashTable *coverage;
+        FcPattern *pattern;
+        FcObjectSet *object_set;
+        FcFontSet *font_set;
+        FcLangSet *langs;
+        gchar **l;
+        gint i;
+
+        /* The union of the languages of all the fonts */
+        langs = FcLangSetCreate ();
+        pattern = FcPatternCreate ();
+        object_set = FcObjectSetBuild (FC_LANG, NULL);
+        font_set = FcFontList (NULL, pattern, object_set);
+
+        for (i = 0; font_set != NULL && i < font_set->nfont; i++) {
+                FcLangSet *font_langs, *union_langs;
+
+                if (FcPatternGetLangSet (font_set->fonts[i], FC_LANG, 0, &font_langs) != FcResultMatch)
+                        continue;
+
+                union_langs = FcLangSetUnion (langs, font_langs);
+                FcLangSetDestroy (langs);
+                langs = union_langs;
+        }
+
+        coverage = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        for (l = languages; *l != NULL; l++) {
+                gboolean is_displayable;
+
+                /* fontconfig does not know about some languages */
+                is_displayable = FcLangGetCharSet ((FcChar8 *) *l) == NULL ||
+                                 langset_has_language (langs, *l);
+                g_hash_table_insert (coverage, g_strdup (*l), GINT_TO_POINTER (is_displayable));
+        }
+
+        if (font_set != NULL)
+                FcFontSetDestroy (font_set);
+        FcObjectSetDestroy (object_set);
+        FcPatternDestroy (pattern);
+        FcLangSetDestroy (langs);
+
+        return coverage;
+}
+
+static void
+font_coverage_thread (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+        gchar **languages = task_data;
+        g_autofree gchar *stamp = NULL;
+        GHashTable *coverage;
+
+        stamp = get_fontconfig_stamp ();
+
+        coverage = load_font_coverage (stamp, languages);
+        if (coverage == NULL) {
+                coverage = compute_font_coverage (languages);
+                save_font_coverage (stamp, coverage);
+        }
+
+        g_task_return_pointer (task, coverage, (GDestroyNotify) g_hash_table_unref);
+}
+
+static void
+font_coverage_computed_cb (GObject      *source_object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+        g_autoptr(GPtrArray) waiters = NULL;
+        guint i;
+
+        font_coverage = g_task_propagate_pointer (G_TASK (result), NULL);
+
+        waiters = g_steal_pointer (&font_coverage_waiters);
+        for (i = 0; i < waiters->len; i++)
+                g_task_return_boolean (g_ptr_array_index (waiters, i), TRUE);
+}
+
+static gchar **
+get_all_language_codes (void)
+{
+        g_auto(GStrv) locales = NULL;
+        g_autoptr(GHashTable) seen = NULL;
+        GPtrArray *codes;
+        gchar **l;
+
+        seen = g_hash_table_new (g_str_hash, g_str_equal);
+        codes = g_ptr_array_new ();
+
+        locales = gnome_get_all_locales ();
+        for (l = locales; *l != NULL; l++) {
+                gchar *language_code = NULL;
+
+                if (!gnome_parse_locale (*l, &language_code, NULL, NULL, NULL))
+                        continue;
+
+                if (g_hash_table_contains (seen, language_code)) {
+                        g_free (language_code);
+                        continue;
+                }
+
+                g_hash_table_add (seen, language_code);
+                g_ptr_array_add (codes, language_code);
+        }
+        g_ptr_array_add (codes, NULL);
+
+        return (gchar **) g_ptr_array_free (codes, FALSE);
+}
+
+/**
+ * cc_common_language_load_font_coverage_async:
+ *
+ * Finds out which languages can be displayed with the installed fonts,
+ * so that cc_common_language_has_font() is fast afterwards. This is only
+ * done once, for all the callers.
+ */
+void
+cc_common_language_load_font_coverage_async (GCancellable        *cancellable,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data)
+{
+        g_autoptr(GTask) task = NULL;
+        g_autoptr(GTask) coverage_task = NULL;
+
+        task = g_task_new (NULL, cancellable, callback, user_data);
+        g_task_set_source_tag (task, cc_common_language_load_font_coverage_async);
+
+        if (font_coverage != NULL) {
+                g_task_return_boolean (task, TRUE);
+                return;
+        }
+
+        if (font_coverage_waiters != NULL) {
+                g_ptr_array_add (font_coverage_waiters, g_steal_pointer (&task));
+                return;
+        }
+
+        font_coverage_waiters = g_ptr_array_new_with_free_func (g_object_unref);
+        g_ptr_array_add (font_coverage_waiters, g_steal_pointer (&task));
+
+        coverage_task = g_task_new (NULL, NULL, font_coverage_computed_cb, NULL);
+        g_task_set_task_data (coverage_task, get_all_language_codes (), (GDestroyNotify) g_strfreev);
+        g_task_run_in_thread (coverage_task, font_coverage_thread);
+}
+
+gboolean
+cc_common_language_load_font_coverage_finish (GAsyncResult  *result,
+                                              GError       **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+        g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == cc_common_language_load_font_coverage_async, FALSE);
+
+        return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+gboolean
+cc_common_language_has_font (const gchar *locale)
+{
+        g_autofree gchar *language_code = NULL;
+        gpointer is_displayable;
+
+        if (font_coverage != NULL &&
+            gnome_parse_locale (locale, &language_code, NULL, NULL, NULL) &&
+            g_hash_table_lookup_extended (font_coverage, language_code, NULL, &is_displayable))
+                return GPOINTER_TO_INT (is_displayable);
+
+        return language_has_font (locale);
+}
+
 gchar *
 cc_common_language_get_current_language (void)
 {
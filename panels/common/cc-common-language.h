@@ -42,6 +42,11 @@ guint    cc_common_language_add_available_languages (GtkListStore     *store,
                                                      gboolean          regions,
                                                      GHashTable       *user_langs);
 gboolean cc_common_language_has_font                (const gchar  *locale);
+void     cc_common_language_load_font_coverage_async  (GCancellable        *cancellable,
+                                                       GAsyncReadyCallback  callback,
+                                                       gpointer             user_data);
+gboolean cc_common_language_load_font_coverage_finish (GAsyncResult        *result,
+                                                       GError             **error);
 gchar   *cc_common_language_get_current_language    (void);
 
 GHashTable *cc_common_language_get_initial_languages   (void);
@@ -31,7 +31,7 @@
 
 #include "list-box-helper.h"
 #include "cc-common-language.h"
-#include "cc-util.h"
+#include "cc-search-table.h"
 
 #define GNOME_DESKTOP_USE_UNSTABLE_API
 #include <libgnome-desktop/gnome-languages.h>
@@ -47,7 +47,10 @@ struct _CcLanguageChooser {
         GtkWidget *language_listbox;
         gboolean showing_extra;
         gchar *language;
-        gchar **filter_words;
+        CcSearchTable *search_table;
+        /* The rows matching the search, or NULL if there is no search */
+        GHashTable *search_matches;
+        GCancellable *cancellable;
 };
 
 G_DEFINE_TYPE (CcLanguageChooser, cc_language_chooser, HDY_TYPE_DIALOG)
@@ -146,6 +149,20 @@ no_results_widget_new (void)
         return widget;
 }
 
+static void
+add_to_search_table (CcLanguageChooser *chooser,
+                     GtkWidget         *row)
+{
+        const gchar *strings[] = {
+                g_object_get_data (G_OBJECT (row), "language"),
+                g_object_get_data (G_OBJECT (row), "country"),
+                g_object_get_data (G_OBJECT (row), "language-local"),
+                g_object_get_data (G_OBJECT (row), "country-local"),
+        };
+
+        cc_search_table_add (chooser->search_table, row, strings, G_N_ELEMENTS (strings));
+}
+
 static void
 add_languages (CcLanguageChooser *chooser,
                gchar            **locale_ids,
@@ -164,6 +181,7 @@ add_languages (CcLanguageChooser *chooser,
 
                 is_initial = (g_hash_table_lookup (initial, locale_id) != NULL);
                 widget = language_widget_new (locale_id, !is_initial);
+                add_to_search_table (chooser, widget);
                 gtk_widget_show (widget);
                 gtk_container_add (GTK_CONTAINER (chooser->language_listbox), widget);
         }
@@ -184,33 +202,12 @@ add_all_languages (CcLanguageChooser *chooser)
         g_strfreev (locale_ids);
 }
 
-static gboolean
-match_all (gchar       **words,
-           const gchar  *str)
-{
-        gchar **w;
-
-        if (str == NULL)
-                return FALSE;
-
-        for (w = words; *w; ++w)
-                if (!strstr (str, *w))
-                        return FALSE;
-
-        return TRUE;
-}
-
 static gboolean
 language_visible (GtkListBoxRow *row,
                   gpointer   user_data)
 {
         CcLanguageChooser *chooser = user_data;
-        g_autofree gchar *language = NULL;
-        g_autofree gchar *country = NULL;
-        g_autofree gchar *language_local = NULL;
-        g_autofree gchar *country_local = NULL;
         gboolean is_extra;
-        gboolean visible;
 
         if (row == chooser->more_item)
                 return !chooser->showing_extra;
@@ -220,30 +217,10 @@ language_visible (GtkListBoxRow *row,
         if (!chooser->showing_extra && is_extra)
                 return FALSE;
 
-        if (!chooser->filter_words)
-                return TRUE;
-
-        language =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "language"));
-        visible = match_all (chooser->filter_words, language);
-        if (visible)
-                return TRUE;
-
-        country =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "country"));
-        visible = match_all (chooser->filter_words, country);
-        if (visible)
+        if (!chooser->search_matches)
                 return TRUE;
 
-        language_local =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "language-local"));
-        visible = match_all (chooser->filter_words, language_local);
-        if (visible)
-                return TRUE;
-
-        country_local =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "country-local"));
-        return match_all (chooser->filter_words, country_local);
+        return g_hash_table_contains (chooser->search_matches, row);
 }
 
 static gint
@@ -273,18 +250,18 @@ sort_languages (GtkListBoxRow *a,
 static void
 filter_changed (CcLanguageChooser *chooser)
 {
-        g_autofree gchar *filter_contents = NULL;
-
-        g_clear_pointer (&chooser->filter_words, g_strfreev);
-
-        filter_contents =
-                cc_util_normalize_casefold_and_unaccent (gtk_entry_get_text (GTK_ENTRY (chooser->language_filter_entry)));
-        if (!filter_contents) {
+        g_clear_pointer (&chooser->search_matches, g_hash_table_unref);
+
+        /* Only the rows sharing the search's rarest trigram are compared,
+         * the filter function then just looks the rows up */
+        chooser->search_matches =
+                cc_search_table_match (chooser->search_table,
+                                       gtk_entry_get_text (GTK_ENTRY (chooser->language_filter_entry)));
+        if (!chooser->search_matches) {
                 gtk_list_box_invalidate_filter (GTK_LIST_BOX (chooser->language_listbox));
                 gtk_list_box_set_placeholder (GTK_LIST_BOX (chooser->language_listbox), NULL);
                 return;
         }
-        chooser->filter_words = g_strsplit_set (g_strstrip (filter_contents), " ", 0);
         gtk_list_box_set_placeholder (GTK_LIST_BOX (chooser->language_listbox), chooser->no_results);
         gtk_list_box_invalidate_filter (GTK_LIST_BOX (chooser->language_listbox));
 }
@@ -386,6 +363,30 @@ activate_default (GtkWindow         *window,
         gtk_widget_activate (focus);
 }
 
+static void
+font_coverage_loaded_cb (GObject      *source_object,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+        CcLanguageChooser *chooser;
+        g_autoptr(GError) error = NULL;
+        g_autofree gchar *language = NULL;
+
+        if (!cc_common_language_load_font_coverage_finish (result, &error) &&
+            g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                return;
+
+        chooser = CC_LANGUAGE_CHOOSER (user_data);
+        add_all_languages (chooser);
+
+        /* Show the language which was set meanwhile */
+        language = g_strdup (chooser->language);
+        if (language != NULL)
+                set_locale_id (chooser, language);
+
+        gtk_list_box_invalidate_filter (GTK_LIST_BOX (chooser->language_listbox));
+}
+
 void
 cc_language_chooser_init (CcLanguageChooser *chooser)
 {
@@ -407,7 +408,13 @@ cc_language_chooser_init (CcLanguageChooser *chooser)
                                          GTK_SELECTION_NONE);
         gtk_list_box_set_header_func (GTK_LIST_BOX (chooser->language_listbox),
                                       cc_list_box_update_header_func, NULL, NULL);
-        add_all_languages (chooser);
+
+        chooser->search_table = cc_search_table_new ();
+
+        chooser->cancellable = g_cancellable_new ();
+        cc_common_language_load_font_coverage_async (chooser->cancellable,
+                                                     font_coverage_loaded_cb,
+                                                     chooser);
 
         g_signal_connect_swapped (chooser->language_filter_entry, "search-changed",
                                   G_CALLBACK (filter_changed), chooser);
@@ -426,8 +433,11 @@ cc_language_chooser_dispose (GObject *object)
 {
         CcLanguageChooser *chooser = CC_LANGUAGE_CHOOSER (object);
 
+        g_cancellable_cancel (chooser->cancellable);
+        g_clear_object (&chooser->cancellable);
         g_clear_object (&chooser->no_results);
-        g_clear_pointer (&chooser->filter_words, g_strfreev);
+        g_clear_pointer (&chooser->search_matches, g_hash_table_unref);
+        g_clear_pointer (&chooser->search_table, cc_search_table_free);
         g_clear_pointer (&chooser->language, g_free);
 
         G_OBJECT_CLASS (cc_language_chooser_parent_class)->dispose (object);
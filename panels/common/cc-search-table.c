@@ -0,0 +1,226 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "cc-search-table.h"
+#include "cc-util.h"
+
+/*
+ * A table of the strings which list rows can be searched by, normalized
+ * with cc_util_normalize_casefold_and_unaccent() once, when the rows are
+ * added. An item matches a search if all the words of the search are
+ * found in one of its strings.
+ *
+ * The strings are indexed by their trigrams (sequences of three bytes),
+ * so that a search only compares the strings which contain the rarest
+ * trigram of the search words.
+ */
+
+typedef struct
+{
+  gpointer item;
+  gsize    offset;
+} Entry;
+
+struct _CcSearchTable
+{
+  /* The normalized strings, each followed by a nul byte */
+  GString    *strings;
+  GArray     *entries;
+  /* trigram → GArray of entry indexes, in increasing order */
+  GHashTable *trigrams;
+};
+
+#define TRIGRAM(s) (((guint) (guchar) (s)[0] << 16) | ((guint) (guchar) (s)[1] << 8) | (guint) (guchar) (s)[2])
+
+CcSearchTable *
+cc_search_table_new (void)
+{
+  CcSearchTable *table;
+
+  table = g_new0 (CcSearchTable, 1);
+  table->strings = g_string_new (NULL);
+  table->entries = g_array_new (FALSE, FALSE, sizeof (Entry));
+  table->trigrams = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                           NULL, (GDestroyNotify) g_array_unref);
+
+  return table;
+}
+
+void
+cc_search_table_free (CcSearchTable *table)
+{
+  g_string_free (table->strings, TRUE);
+  g_array_unref (table->entries);
+  g_hash_table_unref (table->trigrams);
+  g_free (table);
+}
+
+static void
+index_entry (CcSearchTable *table,
+             guint          index,
+             const gchar   *str)
+{
+  gsize len, i;
+
+  len = strlen (str);
+  for (i = 0; i + 3 <= len; i++)
+    {
+      gpointer trigram = GUINT_TO_POINTER (TRIGRAM (str + i));
+      GArray *postings;
+
+      postings = g_hash_table_lookup (table->trigrams, trigram);
+      if (postings == NULL)
+        {
+          postings = g_array_new (FALSE, FALSE, sizeof (guint));
+          g_hash_table_insert (table->trigrams, trigram, postings);
+        }
+
+      /* A trigram may appear several times in the same string */
+      if (postings->len == 0 || g_array_index (postings, guint, postings->len - 1) != index)
+        g_array_append_val (postings, index);
+    }
+}
+
+/**
+ * cc_search_table_add:
+ * @table: a #CcSearchTable
+ * @item: the item, usually a list row
+ * @strings: (array length=n_strings): the strings @item can be found by,
+ *   which may contain %NULL
+ * @n_strings: the length of @strings
+ */
+void
+cc_search_table_add (CcSearchTable       *table,
+                     gpointer             item,
+                     const gchar * const *strings,
+                     gint                 n_strings)
+{
+  g_autoptr(GString) buffer = NULL;
+  gint i;
+
+  buffer = g_string_new (NULL);
+
+  for (i = 0; i < n_strings; i++)
+    {
+      const gchar *normalized;
+      Entry entry;
+
+      normalized = cc_util_normalize_casefold_and_unaccent_to_buffer (strings[i], buffer);
+      if (normalized == NULL || *normalized == '\0')
+        continue;
+
+      entry.item = item;
+      entry.offset = table->strings->len;
+      g_string_append_len (table->strings, normalized, buffer->len + 1);
+      g_array_append_val (table->entries, entry);
+
+      index_entry (table, table->entries->len - 1, normalized);
+    }
+}
+
+static gboolean
+match_all (gchar       **words,
+           const gchar  *str)
+{
+  gchar **w;
+
+  for (w = words; *w; ++w)
+    if (!strstr (str, *w))
+      return FALSE;
+
+  return TRUE;
+}
+
+/* Finds the entries containing the rarest trigram of @words. Returns
+ * %FALSE if no entry can match. @candidates is set to %NULL if the words
+ * are too short to have any trigram, and all the entries are candidates. */
+static gboolean
+get_candidates (CcSearchTable  *table,
+                gchar         **words,
+                GArray        **candidates)
+{
+  gchar **w;
+
+  *candidates = NULL;
+
+  for (w = words; *w; ++w)
+    {
+      gsize len, i;
+
+      len = strlen (*w);
+      for (i = 0; i + 3 <= len; i++)
+        {
+          GArray *postings;
+
+          postings = g_hash_table_lookup (table->trigrams, GUINT_TO_POINTER (TRIGRAM (*w + i)));
+          if (postings == NULL)
+            return FALSE;
+
+          if (*candidates == NULL || postings->len < (*candidates)->len)
+            *candidates = postings;
+        }
+    }
+
+  return TRUE;
+}
+
+/**
+ * cc_search_table_match:
+ * @table: a #CcSearchTable
+ * @text: the search, as typed
+ *
+ * Returns: (transfer full) (nullable): the set of the items matching
+ *   @text, or %NULL if @text is empty and everything matches
+ */
+GHashTable *
+cc_search_table_match (CcSearchTable *table,
+                       const gchar   *text)
+{
+  g_autofree gchar *normalized = NULL;
+  g_auto(GStrv) words = NULL;
+  GHashTable *matches;
+  GArray *candidates;
+  guint n_candidates, i;
+
+  normalized = cc_util_normalize_casefold_and_unaccent (text);
+  if (normalized == NULL)
+    return NULL;
+
+  words = g_strsplit_set (g_strstrip (normalized), " ", 0);
+  matches = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  if (!get_candidates (table, words, &candidates))
+    return matches;
+
+  n_candidates = candidates != NULL ? candidates->len : table->entries->len;
+  for (i = 0; i < n_candidates; i++)
+    {
+      Entry *entry;
+      guint index;
+
+      index = candidates != NULL ? g_array_index (candidates, guint, i) : i;
+      entry = &g_array_index (table->entries, Entry, index);
+
+      if (match_all (words, table->strings->str + entry->offset))
+        g_hash_table_add (matches, entry->item);
+    }
+
+  return matches;
+}
@@ -0,0 +1,36 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CcSearchTable CcSearchTable;
+
+CcSearchTable *cc_search_table_new   (void);
+void           cc_search_table_free  (CcSearchTable       *table);
+void           cc_search_table_add   (CcSearchTable       *table,
+                                      gpointer             item,
+                                      const gchar * const *strings,
+                                      gint                 n_strings);
+GHashTable    *cc_search_table_match (CcSearchTable       *table,
+                                      const gchar         *text);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CcSearchTable, cc_search_table_free)
+
+G_END_DECLS
@@ -38,73 +38,164 @@
 
 #define IS_SOFT_HYPHEN(c) ((c) == 0x00AD)
 
-/* Copied from tracker/src/libtracker-fts/tracker-parser-glib.c under the GPL
- * And then from gnome-shell/src/shell-util.c
+#define ASCII_HIGH_BITS G_GUINT64_CONSTANT (0x8080808080808080)
+#define ASCII_ONES      G_GUINT64_CONSTANT (0x0101010101010101)
+
+static inline guint64
+load_word (const gchar *p)
+{
+  guint64 word;
+
+  memcpy (&word, p, sizeof (word));
+  return word;
+}
+
+/* Lowercases 8 ASCII characters at once: adding 0x80 - 'A' to a byte sets
+ * its high bit when it is >= 'A', and adding 0x80 - 'Z' - 1 when it is
+ * > 'Z'. No byte can carry into the next one, as they are all < 0x80. */
+static inline guint64
+ascii_lowercase_word (guint64 word)
+{
+  guint64 ge_a = word + ASCII_ONES * (0x80 - 'A');
+  guint64 gt_z = word + ASCII_ONES * (0x80 - 'Z' - 1);
+
+  return word | (((ge_a & ~gt_z) & ASCII_HIGH_BITS) >> 2);
+}
+
+/* NFKD leaves ASCII untouched and casefolding it is plain lowercasing */
+static void
+append_ascii (GString     *string,
+              const gchar *str,
+              gsize        len)
+{
+  gsize offset = string->len;
+  gchar *out;
+  gsize i = 0;
+
+  g_string_set_size (string, offset + len);
+  out = string->str + offset;
+
+  for (; i + sizeof (guint64) <= len; i += sizeof (guint64))
+    {
+      guint64 word = ascii_lowercase_word (load_word (str + i));
+      memcpy (out + i, &word, sizeof (word));
+    }
+
+  for (; i < len; i++)
+    out[i] = g_ascii_tolower (str[i]);
+}
+
+/* Stripping the marks comes from tracker/src/libtracker-fts/tracker-parser-glib.c
+ * under the GPL, and then from gnome-shell/src/shell-util.c
  *
  * Originally written by Aleksander Morgado <aleksander@gnu.org>
  */
-char *
-cc_util_normalize_casefold_and_unaccent (const char *str)
+static gboolean
+append_unicode (GString     *string,
+                const gchar *str,
+                gsize        len)
 {
   g_autofree gchar *normalized = NULL;
-  gchar *tmp;
-  int i = 0, j = 0, ilen;
+  g_autofree gchar *folded = NULL;
+  const gchar *p;
+
+  normalized = g_utf8_normalize (str, len, G_NORMALIZE_NFKD);
+  if (normalized == NULL)
+    return FALSE;
+
+  folded = g_utf8_casefold (normalized, -1);
+
+  for (p = folded; *p != '\0'; )
+    {
+      gunichar unichar = g_utf8_get_char (p);
+      const gchar *next = g_utf8_next_char (p);
+
+      /* Drop combining diacritical marks, keep everything else */
+      if (!IS_CDM_UCS4 (unichar) && !IS_SOFT_HYPHEN (unichar))
+        g_string_append_len (string, p, next - p);
+
+      p = next;
+    }
+
+  return TRUE;
+}
+
+/**
+ * cc_util_normalize_casefold_and_unaccent_to_buffer:
+ * @str: (nullable): a UTF-8 string
+ * @buffer: the buffer to write to, which can be reused between calls
+ *
+ * Like cc_util_normalize_casefold_and_unaccent(), but replaces the contents
+ * of @buffer instead of allocating a new string.
+ *
+ * ASCII characters are never changed by the decomposition and cannot
+ * combine with their neighbours, so runs of them are simply lowercased,
+ * a word at a time. Only the runs of other characters go through
+ * g_utf8_normalize() and g_utf8_casefold().
+ *
+ * Returns: (nullable): the contents of @buffer, or %NULL if @str is %NULL
+ */
+const char *
+cc_util_normalize_casefold_and_unaccent_to_buffer (const char *str,
+                                                   GString    *buffer)
+{
+  gsize len, i = 0;
+
+  g_return_val_if_fail (buffer != NULL, NULL);
+
+  g_string_truncate (buffer, 0);
 
   if (str == NULL)
     return NULL;
 
-  normalized = g_utf8_normalize (str, -1, G_NORMALIZE_NFKD);
-  tmp = g_utf8_casefold (normalized, -1);
-
-  ilen = strlen (tmp);
+  len = strlen (str);
 
-  while (i < ilen)
+  while (i < len)
     {
-      gunichar unichar;
-      gchar *next_utf8;
-      gint utf8_len;
-
-      /* Get next character of the word as UCS4 */
-      unichar = g_utf8_get_char_validated (&tmp[i], -1);
-
-      /* Invalid UTF-8 character or end of original string. */
-      if (unichar == (gunichar) -1 ||
-          unichar == (gunichar) -2)
-        {
-          break;
-        }
-
-      /* Find next UTF-8 character */
-      next_utf8 = g_utf8_next_char (&tmp[i]);
-      utf8_len = next_utf8 - &tmp[i];
-
-      if (IS_CDM_UCS4 (unichar) || IS_SOFT_HYPHEN (unichar))
-        {
-          /* If the given unichar is a combining diacritical mark,
-           * just update the original index, not the output one */
-          i += utf8_len;
-          continue;
-        }
-
-      /* If already found a previous combining
-       * diacritical mark, indexes are different so
-       * need to copy characters. As output and input
-       * buffers may overlap, need to use memmove
-       * instead of memcpy */
-      if (i != j)
-        {
-          memmove (&tmp[j], &tmp[i], utf8_len);
-        }
-
-      /* Update both indexes */
-      i += utf8_len;
-      j += utf8_len;
+      gsize start = i;
+
+      while (i + sizeof (guint64) <= len && (load_word (str + i) & ASCII_HIGH_BITS) == 0)
+        i += sizeof (guint64);
+      while (i < len && (str[i] & 0x80) == 0)
+        i++;
+
+      append_ascii (buffer, str + start, i - start);
+
+      /* UTF-8 continuation bytes are never ASCII, so the next ASCII
+       * byte always starts a new character */
+      start = i;
+      while (i < len && (str[i] & 0x80) != 0)
+        i++;
+
+      /* Invalid UTF-8: keep what was normalized so far */
+      if (i > start && !append_unicode (buffer, str + start, i - start))
+        break;
     }
 
-  /* Force proper string end */
-  tmp[j] = '\0';
+  return buffer->str;
+}
+
+/**
+ * cc_util_normalize_casefold_and_unaccent:
+ * @str: (nullable): a UTF-8 string
+ *
+ * Decomposes @str, casefolds it and removes its combining diacritical marks,
+ * so that it can be compared with other strings normalized the same way.
+ *
+ * Returns: (transfer full) (nullable): the normalized string
+ */
+char *
+cc_util_normalize_casefold_and_unaccent (const char *str)
+{
+  GString *buffer;
+
+  if (str == NULL)
+    return NULL;
+
+  buffer = g_string_sized_new (strlen (str));
+  cc_util_normalize_casefold_and_unaccent_to_buffer (str, buffer);
 
-  return tmp;
+  return g_string_free (buffer, FALSE);
 }
 
 char *
@@ -94,6 +94,7 @@ struct _CcDateTimePanel
   GtkWidget *auto_timezone_switch;
   GtkListStore *city_liststore;
   GtkTreeModelSort *city_modelsort;
+  gboolean city_liststore_loaded;
   GtkWidget *date_grid;
   GtkWidget *datetime_button;
   GtkWidget *datetime_dialog;
@@ -605,19 +606,40 @@ load_cities (TzLocation   *loc,
   g_autofree gchar *human_readable = NULL;
 
   human_readable = translated_city_name (loc);
-  gtk_list_store_insert_with_values (city_store, NULL, 0,
+  gtk_list_store_insert_with_values (city_store, NULL, -1,
                                      CITY_COL_CITY_HUMAN_READABLE, human_readable,
                                      CITY_COL_ZONE, loc->zone,
                                      -1);
 }
 
 static void
-load_regions_model (GtkListStore *cities)
+load_regions_model (CcDateTimePanel *self)
 {
-  g_autoptr(TzDB) db = NULL;
+  TzDB *db;
 
-  db = tz_load_db ();
-  g_ptr_array_foreach (db->locations, (GFunc) load_cities, cities);
+  if (self->city_liststore_loaded)
+    return;
+
+  self->city_liststore_loaded = TRUE;
+
+  db = tz_db_get_default ();
+  if (db == NULL)
+    return;
+
+  /* Translating every city name is slow, so only do it once the
+   * search entry is used, and sort the model once it is filled up */
+  g_ptr_array_foreach (db->locations, (GFunc) load_cities, self->city_liststore);
+
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (self->city_modelsort), CITY_COL_CITY_HUMAN_READABLE,
+                                        GTK_SORT_ASCENDING);
+}
+
+static gboolean
+on_timezone_searchentry_focus_in_event_cb (CcDateTimePanel *self)
+{
+  load_regions_model (self);
+
+  return GDK_EVENT_PROPAGATE;
 }
 
 static void
@@ -1274,13 +1296,10 @@ cc_date_time_panel_init (CcDateTimePanel *self)
 
   update_time (self);
 
-  load_regions_model (GTK_LIST_STORE (self->city_liststore));
-
-  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (self->city_modelsort), CITY_COL_CITY_HUMAN_READABLE,
-                                        GTK_SORT_ASCENDING);
+  /* The city model is only filled when the search entry gets focused */
+  g_signal_connect_object (self->timezone_searchentry, "focus-in-event",
+                           G_CALLBACK (on_timezone_searchentry_focus_in_event_cb), self, G_CONNECT_SWAPPED);
 
-  /* After the initial setup, so we can be sure that
-   * the model is filled up */
   get_initial_timezone (self);
 
   g_signal_connect_object (gtk_entry_get_completion (GTK_ENTRY (self->timezone_searchentry)),
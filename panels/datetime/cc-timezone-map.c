@@ -40,6 +40,13 @@ typedef struct
   guchar alpha;
 } CcTimezoneMapOffset;
 
+typedef struct
+{
+  gdouble     x;
+  gdouble     y;
+  TzLocation *location;
+} CcTimezoneMapPoint;
+
 struct _CcTimezoneMap
 {
   GtkWidget parent_instance;
@@ -48,9 +55,12 @@ struct _CcTimezoneMap
   GdkPixbuf *orig_background_dim;
   GdkPixbuf *orig_color_map;
 
-  GdkPixbuf *background;
+  cairo_surface_t *background;
   GdkPixbuf *color_map;
-  GdkPixbuf *pin;
+  cairo_surface_t *pin;
+
+  GHashTable *hilights;        /* resource path -> GdkPixbuf */
+  GHashTable *scaled_hilights; /* resource path -> cairo_surface_t */
 
   guchar *visible_map_pixels;
   gint visible_map_rowstride;
@@ -60,6 +70,11 @@ struct _CcTimezoneMap
   TzDB *tzdb;
   TzLocation *location;
 
+  /* Projected locations, laid out as an implicit k-d tree */
+  GArray *points;
+  gint points_width;
+  gint points_height;
+
   gchar *bubble_text;
 };
 
@@ -126,8 +141,10 @@ cc_timezone_map_dispose (GObject *object)
   g_clear_object (&self->orig_background);
   g_clear_object (&self->orig_background_dim);
   g_clear_object (&self->orig_color_map);
-  g_clear_object (&self->background);
-  g_clear_object (&self->pin);
+  g_clear_pointer (&self->background, cairo_surface_destroy);
+  g_clear_pointer (&self->pin, cairo_surface_destroy);
+  g_clear_pointer (&self->hilights, g_hash_table_destroy);
+  g_clear_pointer (&self->scaled_hilights, g_hash_table_destroy);
   g_clear_pointer (&self->bubble_text, g_free);
 
   if (self->color_map)
@@ -146,11 +163,15 @@ cc_timezone_map_finalize (GObject *object)
 {
   CcTimezoneMap *self = CC_TIMEZONE_MAP (object);
 
-  g_clear_pointer (&self->tzdb, tz_db_free);
+  g_clear_pointer (&self->points, g_array_unref);
 
   G_OBJECT_CLASS (cc_timezone_map_parent_class)->finalize (object);
 }
 
+static void update_points (CcTimezoneMap *map,
+                           gint           width,
+                           gint           height);
+
 /* GtkWidget functions */
 static void
 cc_timezone_map_get_preferred_width (GtkWidget *widget,
@@ -185,24 +206,34 @@ cc_timezone_map_get_preferred_height (GtkWidget *widget,
 }
 
 static void
-cc_timezone_map_size_allocate (GtkWidget     *widget,
-                               GtkAllocation *allocation)
+update_background (CcTimezoneMap *map,
+                   gint           width,
+                   gint           height)
 {
-  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
+  g_autoptr(GdkPixbuf) scaled = NULL;
   GdkPixbuf *pixbuf;
 
-  if (map->background)
-    g_object_unref (map->background);
-
-  if (!gtk_widget_is_sensitive (widget))
+  if (!gtk_widget_is_sensitive (GTK_WIDGET (map)))
     pixbuf = map->orig_background_dim;
   else
     pixbuf = map->orig_background;
 
-  map->background = gdk_pixbuf_scale_simple (pixbuf,
-                                             allocation->width,
-                                             allocation->height,
-                                             GDK_INTERP_BILINEAR);
+  scaled = gdk_pixbuf_scale_simple (pixbuf, width, height, GDK_INTERP_BILINEAR);
+
+  g_clear_pointer (&map->background, cairo_surface_destroy);
+  map->background = gdk_cairo_surface_create_from_pixbuf (scaled, 1, NULL);
+
+  /* The highlights were scaled for the previous size or sensitivity */
+  g_hash_table_remove_all (map->scaled_hilights);
+}
+
+static void
+cc_timezone_map_size_allocate (GtkWidget     *widget,
+                               GtkAllocation *allocation)
+{
+  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
+
+  update_background (map, allocation->width, allocation->height);
 
   if (map->color_map)
     g_object_unref (map->color_map);
@@ -215,6 +246,8 @@ cc_timezone_map_size_allocate (GtkWidget     *widget,
   map->visible_map_pixels = gdk_pixbuf_get_pixels (map->color_map);
   map->visible_map_rowstride = gdk_pixbuf_get_rowstride (map->color_map);
 
+  update_points (map, allocation->width, allocation->height);
+
   GTK_WIDGET_CLASS (cc_timezone_map_parent_class)->size_allocate (widget,
                                                                   allocation);
 }
@@ -283,6 +316,154 @@ convert_latitude_to_y (gdouble latitude, gdouble map_height)
   return y;
 }
 
+static gint
+compare_points_x (gconstpointer a,
+                  gconstpointer b,
+                  gpointer      user_data)
+{
+  const CcTimezoneMapPoint *point_a = a;
+  const CcTimezoneMapPoint *point_b = b;
+
+  return (point_a->x > point_b->x) - (point_a->x < point_b->x);
+}
+
+static gint
+compare_points_y (gconstpointer a,
+                  gconstpointer b,
+                  gpointer      user_data)
+{
+  const CcTimezoneMapPoint *point_a = a;
+  const CcTimezoneMapPoint *point_b = b;
+
+  return (point_a->y > point_b->y) - (point_a->y < point_b->y);
+}
+
+/* Sorts @points so that the median of each range splits it, alternately
+ * along x and y, with the two halves of the range being its subtrees.
+ */
+static void
+build_kd_tree (CcTimezoneMapPoint *points,
+               guint               n_points,
+               guint               depth)
+{
+  guint median;
+
+  if (n_points <= 1)
+    return;
+
+  g_qsort_with_data (points, n_points, sizeof (CcTimezoneMapPoint),
+                     depth % 2 == 0 ? compare_points_x : compare_points_y,
+                     NULL);
+
+  median = n_points / 2;
+
+  build_kd_tree (points, median, depth + 1);
+  build_kd_tree (points + median + 1, n_points - median - 1, depth + 1);
+}
+
+static void
+find_nearest_point (const CcTimezoneMapPoint  *points,
+                    guint                      n_points,
+                    guint                      depth,
+                    gdouble                    x,
+                    gdouble                    y,
+                    const CcTimezoneMapPoint **nearest,
+                    gdouble                   *nearest_dist)
+{
+  const CcTimezoneMapPoint *median;
+  gdouble dx, dy, dist, delta;
+  guint n_left;
+
+  if (n_points == 0)
+    return;
+
+  n_left = n_points / 2;
+  median = &points[n_left];
+
+  dx = median->x - x;
+  dy = median->y - y;
+  dist = dx * dx + dy * dy;
+
+  if (dist < *nearest_dist)
+    {
+      *nearest = median;
+      *nearest_dist = dist;
+    }
+
+  delta = depth % 2 == 0 ? x - median->x : y - median->y;
+
+  /* Search the side of the split the point is on first, and only look
+   * at the other side if it may hold something closer.
+   */
+  if (delta < 0)
+    {
+      find_nearest_point (points, n_left, depth + 1, x, y, nearest, nearest_dist);
+
+      if (delta * delta < *nearest_dist)
+        find_nearest_point (median + 1, n_points - n_left - 1, depth + 1, x, y, nearest, nearest_dist);
+    }
+  else
+    {
+      find_nearest_point (median + 1, n_points - n_left - 1, depth + 1, x, y, nearest, nearest_dist);
+
+      if (delta * delta < *nearest_dist)
+        find_nearest_point (points, n_left, depth + 1, x, y, nearest, nearest_dist);
+    }
+}
+
+static void
+update_points (CcTimezoneMap *map,
+               gint           width,
+               gint           height)
+{
+  GPtrArray *locations;
+  guint i;
+
+  if (map->points && map->points_width == width && map->points_height == height)
+    return;
+
+  locations = tz_get_locations (map->tzdb);
+
+  g_clear_pointer (&map->points, g_array_unref);
+  map->points = g_array_sized_new (FALSE, FALSE, sizeof (CcTimezoneMapPoint), locations->len);
+  map->points_width = width;
+  map->points_height = height;
+
+  for (i = 0; i < locations->len; i++)
+    {
+      CcTimezoneMapPoint point;
+
+      point.location = locations->pdata[i];
+      point.x = convert_longitude_to_x (point.location->longitude, width);
+      point.y = convert_latitude_to_y (point.location->latitude, height);
+
+      g_array_append_val (map->points, point);
+    }
+
+  build_kd_tree ((CcTimezoneMapPoint *) map->points->data, map->points->len, 0);
+}
+
+static TzLocation *
+get_nearest_location (CcTimezoneMap *map,
+                      gdouble        x,
+                      gdouble        y)
+{
+  const CcTimezoneMapPoint *nearest = NULL;
+  gdouble nearest_dist = G_MAXDOUBLE;
+
+  if (!map->points)
+    return NULL;
+
+  find_nearest_point ((const CcTimezoneMapPoint *) map->points->data,
+                      map->points->len,
+                      0,
+                      x, y,
+                      &nearest,
+                      &nearest_dist);
+
+  return nearest ? nearest->location : NULL;
+}
+
 static void
 draw_text_bubble (cairo_t *cr,
                   GtkWidget *widget,
@@ -355,26 +536,19 @@ draw_text_bubble (cairo_t *cr,
   cairo_restore (cr);
 }
 
-static gboolean
-cc_timezone_map_draw (GtkWidget *widget,
-                      cairo_t   *cr)
+static cairo_surface_t *
+get_hilight (CcTimezoneMap *map,
+             gint           width,
+             gint           height)
 {
-  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
-  g_autoptr(GdkPixbuf) orig_hilight = NULL;
-  GtkAllocation alloc;
-  g_autofree gchar *file = NULL;
+  g_autoptr(GdkPixbuf) hilight = NULL;
   g_autoptr(GError) err = NULL;
-  gdouble pointx, pointy;
+  g_autofree gchar *file = NULL;
+  cairo_surface_t *surface;
+  GdkPixbuf *orig_hilight;
   char buf[16];
 
-  gtk_widget_get_allocation (widget, &alloc);
-
-  /* paint background */
-  gdk_cairo_set_source_pixbuf (cr, map->background, 0, 0);
-  cairo_paint (cr);
-
-  /* paint hilight */
-  if (gtk_widget_is_sensitive (widget))
+  if (gtk_widget_is_sensitive (GTK_WIDGET (map)))
     {
       file = g_strdup_printf (DATETIME_RESOURCE_PATH "/timezone_%s.png",
                               g_ascii_formatd (buf, sizeof (buf),
@@ -388,21 +562,53 @@ cc_timezone_map_draw (GtkWidget *widget,
 
     }
 
-  orig_hilight = gdk_pixbuf_new_from_resource (file, &err);
+  surface = g_hash_table_lookup (map->scaled_hilights, file);
+  if (surface)
+    return surface;
 
+  orig_hilight = g_hash_table_lookup (map->hilights, file);
   if (!orig_hilight)
     {
-      g_warning ("Could not load hilight: %s",
-                 (err) ? err->message : "Unknown Error");
+      orig_hilight = gdk_pixbuf_new_from_resource (file, &err);
+
+      if (!orig_hilight)
+        {
+          g_warning ("Could not load hilight: %s",
+                     (err) ? err->message : "Unknown Error");
+          return NULL;
+        }
+
+      g_hash_table_insert (map->hilights, g_strdup (file), orig_hilight);
     }
-  else
-    {
-      g_autoptr(GdkPixbuf) hilight = NULL;
 
-      hilight = gdk_pixbuf_scale_simple (orig_hilight, alloc.width,
-                                         alloc.height, GDK_INTERP_BILINEAR);
-      gdk_cairo_set_source_pixbuf (cr, hilight, 0, 0);
+  hilight = gdk_pixbuf_scale_simple (orig_hilight, width, height, GDK_INTERP_BILINEAR);
+  surface = gdk_cairo_surface_create_from_pixbuf (hilight, 1, NULL);
+
+  g_hash_table_insert (map->scaled_hilights, g_steal_pointer (&file), surface);
+
+  return surface;
+}
+
+static gboolean
+cc_timezone_map_draw (GtkWidget *widget,
+                      cairo_t   *cr)
+{
+  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
+  cairo_surface_t *hilight;
+  GtkAllocation alloc;
+  gdouble pointx, pointy;
+
+  gtk_widget_get_allocation (widget, &alloc);
+
+  /* paint background */
+  cairo_set_source_surface (cr, map->background, 0, 0);
+  cairo_paint (cr);
 
+  /* paint hilight */
+  hilight = get_hilight (map, alloc.width, alloc.height);
+  if (hilight)
+    {
+      cairo_set_source_surface (cr, hilight, 0, 0);
       cairo_paint (cr);
     }
 
@@ -418,9 +624,9 @@ cc_timezone_map_draw (GtkWidget *widget,
 
       if (map->pin)
         {
-          gdk_cairo_set_source_pixbuf (cr, map->pin,
-                                       pointx - PIN_HOT_POINT_X,
-                                       pointy - PIN_HOT_POINT_Y);
+          cairo_set_source_surface (cr, map->pin,
+                                    pointx - PIN_HOT_POINT_X,
+                                    pointy - PIN_HOT_POINT_Y);
           cairo_paint (cr);
         }
     }
@@ -452,8 +658,21 @@ static void
 cc_timezone_map_state_flags_changed (GtkWidget     *widget,
                                      GtkStateFlags  prev_state)
 {
+  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
+  GtkStateFlags changed;
+
   update_cursor (widget);
 
+  changed = prev_state ^ gtk_widget_get_state_flags (widget);
+
+  if ((changed & GTK_STATE_FLAG_INSENSITIVE) && map->background)
+    {
+      GtkAllocation alloc;
+
+      gtk_widget_get_allocation (widget, &alloc);
+      update_background (map, alloc.width, alloc.height);
+    }
+
   if (GTK_WIDGET_CLASS (cc_timezone_map_parent_class)->state_flags_changed)
     GTK_WIDGET_CLASS (cc_timezone_map_parent_class)->state_flags_changed (widget, prev_state);
 }
@@ -487,19 +706,6 @@ cc_timezone_map_class_init (CcTimezoneMapClass *klass)
 }
 
 
-static gint
-sort_locations (TzLocation *a,
-                TzLocation *b)
-{
-  if (a->dist > b->dist)
-    return 1;
-
-  if (a->dist < b->dist)
-    return -1;
-
-  return 0;
-}
-
 static void
 set_location (CcTimezoneMap *map,
               TzLocation    *location)
@@ -510,7 +716,7 @@ set_location (CcTimezoneMap *map,
 
   info = tz_info_from_location (map->location);
 
-  map->selected_offset = tz_location_get_utc_offset (map->location)
+  map->selected_offset = info->utc_offset
     / (60.0*60.0) + ((info->daylight) ? -1.0 : 0.0);
 
   g_signal_emit (map, signals[LOCATION_CHANGED], 0, map->location);
@@ -525,11 +731,7 @@ button_press_event (CcTimezoneMap  *map,
   guchar *pixels;
   gint rowstride;
   gint i;
-
-  const GPtrArray *array;
-  gint width, height;
-  GList *distances = NULL;
-  GtkAllocation alloc;
+  TzLocation *location;
 
   x = event->x;
   y = event->y;
@@ -555,35 +757,10 @@ button_press_event (CcTimezoneMap  *map,
 
   gtk_widget_queue_draw (GTK_WIDGET (map));
 
-  /* work out the co-ordinates */
-
-  array = tz_get_locations (map->tzdb);
-
-  gtk_widget_get_allocation (GTK_WIDGET (map), &alloc);
-  width = alloc.width;
-  height = alloc.height;
-
-  for (i = 0; i < array->len; i++)
-    {
-      gdouble pointx, pointy, dx, dy;
-      TzLocation *loc = array->pdata[i];
-
-      pointx = convert_longitude_to_x (loc->longitude, width);
-      pointy = convert_latitude_to_y (loc->latitude, height);
-
-      dx = pointx - x;
-      dy = pointy - y;
-
-      loc->dist = dx * dx + dy * dy;
-      distances = g_list_prepend (distances, loc);
-
-    }
-  distances = g_list_sort (distances, (GCompareFunc) sort_locations);
-
-
-  set_location (map, (TzLocation*) distances->data);
-
-  g_list_free (distances);
+  /* find the nearest city */
+  location = get_nearest_location (map, x, y);
+  if (location)
+    set_location (map, location);
 
   return TRUE;
 }
@@ -591,6 +768,7 @@ button_press_event (CcTimezoneMap  *map,
 static void
 cc_timezone_map_init (CcTimezoneMap *map)
 {
+  g_autoptr(GdkPixbuf) pin = NULL;
   GError *err = NULL;
 
   map->orig_background = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/bg.png",
@@ -622,16 +800,24 @@ cc_timezone_map_init (CcTimezoneMap *map)
       g_clear_error (&err);
     }
 
-  map->pin = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/pin.png",
-                                           &err);
-  if (!map->pin)
+  pin = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/pin.png",
+                                      &err);
+  if (!pin)
     {
       g_warning ("Could not load pin icon: %s",
                  (err) ? err->message : "Unknown error");
       g_clear_error (&err);
     }
+  else
+    {
+      map->pin = gdk_cairo_surface_create_from_pixbuf (pin, 1, NULL);
+    }
+
+  map->hilights = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  map->scaled_hilights = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                (GDestroyNotify) cairo_surface_destroy);
 
-  map->tzdb = tz_load_db ();
+  map->tzdb = tz_db_get_default ();
 
   g_signal_connect_object (map, "button-press-event", G_CALLBACK (button_press_event), map, G_CONNECT_SWAPPED);
 }
@@ -49,103 +49,143 @@ TzDB *
 tz_load_db (void)
 {
 	g_autofree gchar *tz_data_file = NULL;
+	g_autofree gchar *contents = NULL;
+	g_autoptr(GError) error = NULL;
 	TzDB *tz_db;
-	FILE *tzfile;
-	char buf[4096];
+	gchar *line, *next;
+	guint n_lines;
 
 	tz_data_file = tz_data_file_get ();
 	if (!tz_data_file) {
 		g_warning ("Could not get the TimeZone data file name");
 		return NULL;
 	}
-	tzfile = fopen (tz_data_file, "r");
-	if (!tzfile) {
-		g_warning ("Could not open *%s*\n", tz_data_file);
+	if (!g_file_get_contents (tz_data_file, &contents, NULL, &error)) {
+		g_warning ("Could not open *%s*: %s\n", tz_data_file, error->message);
 		return NULL;
 	}
 
+	/* All the locations are allocated in a single block, and their
+	 * strings are interned in a single string chunk. */
+	n_lines = 1;
+	for (line = contents; (line = strchr (line, '\n')) != NULL; line++)
+		n_lines++;
+#ifdef __sun
+	/* Each line may add two locations */
+	n_lines *= 2;
+#endif
+
 	tz_db = g_new0 (TzDB, 1);
-	tz_db->locations = g_ptr_array_new ();
+	tz_db->locations = g_ptr_array_sized_new (n_lines);
+	tz_db->location_data = g_new0 (TzLocation, n_lines);
+	tz_db->strings = g_string_chunk_new (4096);
 
-	while (fgets (buf, sizeof(buf), tzfile))
+	for (line = contents; line != NULL; line = next)
 	{
-		g_auto(GStrv) tmpstrarr = NULL;
-		g_autofree gchar *latstr = NULL;
-		g_autofree gchar *lngstr = NULL;
+		gchar *fields[6] = { NULL, };
+		gchar latstr[16], lngstr[16];
+		guint n_fields;
+		gsize lat_len;
 		gchar *p;
 		TzLocation *loc;
 
-		if (*buf == '#') continue;
-
-		g_strchomp(buf);
-		tmpstrarr = g_strsplit(buf,"\t", 6);
-		
-		latstr = g_strdup (tmpstrarr[1]);
-		p = latstr + 1;
-		while (*p != '-' && *p != '+') p++;
-		lngstr = g_strdup (p);
-		*p = '\0';
-		
-		loc = g_new0 (TzLocation, 1);
-		loc->country = g_strdup (tmpstrarr[0]);
-		loc->zone = g_strdup (tmpstrarr[2]);
+		next = strchr (line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		if (*line == '#' || *line == '\0') continue;
+
+		g_strchomp (line);
+
+		/* Split the line in place, the last field keeps any extra tabs */
+		n_fields = 0;
+		fields[n_fields++] = line;
+		for (p = line; n_fields < G_N_ELEMENTS (fields) && (p = strchr (p, '\t')) != NULL; ) {
+			*p++ = '\0';
+			fields[n_fields++] = p;
+		}
+
+		if (n_fields < 3) continue;
+
+		p = fields[1] + 1;
+		while (*p && *p != '-' && *p != '+') p++;
+		lat_len = p - fields[1];
+		if (lat_len >= sizeof (latstr)) continue;
+
+		memcpy (latstr, fields[1], lat_len);
+		latstr[lat_len] = '\0';
+		g_strlcpy (lngstr, p, sizeof (lngstr));
+
+		loc = &tz_db->location_data[tz_db->locations->len];
+		loc->country = g_string_chunk_insert_const (tz_db->strings, fields[0]);
+		loc->zone = g_string_chunk_insert_const (tz_db->strings, fields[2]);
 		loc->latitude  = convert_pos (latstr, 2);
 		loc->longitude = convert_pos (lngstr, 3);
-		
+
 #ifdef __sun
-		if (tmpstrarr[3] && *tmpstrarr[3] == '-' && tmpstrarr[4])
-			loc->comment = g_strdup (tmpstrarr[4]);
+		if (fields[3] && *fields[3] == '-' && fields[4])
+			loc->comment = g_string_chunk_insert_const (tz_db->strings, fields[4]);
 
-		if (tmpstrarr[3] && *tmpstrarr[3] != '-' && !islower(loc->zone)) {
+		if (fields[3] && *fields[3] != '-' && !islower(loc->zone)) {
 			TzLocation *locgrp;
 
 			/* duplicate entry */
-			locgrp = g_new0 (TzLocation, 1);
-			locgrp->country = g_strdup (tmpstrarr[0]);
-			locgrp->zone = g_strdup (tmpstrarr[3]);
-			locgrp->latitude  = convert_pos (latstr, 2);
-			locgrp->longitude = convert_pos (lngstr, 3);
-			locgrp->comment = (tmpstrarr[4]) ? g_strdup (tmpstrarr[4]) : NULL;
-
-			g_ptr_array_add (tz_db->locations, (gpointer) locgrp);
+			g_ptr_array_add (tz_db->locations, (gpointer) loc);
+
+			locgrp = &tz_db->location_data[tz_db->locations->len];
+			locgrp->country = loc->country;
+			locgrp->zone = g_string_chunk_insert_const (tz_db->strings, fields[3]);
+			locgrp->latitude  = loc->latitude;
+			locgrp->longitude = loc->longitude;
+			locgrp->comment = (fields[4]) ? g_string_chunk_insert_const (tz_db->strings, fields[4]) : NULL;
+
+			loc = locgrp;
 		}
 #else
-		loc->comment = (tmpstrarr[3]) ? g_strdup(tmpstrarr[3]) : NULL;
+		loc->comment = (fields[3]) ? g_string_chunk_insert_const (tz_db->strings, fields[3]) : NULL;
 #endif
 
 		g_ptr_array_add (tz_db->locations, (gpointer) loc);
 	}
-	
-	fclose (tzfile);
-	
+
 	/* now sort by country */
 	sort_locations_by_country (tz_db->locations);
-	
+
 	/* Load up the hashtable of backward links */
 	load_backward_tz (tz_db);
 
 	return tz_db;
 }
 
-static void
-tz_location_free (TzLocation *loc)
-{
-	g_free (loc->country);
-	g_free (loc->zone);
-	g_free (loc->comment);
-
-	g_free (loc);
-}
-
 void
 tz_db_free (TzDB *db)
 {
-	g_ptr_array_foreach (db->locations, (GFunc) tz_location_free, NULL);
 	g_ptr_array_free (db->locations, TRUE);
+	g_free (db->location_data);
+	g_string_chunk_free (db->strings);
 	g_hash_table_destroy (db->backward);
 	g_free (db);
 }
 
+/**
+ * tz_db_get_default:
+ *
+ * Returns the database loaded from the system zone.tab, which is only
+ * loaded once and shared by all its users in the process.
+ *
+ * Returns: (transfer none) (nullable): the shared #TzDB
+ */
+TzDB *
+tz_db_get_default (void)
+{
+	static TzDB *default_db = NULL;
+
+	if (!default_db)
+		default_db = tz_load_db ();
+
+	return default_db;
+}
+
 GPtrArray *
 tz_get_locations (TzDB *db)
 {
@@ -192,51 +232,57 @@ tz_location_get_utc_offset (TzLocation *loc)
 	return offset;
 }
 
+/* GTimeZone for each zone name, shared by all threads */
+G_LOCK_DEFINE_STATIC (time_zones);
+static GHashTable *time_zones = NULL;
+
+static GTimeZone *
+get_time_zone (const gchar *zone)
+{
+	GTimeZone *tz;
+
+	G_LOCK (time_zones);
+
+	if (!time_zones)
+		time_zones = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						    (GDestroyNotify) g_time_zone_unref);
+
+	tz = g_hash_table_lookup (time_zones, zone);
+	if (!tz) {
+		tz = g_time_zone_new (zone);
+		g_hash_table_insert (time_zones, g_strdup (zone), tz);
+	}
+
+	g_time_zone_ref (tz);
+
+	G_UNLOCK (time_zones);
+
+	return tz;
+}
+
+/* This doesn't touch the TZ environment variable, so it is safe to
+ * call from any thread. Each zone's rules are only loaded once. */
 TzInfo *
 tz_info_from_location (TzLocation *loc)
 {
+	g_autoptr(GTimeZone) tz = NULL;
 	TzInfo *tzinfo;
-	time_t curtime;
-	struct tm *curzone;
-	g_autofree gchar *tz_env_value = NULL;
-	
+	gint interval;
+
 	g_return_val_if_fail (loc != NULL, NULL);
 	g_return_val_if_fail (loc->zone != NULL, NULL);
-	
-	tz_env_value = g_strdup (getenv ("TZ"));
-	setenv ("TZ", loc->zone, 1);
-	
-#if 0
-	tzset ();
-#endif
-	tzinfo = g_new0 (TzInfo, 1);
 
-	curtime = time (NULL);
-	curzone = localtime (&curtime);
+	tz = get_time_zone (loc->zone);
+	interval = g_time_zone_find_interval (tz, G_TIME_TYPE_UNIVERSAL,
+					      g_get_real_time () / G_USEC_PER_SEC);
 
-#ifndef __sun
-	/* Currently this solution doesnt seem to work - I get that */
-	/* America/Phoenix uses daylight savings, which is wrong    */
-	tzinfo->tzname_normal = g_strdup (curzone->tm_zone);
-	if (curzone->tm_isdst) 
-		tzinfo->tzname_daylight =
-			g_strdup (&curzone->tm_zone[curzone->tm_isdst]);
-	else
-		tzinfo->tzname_daylight = NULL;
-
-	tzinfo->utc_offset = curzone->tm_gmtoff;
-#else
-	tzinfo->tzname_normal = NULL;
-	tzinfo->tzname_daylight = NULL;
-	tzinfo->utc_offset = 0;
-#endif
-
-	tzinfo->daylight = curzone->tm_isdst;
+	tzinfo = g_new0 (TzInfo, 1);
+	tzinfo->utc_offset = g_time_zone_get_offset (tz, interval);
+	tzinfo->daylight = g_time_zone_is_dst (tz, interval);
 
-	if (tz_env_value)
-		setenv ("TZ", tz_env_value, 1);
-	else
-		unsetenv ("TZ");
+	tzinfo->tzname_normal = g_strdup (g_time_zone_get_abbreviation (tz, interval));
+	if (tzinfo->daylight)
+		tzinfo->tzname_daylight = g_strdup (tzinfo->tzname_normal);
 
 	return tzinfo;
 }
@@ -40,8 +40,12 @@ typedef struct _TzInfo TzInfo;
 
 struct _TzDB
 {
-	GPtrArray  *locations;
-	GHashTable *backward;
+	GPtrArray    *locations;
+	GHashTable   *backward;
+
+	/* Storage for the locations and their strings */
+	TzLocation   *location_data;
+	GStringChunk *strings;
 };
 
 struct _TzLocation
@@ -51,8 +55,6 @@ struct _TzLocation
 	gdouble longitude;
 	gchar *zone;
 	gchar *comment;
-
-	gdouble dist; /* distance to clicked point for comparison */
 };
 
 /* see the glibc info page information on time zone information */
@@ -72,6 +74,7 @@ struct _TzInfo
 
 TzDB      *tz_load_db                 (void);
 void       tz_db_free                 (TzDB *db);
+TzDB      *tz_db_get_default          (void);
 char *     tz_info_get_clean_name     (TzDB *tz_db,
 				       const char *tz);
 GPtrArray *tz_get_locations           (TzDB *db);
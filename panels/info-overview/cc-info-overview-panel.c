@@ -74,6 +74,11 @@ struct _CcInfoOverviewPanel
   CcListRow       *software_updates_row;
   CcListRow       *virtualization_row;
   CcListRow       *windowing_system_row;
+
+  GCancellable    *cancellable;
+  GKeyFile        *hardware_cache;
+  guint            pending_probes;
+  gboolean         hardware_cache_changed;
 };
 
 typedef struct
@@ -235,26 +240,26 @@ get_renderer_from_session (void)
 
 /* @env is an array of strings with each pair of strings being the
  * key followed by the value */
-static char *
-get_renderer_from_helper (const char **env)
+static GSubprocess *
+spawn_renderer_helper (const char **env)
 {
-  int status;
-  char *argv[] = { LIBEXECDIR "/gnome-control-center-print-renderer", NULL };
-  g_auto(GStrv) envp = NULL;
-  g_autofree char *renderer = NULL;
+  const char *helper = LIBEXECDIR "/gnome-control-center-print-renderer";
+  g_autoptr(GSubprocessLauncher) launcher = NULL;
   g_autoptr(GError) error = NULL;
+  GSubprocess *subprocess;
 
-  g_debug ("About to launch '%s'", argv[0]);
+  g_debug ("About to launch '%s'", helper);
+
+  launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE);
 
   if (env != NULL)
     {
       guint i;
       g_debug ("With environment:");
-      envp = g_get_environ ();
       for (i = 0; env != NULL && env[i] != NULL; i = i + 2)
         {
           g_debug ("  %s = %s", env[i], env[i+1]);
-          envp = g_environ_setenv (envp, env[i], env[i+1], TRUE);
+          g_subprocess_launcher_setenv (launcher, env[i], env[i+1], TRUE);
         }
     }
   else
@@ -262,13 +267,26 @@ get_renderer_from_helper (const char **env)
       g_debug ("No additional environment variables");
     }
 
-  if (!g_spawn_sync (NULL, (char **) argv, envp, 0, NULL, NULL, &renderer, NULL, &status, &error))
+  subprocess = g_subprocess_launcher_spawn (launcher, &error, helper, NULL);
+  if (subprocess == NULL)
+    g_debug ("Failed to get GPU: %s", error->message);
+
+  return subprocess;
+}
+
+static char *
+wait_for_renderer_helper (GSubprocess *subprocess)
+{
+  g_autofree char *renderer = NULL;
+  g_autoptr(GError) error = NULL;
+
+  if (!g_subprocess_communicate_utf8 (subprocess, NULL, NULL, &renderer, NULL, &error))
     {
       g_debug ("Failed to get GPU: %s", error->message);
       return NULL;
     }
 
-  if (!g_spawn_check_exit_status (status, NULL))
+  if (!g_subprocess_get_successful (subprocess))
     return NULL;
 
   if (renderer == NULL || *renderer == '\0')
@@ -277,9 +295,22 @@ get_renderer_from_helper (const char **env)
   return info_cleanup (renderer);
 }
 
+static char *
+get_renderer_from_helper (const char **env)
+{
+  g_autoptr(GSubprocess) subprocess = NULL;
+
+  subprocess = spawn_renderer_helper (env);
+  if (subprocess == NULL)
+    return NULL;
+
+  return wait_for_renderer_helper (subprocess);
+}
+
 typedef struct {
   char *name;
   gboolean is_default;
+  GSubprocess *helper;
 } GpuData;
 
 static int
@@ -299,6 +330,7 @@ static void
 gpu_data_free (GpuData *data)
 {
   g_free (data->name);
+  g_clear_object (&data->helper);
   g_free (data);
 }
 
@@ -346,7 +378,6 @@ get_renderer_from_switcheroo (void)
       const char *name_s = 0;
       g_autofree const char **env_s = NULL;
       gsize env_len;
-      g_autofree char *renderer = NULL;
       GpuData *gpu_data;
 
       gpu = g_variant_get_child_value (variant, i);
@@ -369,19 +400,35 @@ get_renderer_from_switcheroo (void)
           g_clear_pointer (&env_s, g_free);
         }
 
-      renderer = get_renderer_from_helper (env_s);
       default_variant = g_variant_lookup_value (gpu, "Default", NULL);
 
-      /* We could give up if we don't have a renderer, but that
-       * might just mean gnome-session isn't installed. We fall back
-       * to the device name in udev instead, which is better than nothing */
-
+      /* Each helper creates a GL context, which is slow, so they are
+       * all started before waiting for any of them */
       gpu_data = g_new0 (GpuData, 1);
-      gpu_data->name = g_strdup (renderer ? renderer : name_s);
+      gpu_data->name = g_strdup (name_s);
       gpu_data->is_default = default_variant ? g_variant_get_boolean (default_variant) : FALSE;
+      gpu_data->helper = spawn_renderer_helper (env_s);
       renderers = g_slist_prepend (renderers, gpu_data);
     }
 
+  for (l = renderers; l != NULL; l = l->next)
+    {
+      GpuData *data = l->data;
+      g_autofree char *renderer = NULL;
+
+      if (data->helper != NULL)
+        renderer = wait_for_renderer_helper (data->helper);
+
+      /* We could give up if we don't have a renderer, but that
+       * might just mean gnome-session isn't installed. We fall back
+       * to the device name in udev instead, which is better than nothing */
+      if (renderer != NULL)
+        {
+          g_free (data->name);
+          data->name = g_steal_pointer (&renderer);
+        }
+    }
+
   renderers = g_slist_sort (renderers, gpu_data_sort);
   for (l = renderers; l != NULL; l = l->next)
     {
@@ -401,20 +448,18 @@ get_renderer_from_switcheroo (void)
   return g_string_free (renderers_string, FALSE);
 }
 
+/* Returns %NULL if the graphics hardware is unknown */
 static gchar *
 get_graphics_hardware_string (void)
 {
-  g_autofree char *discrete_renderer = NULL;
-  g_autofree char *renderer = NULL;
+  char *renderer;
 
   renderer = get_renderer_from_switcheroo ();
   if (!renderer)
     renderer = get_renderer_from_session ();
   if (!renderer)
     renderer = get_renderer_from_helper (NULL);
-  if (!renderer)
-    return g_strdup (_("Unknown"));
-  return g_strdup (renderer);
+  return renderer;
 }
 
 static char *
@@ -469,8 +514,9 @@ get_os_type (void)
     return g_strdup_printf (_("32-bit"));
 }
 
-static void
-get_primary_disc_info (CcInfoOverviewPanel *self)
+/* Returns 0 if the size of the disks is unknown */
+static guint64
+get_primary_disc_size (GCancellable *cancellable)
 {
   g_autoptr(UDisksClient) client = NULL;
   GDBusObjectManager *manager;
@@ -481,13 +527,13 @@ get_primary_disc_info (CcInfoOverviewPanel *self)
 
   total_size = 0;
 
-  client = udisks_client_new_sync (NULL, &error);
+  client = udisks_client_new_sync (cancellable, &error);
   if (client == NULL)
     {
-      g_warning ("Unable to get UDisks client: %s. Disk information will not be available.",
-                 error->message);
-      cc_list_row_set_secondary_label (self->disk_row,  _("Unknown"));
-      return;
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Unable to get UDisks client: %s. Disk information will not be available.",
+                   error->message);
+      return 0;
     }
 
   manager = udisks_client_get_object_manager (client);
@@ -509,15 +555,7 @@ get_primary_disc_info (CcInfoOverviewPanel *self)
       total_size += udisks_drive_get_size (drive);
     }
 
-  if (total_size > 0)
-    {
-      g_autofree gchar *size = g_format_size (total_size);
-      cc_list_row_set_secondary_label (self->disk_row, size);
-    }
-  else
-    {
-      cc_list_row_set_secondary_label (self->disk_row,  _("Unknown"));
-    }
+  return total_size;
 }
 
 static char *
@@ -681,42 +719,306 @@ get_windowing_system (void)
   return C_("Windowing system (Wayland, X11, or Unknown)", "Unknown");
 }
 
+/* The slow probes below run in threads, and their results are cached
+ * until the next boot */
+#define HARDWARE_CACHE_GROUP "Hardware"
+#define HARDWARE_CACHE_VERSION 1
+
+/* libgtop isn't thread-safe, so every call into it holds this lock */
+G_LOCK_DEFINE_STATIC (libgtop);
+
+static gchar *
+get_boot_id (void)
+{
+  g_autofree gchar *contents = NULL;
+
+  if (!g_file_get_contents ("/proc/sys/kernel/random/boot_id", &contents, NULL, NULL))
+    return NULL;
+
+  g_strstrip (contents);
+  if (*contents == '\0')
+    return NULL;
+
+  return g_steal_pointer (&contents);
+}
+
+static gchar *
+get_hardware_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "info-overview", NULL);
+}
+
+static void
+load_hardware_cache (CcInfoOverviewPanel *self)
+{
+  g_autoptr(GKeyFile) cache = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *boot_id = NULL;
+  g_autofree gchar *cached_boot_id = NULL;
+
+  /* Without a boot ID there is no telling whether the hardware changed */
+  boot_id = get_boot_id ();
+  if (boot_id == NULL)
+    return;
+
+  path = get_hardware_cache_path ();
+  cache = g_key_file_new ();
+
+  if (g_key_file_load_from_file (cache, path, G_KEY_FILE_NONE, NULL))
+    cached_boot_id = g_key_file_get_string (cache, HARDWARE_CACHE_GROUP, "BootId", NULL);
+
+  if (g_strcmp0 (boot_id, cached_boot_id) != 0 ||
+      g_key_file_get_integer (cache, HARDWARE_CACHE_GROUP, "Version", NULL) != HARDWARE_CACHE_VERSION)
+    {
+      g_clear_pointer (&cache, g_key_file_unref);
+      cache = g_key_file_new ();
+      g_key_file_set_string (cache, HARDWARE_CACHE_GROUP, "BootId", boot_id);
+      g_key_file_set_integer (cache, HARDWARE_CACHE_GROUP, "Version", HARDWARE_CACHE_VERSION);
+    }
+
+  self->hardware_cache = g_steal_pointer (&cache);
+}
+
+static void
+save_hardware_cache (CcInfoOverviewPanel *self)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *dir = NULL;
+
+  if (self->hardware_cache == NULL || !self->hardware_cache_changed)
+    return;
+
+  path = get_hardware_cache_path ();
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  if (!g_key_file_save_to_file (self->hardware_cache, path, &error))
+    g_debug ("Failed to save the hardware information to %s: %s", path, error->message);
+
+  self->hardware_cache_changed = FALSE;
+}
+
+static void
+probe_finished (CcInfoOverviewPanel *self)
+{
+  g_assert (self->pending_probes > 0);
+
+  self->pending_probes--;
+  if (self->pending_probes == 0)
+    save_hardware_cache (self);
+}
+
+static void
+run_probe (CcInfoOverviewPanel *self,
+           GTaskThreadFunc      thread_func,
+           GAsyncReadyCallback  callback)
+{
+  g_autoptr(GTask) task = NULL;
+
+  self->pending_probes++;
+
+  task = g_task_new (self, self->cancellable, callback, NULL);
+  g_task_run_in_thread (task, thread_func);
+}
+
+static void
+set_processor_info (CcInfoOverviewPanel *self,
+                    const gchar         *cpu_text)
+{
+  cc_list_row_set_secondary_markup (self->processor_row, cpu_text);
+}
+
+static void
+processor_thread_func (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+  const glibtop_sysinfo *info;
+  g_autofree char *cpu_text = NULL;
+
+  G_LOCK (libgtop);
+  info = glibtop_get_sysinfo ();
+  cpu_text = get_cpu_info (info);
+  G_UNLOCK (libgtop);
+
+  g_task_return_pointer (task, g_steal_pointer (&cpu_text), g_free);
+}
+
+static void
+on_processor_ready_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  CcInfoOverviewPanel *self = CC_INFO_OVERVIEW_PANEL (source_object);
+  g_autofree char *cpu_text = NULL;
+  g_autoptr(GError) error = NULL;
+
+  cpu_text = g_task_propagate_pointer (G_TASK (result), &error);
+  if (error != NULL)
+    return;
+
+  set_processor_info (self, cpu_text);
+
+  if (self->hardware_cache != NULL)
+    {
+      g_key_file_set_string (self->hardware_cache, HARDWARE_CACHE_GROUP, "Processor", cpu_text);
+      self->hardware_cache_changed = TRUE;
+    }
+
+  probe_finished (self);
+}
+
+static void
+set_graphics_info (CcInfoOverviewPanel *self,
+                   const gchar         *graphics_hardware_string)
+{
+  if (graphics_hardware_string != NULL)
+    cc_list_row_set_secondary_markup (self->graphics_row, graphics_hardware_string);
+  else
+    cc_list_row_set_secondary_label (self->graphics_row, _("Unknown"));
+}
+
+static void
+graphics_thread_func (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+  g_task_return_pointer (task, get_graphics_hardware_string (), g_free);
+}
+
+static void
+on_graphics_ready_cb (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  CcInfoOverviewPanel *self = CC_INFO_OVERVIEW_PANEL (source_object);
+  g_autofree gchar *graphics_hardware_string = NULL;
+  g_autoptr(GError) error = NULL;
+
+  graphics_hardware_string = g_task_propagate_pointer (G_TASK (result), &error);
+  if (error != NULL)
+    return;
+
+  set_graphics_info (self, graphics_hardware_string);
+
+  /* Failures are not cached, the session might not be fully up yet */
+  if (self->hardware_cache != NULL && graphics_hardware_string != NULL)
+    {
+      g_key_file_set_string (self->hardware_cache, HARDWARE_CACHE_GROUP, "Graphics", graphics_hardware_string);
+      self->hardware_cache_changed = TRUE;
+    }
+
+  probe_finished (self);
+}
+
+static void
+set_disk_info (CcInfoOverviewPanel *self,
+               guint64              total_size)
+{
+  if (total_size > 0)
+    {
+      g_autofree gchar *size = g_format_size (total_size);
+      cc_list_row_set_secondary_label (self->disk_row, size);
+    }
+  else
+    {
+      cc_list_row_set_secondary_label (self->disk_row,  _("Unknown"));
+    }
+}
+
+static void
+disk_thread_func (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  guint64 *total_size;
+
+  total_size = g_new (guint64, 1);
+  *total_size = get_primary_disc_size (cancellable);
+
+  g_task_return_pointer (task, total_size, g_free);
+}
+
+static void
+on_disk_ready_cb (GObject      *source_object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  CcInfoOverviewPanel *self = CC_INFO_OVERVIEW_PANEL (source_object);
+  g_autofree guint64 *total_size = NULL;
+  g_autoptr(GError) error = NULL;
+
+  total_size = g_task_propagate_pointer (G_TASK (result), &error);
+  if (error != NULL)
+    return;
+
+  set_disk_info (self, *total_size);
+
+  if (self->hardware_cache != NULL && *total_size > 0)
+    {
+      g_key_file_set_uint64 (self->hardware_cache, HARDWARE_CACHE_GROUP, "DiskSize", *total_size);
+      self->hardware_cache_changed = TRUE;
+    }
+
+  probe_finished (self);
+}
+
 static void
 info_overview_panel_setup_overview (CcInfoOverviewPanel *self)
 {
   g_autofree gchar *gnome_version = NULL;
   glibtop_mem mem;
-  const glibtop_sysinfo *info;
   g_autofree char *memory_text = NULL;
-  g_autofree char *cpu_text = NULL;
   g_autofree char *os_type_text = NULL;
   g_autofree char *os_name_text = NULL;
+  g_autofree char *cpu_text = NULL;
   g_autofree gchar *graphics_hardware_string = NULL;
+  guint64 disk_size = 0;
 
   if (load_gnome_version (&gnome_version, NULL, NULL))
     cc_list_row_set_secondary_label (self->gnome_version_row, gnome_version);
 
   cc_list_row_set_secondary_label (self->windowing_system_row, get_windowing_system ());
 
+  G_LOCK (libgtop);
   glibtop_get_mem (&mem);
+  G_UNLOCK (libgtop);
   memory_text = g_format_size_full (mem.total, G_FORMAT_SIZE_IEC_UNITS);
   cc_list_row_set_secondary_label (self->memory_row, memory_text);
 
-  info = glibtop_get_sysinfo ();
-
-  cpu_text = get_cpu_info (info);
-  cc_list_row_set_secondary_markup (self->processor_row, cpu_text);
-
   os_type_text = get_os_type ();
   cc_list_row_set_secondary_label (self->os_type_row, os_type_text);
 
   os_name_text = get_os_name ();
   cc_list_row_set_secondary_label (self->os_name_row, os_name_text);
 
-  get_primary_disc_info (self);
+  load_hardware_cache (self);
+
+  if (self->hardware_cache != NULL)
+    {
+      cpu_text = g_key_file_get_string (self->hardware_cache, HARDWARE_CACHE_GROUP, "Processor", NULL);
+      graphics_hardware_string = g_key_file_get_string (self->hardware_cache, HARDWARE_CACHE_GROUP, "Graphics", NULL);
+      disk_size = g_key_file_get_uint64 (self->hardware_cache, HARDWARE_CACHE_GROUP, "DiskSize", NULL);
+    }
+
+  if (cpu_text != NULL)
+    set_processor_info (self, cpu_text);
+  else
+    run_probe (self, processor_thread_func, on_processor_ready_cb);
+
+  if (graphics_hardware_string != NULL)
+    set_graphics_info (self, graphics_hardware_string);
+  else
+    run_probe (self, graphics_thread_func, on_graphics_ready_cb);
 
-  graphics_hardware_string = get_graphics_hardware_string ();
-  cc_list_row_set_secondary_markup (self->graphics_row, graphics_hardware_string);
+  if (disk_size > 0)
+    set_disk_info (self, disk_size);
+  else
+    run_probe (self, disk_thread_func, on_disk_ready_cb);
 }
 
 static gboolean
@@ -808,11 +1110,26 @@ cc_info_panel_row_activated_cb (CcInfoOverviewPanel *self,
     open_software_update (self);
 }
 
+static void
+cc_info_overview_panel_dispose (GObject *object)
+{
+  CcInfoOverviewPanel *self = CC_INFO_OVERVIEW_PANEL (object);
+
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+  g_clear_pointer (&self->hardware_cache, g_key_file_unref);
+
+  G_OBJECT_CLASS (cc_info_overview_panel_parent_class)->dispose (object);
+}
+
 static void
 cc_info_overview_panel_class_init (CcInfoOverviewPanelClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->dispose = cc_info_overview_panel_dispose;
+
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/control-center/info-overview/cc-info-overview-panel.ui");
 
   gtk_widget_class_bind_template_child (widget_class, CcInfoOverviewPanel, device_name_entry);
@@ -849,6 +1166,8 @@ cc_info_overview_panel_init (CcInfoOverviewPanel *self)
 
   g_resources_register (cc_info_overview_get_resource ());
 
+  self->cancellable = g_cancellable_new ();
+
   if (!does_gnome_software_exist () && !does_gpk_update_viewer_exist ())
     gtk_widget_hide (GTK_WIDGET (self->software_updates_row));
 
@@ -21,52 +21,170 @@
 #include <config.h>
 
 #include <glib.h>
+#include <string.h>
 #include "info-cleanup.h"
 
 typedef struct
 {
-  char *regex;
-  char *replacement;
+  const char *string;
+  const char *replacement;
+} ReplaceLiterals;
+
+typedef struct
+{
+  const char *regex;
+  const char *replacement;
+  /* The rule is skipped if the string doesn't contain this */
+  const char *required;
 } ReplaceStrings;
 
+/* These don't interact with each other, so they are all
+ * replaced in a single pass */
+static const ReplaceLiterals literals[] = {
+  { "Mesa DRI ", ""},
+  { "Intel(R)", "Intel\302\256"},
+  { "Core(TM)", "Core\342\204\242"},
+  { "Atom(TM)", "Atom\342\204\242"},
+};
+
+/* These have to be applied in order, after the literals */
+static const ReplaceStrings rs[] = {
+  { "Gallium .* on (AMD .*)", "\\1", "AMD"},
+  { "(AMD .*) [(].*", "\\1", "AMD"},
+  { "(AMD [A-Z])(.*)", "\\1\\L\\2\\E", "AMD"},
+  { "AMD", "AMD\302\256", "AMD"},
+  { "Graphics Controller", "Graphics", "Graphics Controller"},
+};
+
+typedef struct
+{
+  GRegex *literals_re;
+  GRegex *rs_re[G_N_ELEMENTS (rs)];
+  GRegex *whitespace_re;
+} CompiledRegexes;
+
+static GRegex *
+compile_regex (const char         *pattern,
+               GRegexCompileFlags  flags)
+{
+  g_autoptr(GError) error = NULL;
+  GRegex *re;
+
+  re = g_regex_new (pattern, flags | G_REGEX_OPTIMIZE, 0, &error);
+  if (re == NULL)
+    g_warning ("Error building regex: %s", error->message);
+
+  return re;
+}
+
+/* The regexes are compiled once, and shared by all threads */
+static const CompiledRegexes *
+get_compiled_regexes (void)
+{
+  static CompiledRegexes *compiled = NULL;
+
+  if (g_once_init_enter (&compiled))
+    {
+      CompiledRegexes *c;
+      g_autoptr(GString) pattern = NULL;
+      guint i;
+
+      c = g_new0 (CompiledRegexes, 1);
+
+      pattern = g_string_new (NULL);
+      for (i = 0; i < G_N_ELEMENTS (literals); i++)
+        {
+          g_autofree gchar *escaped = NULL;
+
+          escaped = g_regex_escape_string (literals[i].string, -1);
+          if (pattern->len > 0)
+            g_string_append_c (pattern, '|');
+          g_string_append (pattern, escaped);
+        }
+      c->literals_re = compile_regex (pattern->str, 0);
+
+      for (i = 0; i < G_N_ELEMENTS (rs); i++)
+        c->rs_re[i] = compile_regex (rs[i].regex, 0);
+
+      c->whitespace_re = compile_regex ("[ \t\n\r]+", G_REGEX_MULTILINE);
+
+      g_once_init_leave (&compiled, c);
+    }
+
+  return compiled;
+}
+
+static gboolean
+replace_literal_cb (const GMatchInfo *match_info,
+                    GString          *result,
+                    gpointer          user_data)
+{
+  g_autofree gchar *match = NULL;
+  guint i;
+
+  match = g_match_info_fetch (match_info, 0);
+  for (i = 0; i < G_N_ELEMENTS (literals); i++)
+    {
+      if (g_str_equal (match, literals[i].string))
+        {
+          g_string_append (result, literals[i].replacement);
+          break;
+        }
+    }
+
+  return FALSE;
+}
+
 static char *
 prettify_info (const char *info)
 {
+  const CompiledRegexes *compiled;
   g_autofree char *escaped = NULL;
   g_autofree gchar *pretty = NULL;
   int   i;
-  static const ReplaceStrings rs[] = {
-    { "Mesa DRI ", ""},
-    { "Intel[(]R[)]", "Intel\302\256"},
-    { "Core[(]TM[)]", "Core\342\204\242"},
-    { "Atom[(]TM[)]", "Atom\342\204\242"},
-    { "Gallium .* on (AMD .*)", "\\1"},
-    { "(AMD .*) [(].*", "\\1"},
-    { "(AMD [A-Z])(.*)", "\\1\\L\\2\\E"},
-    { "AMD", "AMD\302\256"},
-    { "Graphics Controller", "Graphics"},
-  };
 
   if (*info == '\0')
     return NULL;
 
+  compiled = get_compiled_regexes ();
+
   escaped = g_markup_escape_text (info, -1);
   pretty = g_strdup (g_strstrip (escaped));
 
-  for (i = 0; i < G_N_ELEMENTS (rs); i++)
+  if (compiled->literals_re != NULL)
     {
       g_autoptr(GError) error = NULL;
-      g_autoptr(GRegex) re = NULL;
       g_autofree gchar *new = NULL;
 
-      re = g_regex_new (rs[i].regex, 0, 0, &error);
-      if (re == NULL)
+      new = g_regex_replace_eval (compiled->literals_re,
+                                  pretty,
+                                  -1,
+                                  0,
+                                  0,
+                                  replace_literal_cb,
+                                  NULL,
+                                  &error);
+      if (new != NULL)
         {
-          g_warning ("Error building regex: %s", error->message);
-          continue;
+          g_free (pretty);
+          pretty = g_steal_pointer (&new);
         }
+      else
+        {
+          g_warning ("Error replacing literals: %s", error->message);
+        }
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (rs); i++)
+    {
+      g_autoptr(GError) error = NULL;
+      g_autofree gchar *new = NULL;
 
-      new = g_regex_replace (re,
+      if (compiled->rs_re[i] == NULL ||
+          strstr (pretty, rs[i].required) == NULL)
+        continue;
+
+      new = g_regex_replace (compiled->rs_re[i],
                              pretty,
                              -1,
                              0,
@@ -90,20 +208,18 @@ prettify_info (const char *info)
 static char *
 remove_duplicate_whitespace (const char *old)
 {
+  const CompiledRegexes *compiled;
   g_autofree gchar *new = NULL;
-  g_autoptr(GRegex) re = NULL;
   g_autoptr(GError) error = NULL;
 
   if (old == NULL)
     return NULL;
 
-  re = g_regex_new ("[ \t\n\r]+", G_REGEX_MULTILINE, 0, &error);
-  if (re == NULL)
-    {
-      g_warning ("Error building regex: %s", error->message);
-      return g_strdup (old);
-    }
-  new = g_regex_replace (re,
+  compiled = get_compiled_regexes ();
+  if (compiled->whitespace_re == NULL)
+    return g_strdup (old);
+
+  new = g_regex_replace (compiled->whitespace_re,
                          old,
                          -1,
                          0,
@@ -44,6 +44,9 @@ struct _CcKeyboardManager
   GHashTable         *kb_apps_sections;
   GHashTable         *kb_user_sections;
 
+  GHashTable         *combo_index;
+  GHashTable         *indexed_items;
+
   GSettings          *binding_settings;
 
   gpointer            wm_changed_id;
@@ -84,84 +87,169 @@ free_key_array (GPtrArray *keys)
     }
 }
 
+/*
+ * Shortcuts are indexed by their key combos, so that looking for a
+ * collision doesn't need to go through every item of every section.
+ * A combo with a keyval matches any keycode, so only its keyval is
+ * part of the key.
+ */
+static void
+get_index_key (const CcKeyCombo *combo,
+               CcKeyCombo       *key)
+{
+  key->keyval = combo->keyval;
+  key->keycode = combo->keyval != 0 ? 0 : combo->keycode;
+  key->mask = combo->mask;
+}
+
+static guint
+combo_hash (gconstpointer v)
+{
+  const CcKeyCombo *combo = v;
+
+  return (combo->keyval * 31 + combo->keycode) * 31 + combo->mask;
+}
+
 static gboolean
-find_conflict (CcUniquenessData *data,
-               CcKeyboardItem   *item)
+combo_equal (gconstpointer a,
+             gconstpointer b)
 {
+  const CcKeyCombo *ca = a;
+  const CcKeyCombo *cb = b;
+
+  return ca->keyval == cb->keyval &&
+         ca->keycode == cb->keycode &&
+         ca->mask == cb->mask;
+}
+
+static void
+index_item (CcKeyboardManager *self,
+            CcKeyboardItem    *item)
+{
+  GPtrArray *keys;
   GList *l;
-  gboolean is_conflict = FALSE;
 
-  if (data->orig_item && cc_keyboard_item_equal (data->orig_item, item))
-    return FALSE;
+  keys = g_ptr_array_new_with_free_func (g_free);
 
   for (l = cc_keyboard_item_get_key_combos (item); l; l = l->next)
     {
-      CcKeyCombo *combo = l->data;
+      CcKeyCombo *key;
+      GPtrArray *items;
 
-      if (data->new_mask != combo->mask)
-        continue;
+      key = g_new0 (CcKeyCombo, 1);
+      get_index_key (l->data, key);
 
-      if (data->new_keyval != 0)
-        is_conflict = data->new_keyval == combo->keyval;
-      else
-        is_conflict = combo->keyval == 0 && data->new_keycode == combo->keycode;
+      /* Disabled shortcuts never collide */
+      if (key->keyval == 0 && key->keycode == 0)
+        {
+          g_free (key);
+          continue;
+        }
 
-      if (is_conflict)
-        break;
-    }
+      items = g_hash_table_lookup (self->combo_index, key);
+      if (!items)
+        {
+          CcKeyCombo *index_key = g_new (CcKeyCombo, 1);
 
-  if (is_conflict)
-    data->conflict_item = item;
+          *index_key = *key;
+          items = g_ptr_array_new ();
+          g_hash_table_insert (self->combo_index, index_key, items);
+        }
 
-  return is_conflict;
+      g_ptr_array_add (items, item);
+      g_ptr_array_add (keys, key);
+    }
+
+  g_hash_table_insert (self->indexed_items, item, keys);
 }
 
-static gboolean
-compare_keys_for_uniqueness (CcKeyboardItem   *current_item,
-                             CcUniquenessData *data)
+static void
+unindex_item (CcKeyboardManager *self,
+              CcKeyboardItem    *item)
 {
-  CcKeyboardItem *reverse_item;
+  GPtrArray *keys;
+  guint i;
 
-  /* No conflict for: blanks or ourselves */
-  if (!current_item || data->orig_item == current_item)
-    return FALSE;
+  keys = g_hash_table_lookup (self->indexed_items, item);
+  if (!keys)
+    return;
 
-  reverse_item = cc_keyboard_item_get_reverse_item (current_item);
+  for (i = 0; i < keys->len; i++)
+    {
+      CcKeyCombo *key = g_ptr_array_index (keys, i);
+      GPtrArray *items;
 
-  /* When the current item is the reversed shortcut of a main item, simply ignore it */
-  if (reverse_item && cc_keyboard_item_is_hidden (current_item))
-    return FALSE;
+      items = g_hash_table_lookup (self->combo_index, key);
+      if (!items)
+        continue;
 
-  if (find_conflict (data, current_item))
-    return TRUE;
+      g_ptr_array_remove (items, item);
+      if (items->len == 0)
+        g_hash_table_remove (self->combo_index, key);
+    }
 
-  /* Also check for the reverse item if any */
-  if (reverse_item && find_conflict (data, reverse_item))
-    return TRUE;
+  g_hash_table_remove (self->indexed_items, item);
+}
 
-  return FALSE;
+static void
+on_item_binding_changed_cb (CcKeyboardItem    *item,
+                            GParamSpec        *pspec,
+                            CcKeyboardManager *self)
+{
+  unindex_item (self, item);
+  index_item (self, item);
 }
 
-static gboolean
-check_for_uniqueness (gpointer          key,
-                      GPtrArray        *keys_array,
-                      CcUniquenessData *data)
+static void
+track_item (CcKeyboardManager *self,
+            CcKeyboardItem    *item)
 {
-  guint i;
+  index_item (self, item);
+  g_signal_connect (item, "notify::binding", G_CALLBACK (on_item_binding_changed_cb), self);
+}
 
-  for (i = 0; i < keys_array->len; i++)
-    {
-      CcKeyboardItem *item;
+static void
+untrack_item (CcKeyboardManager *self,
+              CcKeyboardItem    *item)
+{
+  g_signal_handlers_disconnect_by_func (item, on_item_binding_changed_cb, self);
+  unindex_item (self, item);
+}
 
-      item = keys_array->pdata[i];
+static void
+untrack_all_items (CcKeyboardManager *self)
+{
+  GHashTableIter iter;
+  CcKeyboardItem *item;
 
-      if (compare_keys_for_uniqueness (item, data))
-        return TRUE;
-    }
+  g_hash_table_iter_init (&iter, self->indexed_items);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &item, NULL))
+    g_signal_handlers_disconnect_by_func (item, on_item_binding_changed_cb, self);
 
-  return FALSE;
+  g_hash_table_remove_all (self->indexed_items);
+  g_hash_table_remove_all (self->combo_index);
 }
 
+static gboolean
+is_collision (CcKeyboardItem *item,
+              CcKeyboardItem *other)
+{
+  CcKeyboardItem *reverse_item;
+
+  /* No conflict with ourselves */
+  if (item == other)
+    return FALSE;
+
+  if (item && cc_keyboard_item_equal (item, other))
+    return FALSE;
+
+  /* A hidden reversed shortcut belongs to its main item */
+  reverse_item = cc_keyboard_item_get_reverse_item (other);
+  if (item && reverse_item == item && cc_keyboard_item_is_hidden (other))
+    return FALSE;
+
+  return TRUE;
+}
 
 static GHashTable*
 get_hash_for_group (CcKeyboardManager *self,
@@ -365,6 +453,7 @@ append_section (CcKeyboardManager  *self,
       cc_keyboard_item_set_model (item, shortcut_model, group);
 
       g_ptr_array_add (keys_array, item);
+      track_item (self, item);
     }
 
   g_hash_table_destroy (reverse_items);
@@ -529,6 +618,8 @@ reload_sections (CcKeyboardManager *self)
   gtk_list_store_clear (GTK_LIST_STORE (self->sections_store));
   gtk_list_store_clear (GTK_LIST_STORE (shortcut_model));
 
+  untrack_all_items (self);
+
   g_clear_pointer (&self->kb_system_sections, g_hash_table_destroy);
   self->kb_system_sections = g_hash_table_new_full (g_str_hash,
                                                     g_str_equal,
@@ -611,6 +702,9 @@ cc_keyboard_manager_finalize (GObject *object)
 {
   CcKeyboardManager *self = (CcKeyboardManager *)object;
 
+  untrack_all_items (self);
+  g_clear_pointer (&self->combo_index, g_hash_table_destroy);
+  g_clear_pointer (&self->indexed_items, g_hash_table_destroy);
   g_clear_pointer (&self->kb_system_sections, g_hash_table_destroy);
   g_clear_pointer (&self->kb_apps_sections, g_hash_table_destroy);
   g_clear_pointer (&self->kb_user_sections, g_hash_table_destroy);
@@ -697,6 +791,15 @@ cc_keyboard_manager_init (CcKeyboardManager *self)
   /* Bindings */
   self->binding_settings = g_settings_new (BINDINGS_SCHEMA);
 
+  self->combo_index = g_hash_table_new_full (combo_hash,
+                                             combo_equal,
+                                             g_free,
+                                             (GDestroyNotify) g_ptr_array_unref);
+  self->indexed_items = g_hash_table_new_full (NULL,
+                                               NULL,
+                                               NULL,
+                                               (GDestroyNotify) g_ptr_array_unref);
+
   /* Setup the section models */
   self->sections_store = gtk_list_store_new (SECTION_N_COLUMNS,
                                              G_TYPE_STRING,
@@ -787,6 +890,7 @@ cc_keyboard_manager_add_custom_shortcut (CcKeyboardManager *self,
     }
 
   g_ptr_array_add (keys_array, item);
+  track_item (self, item);
 
   gtk_list_store_append (self->shortcuts_model, &iter);
   gtk_list_store_set (self->shortcuts_model, &iter, DETAIL_KEYENTRY_COLUMN, item, -1);
@@ -875,6 +979,7 @@ cc_keyboard_manager_remove_custom_shortcut  (CcKeyboardManager *self,
   g_strfreev (settings_paths);
 
   keys_array = g_hash_table_lookup (get_hash_for_group (self, BINDING_GROUP_USER), CUSTOM_SHORTCUTS_ID);
+  untrack_item (self, item);
   g_ptr_array_remove (keys_array, item);
 
   gtk_list_store_remove (GTK_LIST_STORE (model), &iter);
@@ -897,34 +1002,31 @@ cc_keyboard_manager_get_collision (CcKeyboardManager *self,
                                    CcKeyboardItem    *item,
                                    CcKeyCombo        *combo)
 {
-  CcUniquenessData data;
-  BindingGroupType i;
+  CcKeyCombo key;
+  GPtrArray *items;
+  guint i;
 
   g_return_val_if_fail (CC_IS_KEYBOARD_MANAGER (self), NULL);
 
-  data.orig_item = item;
-  data.new_keyval = combo->keyval;
-  data.new_mask = combo->mask;
-  data.new_keycode = combo->keycode;
-  data.conflict_item = NULL;
-
+  /* Any number of shortcuts can be disabled */
   if (combo->keyval == 0 && combo->keycode == 0)
     return NULL;
 
-  /* Any number of shortcuts can be disabled */
-  for (i = BINDING_GROUP_SYSTEM; i <= BINDING_GROUP_USER && !data.conflict_item; i++)
-    {
-      GHashTable *table;
+  get_index_key (combo, &key);
 
-      table = get_hash_for_group (self, i);
+  items = g_hash_table_lookup (self->combo_index, &key);
+  if (!items)
+    return NULL;
 
-      if (!table)
-        continue;
+  for (i = 0; i < items->len; i++)
+    {
+      CcKeyboardItem *other = g_ptr_array_index (items, i);
 
-      g_hash_table_find (table, (GHRFunc) check_for_uniqueness, &data);
+      if (is_collision (item, other))
+        return other;
     }
 
-  return data.conflict_item;
+  return NULL;
 }
 
 /**
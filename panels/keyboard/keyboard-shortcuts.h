@@ -49,14 +49,6 @@ typedef struct
   gboolean hidden;
 } KeyListEntry;
 
-typedef struct {
-  CcKeyboardItem *orig_item;
-  CcKeyboardItem *conflict_item;
-  guint new_keyval;
-  GdkModifierType new_mask;
-  guint new_keycode;
-} CcUniquenessData;
-
 typedef enum
 {
   SHORTCUT_TYPE_KEY_ENTRY,
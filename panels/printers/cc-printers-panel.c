@@ -54,6 +54,10 @@
 
 #define CUPS_STATUS_CHECK_INTERVAL 5
 
+/* Time in milliseconds during which CUPS notifications are coalesced
+ * into a single update of the printers list */
+#define PRINTERS_LIST_UPDATE_DELAY 250
+
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
 #endif
@@ -89,6 +93,7 @@ struct _CcPrintersPanel
   guint            cups_status_check_id;
   guint            dbus_subscription_id;
   guint            remove_printer_timeout_id;
+  guint            printers_list_update_id;
 
   GtkRevealer  *notification;
   PPDList      *all_ppds_list;
@@ -103,7 +108,11 @@ struct _CcPrintersPanel
   gchar    *deleted_printer_name;
 
   GHashTable *printer_entries;
+  GHashTable *printer_signatures;
+  gboolean    entries_authorized;
   gboolean    entries_filled;
+  gboolean    getting_dests;
+  gboolean    dests_outdated;
   GVariant   *action;
 
   GtkSizeGroup *size_group;
@@ -125,6 +134,7 @@ enum {
 };
 
 static void actualize_printers_list (CcPrintersPanel *self);
+static void queue_actualize_printers_list (CcPrintersPanel *self);
 static void update_sensitivity (gpointer user_data);
 static void detach_from_cups_notifier (gpointer data);
 static void free_dests (CcPrintersPanel *self);
@@ -290,9 +300,11 @@ cc_printers_panel_dispose (GObject *object)
   g_clear_object (&self->permission);
   g_clear_handle_id (&self->cups_status_check_id, g_source_remove);
   g_clear_handle_id (&self->remove_printer_timeout_id, g_source_remove);
+  g_clear_handle_id (&self->printers_list_update_id, g_source_remove);
   g_clear_pointer (&self->deleted_printer_name, g_free);
   g_clear_pointer (&self->action, g_variant_unref);
   g_clear_pointer (&self->printer_entries, g_hash_table_destroy);
+  g_clear_pointer (&self->printer_signatures, g_hash_table_destroy);
   g_clear_pointer (&self->all_ppds_list, ppd_list_free);
   free_dests (self);
 
@@ -444,7 +456,7 @@ on_cups_notification (GDBusConnection *connection,
       g_strcmp0 (signal_name, "PrinterDeleted") == 0 ||
       g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
       g_strcmp0 (signal_name, "PrinterStopped") == 0)
-    actualize_printers_list (self);
+    queue_actualize_printers_list (self);
   else if (g_strcmp0 (signal_name, "JobCreated") == 0 ||
            g_strcmp0 (signal_name, "JobCompleted") == 0)
     {
@@ -723,12 +735,46 @@ static void
 on_printer_changed (PpPrinterEntry *printer_entry,
                     gpointer        user_data)
 {
-  actualize_printers_list (user_data);
+  queue_actualize_printers_list (user_data);
+}
+
+/* Everything a PpPrinterEntry is built from, so that entries only
+ * need to be recreated when their printer really changed */
+static gchar *
+get_dest_signature (cups_dest_t *dest)
+{
+  GString *signature;
+  int      i;
+
+  signature = g_string_new (dest->instance);
+  g_string_append_printf (signature, "\x1f%d", dest->is_default);
+
+  for (i = 0; i < dest->num_options; i++)
+    g_string_append_printf (signature, "\x1f%s=%s",
+                            dest->options[i].name,
+                            dest->options[i].value);
+
+  return g_string_free (signature, FALSE);
+}
+
+static void
+remove_printer_entry (CcPrintersPanel *self,
+                      const gchar     *printer_name)
+{
+  GtkWidget *printer_entry;
+
+  printer_entry = g_hash_table_lookup (self->printer_entries, printer_name);
+  if (printer_entry != NULL)
+    gtk_widget_destroy (printer_entry);
+
+  g_hash_table_remove (self->printer_entries, printer_name);
+  g_hash_table_remove (self->printer_signatures, printer_name);
 }
 
 static void
 add_printer_entry (CcPrintersPanel *self,
-                   cups_dest_t      printer)
+                   cups_dest_t      printer,
+                   gint             position)
 {
   PpPrinterEntry         *printer_entry;
   GtkWidget              *content;
@@ -756,10 +802,11 @@ add_printer_entry (CcPrintersPanel *self,
                     G_CALLBACK (on_printer_renamed),
                     self);
 
-  gtk_list_box_insert (GTK_LIST_BOX (content), GTK_WIDGET (printer_entry), -1);
-  gtk_widget_show_all (content);
+  gtk_list_box_insert (GTK_LIST_BOX (content), GTK_WIDGET (printer_entry), position);
+  gtk_widget_show_all (GTK_WIDGET (printer_entry));
 
   g_hash_table_insert (self->printer_entries, g_strdup (printer.name), printer_entry);
+  g_hash_table_insert (self->printer_signatures, g_strdup (printer.name), get_dest_signature (&printer));
 }
 
 static void
@@ -794,7 +841,12 @@ actualize_printers_list_cb (GObject      *source_object,
   PpCups                 *cups = PP_CUPS (source_object);
   PpCupsDests            *cups_dests;
   gboolean                new_printer_available = FALSE;
+  g_autoptr(GHashTable)   visible_printers = NULL;
+  g_autoptr(GPtrArray)    removed_printers = NULL;
+  GHashTableIter          iter;
+  gpointer                key;
   g_autoptr(GError)       error = NULL;
+  gint                    position;
   int                     i;
 
   cups_dests = pp_cups_get_dests_finish (cups, result, &error);
@@ -804,12 +856,22 @@ actualize_printers_list_cb (GObject      *source_object,
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         {
           g_warning ("Could not get dests: %s", error->message);
+          self->getting_dests = FALSE;
+
+          /* A refresh was requested while this one was running */
+          if (self->dests_outdated)
+            {
+              self->dests_outdated = FALSE;
+              actualize_printers_list (self);
+            }
         }
 
       g_object_unref (cups);
       return;
     }
 
+  self->getting_dests = FALSE;
+
   free_dests (self);
   self->dests = cups_dests->dests;
   self->num_dests = cups_dests->num_of_dests;
@@ -821,9 +883,6 @@ actualize_printers_list_cb (GObject      *source_object,
   else
     gtk_stack_set_visible_child_name (GTK_STACK (widget), "printers-list");
 
-  widget = (GtkWidget*) gtk_builder_get_object (self->builder, "content");
-  gtk_container_foreach (GTK_CONTAINER (widget), (GtkCallback) gtk_widget_destroy, NULL);
-
   for (i = 0; i < self->num_dests; i++)
     {
       new_printer_available = g_strcmp0 (self->dests[i].name, self->renamed_printer_name) == 0;
@@ -831,6 +890,7 @@ actualize_printers_list_cb (GObject      *source_object,
         break;
     }
 
+  visible_printers = g_hash_table_new (g_str_hash, g_str_equal);
   for (i = 0; i < self->num_dests; i++)
     {
       if (g_strcmp0 (self->dests[i].name, self->deleted_printer_name) == 0)
@@ -839,7 +899,59 @@ actualize_printers_list_cb (GObject      *source_object,
       if (new_printer_available && g_strcmp0 (self->dests[i].name, self->old_printer_name) == 0)
           continue;
 
-      add_printer_entry (self, self->dests[i]);
+      g_hash_table_add (visible_printers, self->dests[i].name);
+    }
+
+  /* Entries are created with the authorization state of the time */
+  if (self->entries_authorized != self->is_authorized)
+    {
+      widget = (GtkWidget*) gtk_builder_get_object (self->builder, "content");
+      gtk_container_foreach (GTK_CONTAINER (widget), (GtkCallback) gtk_widget_destroy, NULL);
+      g_hash_table_remove_all (self->printer_entries);
+      g_hash_table_remove_all (self->printer_signatures);
+
+      self->entries_authorized = self->is_authorized;
+    }
+
+  /* Drop the entries of printers which went away... */
+  removed_printers = g_ptr_array_new_with_free_func (g_free);
+  g_hash_table_iter_init (&iter, self->printer_entries);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (!g_hash_table_contains (visible_printers, key))
+        g_ptr_array_add (removed_printers, g_strdup (key));
+    }
+
+  for (i = 0; i < removed_printers->len; i++)
+    remove_printer_entry (self, g_ptr_array_index (removed_printers, i));
+
+  /* ...and only recreate the ones which changed, keeping the order of the dests */
+  position = 0;
+  for (i = 0; i < self->num_dests; i++)
+    {
+      GtkWidget        *printer_entry;
+      g_autofree gchar *signature = NULL;
+
+      if (!g_hash_table_contains (visible_printers, self->dests[i].name))
+        continue;
+
+      printer_entry = g_hash_table_lookup (self->printer_entries, self->dests[i].name);
+      if (printer_entry != NULL)
+        {
+          signature = get_dest_signature (&self->dests[i]);
+          if (g_strcmp0 (signature, g_hash_table_lookup (self->printer_signatures, self->dests[i].name)) == 0)
+            {
+              /* It could have been hidden by a deletion which was undone */
+              gtk_widget_show (printer_entry);
+              position++;
+              continue;
+            }
+
+          remove_printer_entry (self, self->dests[i].name);
+        }
+
+      add_printer_entry (self, self->dests[i], position);
+      position++;
     }
 
   if (!self->entries_filled)
@@ -857,6 +969,13 @@ actualize_printers_list_cb (GObject      *source_object,
   update_sensitivity (user_data);
 
   g_object_unref (cups);
+
+  /* Notifications arrived while we were getting the dests */
+  if (self->dests_outdated)
+    {
+      self->dests_outdated = FALSE;
+      actualize_printers_list (self);
+    }
 }
 
 static void
@@ -864,6 +983,16 @@ actualize_printers_list (CcPrintersPanel *self)
 {
   PpCups                 *cups;
 
+  g_clear_handle_id (&self->printers_list_update_id, g_source_remove);
+
+  if (self->getting_dests)
+    {
+      self->dests_outdated = TRUE;
+      return;
+    }
+
+  self->getting_dests = TRUE;
+
   cups = pp_cups_new ();
   pp_cups_get_dests_async (cups,
                            cc_panel_get_cancellable (CC_PANEL (self)),
@@ -871,6 +1000,29 @@ actualize_printers_list (CcPrintersPanel *self)
                            self);
 }
 
+static gboolean
+printers_list_update_timeout_cb (gpointer user_data)
+{
+  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
+
+  self->printers_list_update_id = 0;
+  actualize_printers_list (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Coalesces bursts of printer notifications into a single update */
+static void
+queue_actualize_printers_list (CcPrintersPanel *self)
+{
+  if (self->printers_list_update_id != 0)
+    return;
+
+  self->printers_list_update_id = g_timeout_add (PRINTERS_LIST_UPDATE_DELAY,
+                                                 printers_list_update_timeout_cb,
+                                                 self);
+}
+
 static void
 new_printer_dialog_pre_response_cb (PpNewPrinterDialog *dialog,
                                     const gchar        *device_name,
@@ -1197,6 +1349,11 @@ cc_printers_panel_init (CcPrintersPanel *self)
                                                  g_str_equal,
                                                  g_free,
                                                  NULL);
+  self->printer_signatures = g_hash_table_new_full (g_str_hash,
+                                                    g_str_equal,
+                                                    g_free,
+                                                    g_free);
+  self->entries_authorized = FALSE;
   self->entries_filled = FALSE;
   self->action = NULL;
 
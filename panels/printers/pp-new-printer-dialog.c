@@ -2145,11 +2145,17 @@ new_printer_dialog_response_cb (GtkDialog *dialog,
               acquisition_method == ACQUISITION_METHOD_JETDIRECT ||
               acquisition_method == ACQUISITION_METHOD_LPD)
             {
+              PPDManufacturerItem *manufacturer;
+
+              /* Preselect the manufacturer of the device if it is known */
+              manufacturer = ppd_list_get_manufacturer_for_device_id (self->list,
+                                                                      pp_print_device_get_device_id (device));
+
               self->new_device = pp_print_device_copy (device);
               self->ppd_selection_dialog =
                 pp_ppd_selection_dialog_new (self->parent,
                                              self->list,
-                                             NULL,
+                                             manufacturer != NULL ? manufacturer->manufacturer_display_name : NULL,
                                              ppd_selection_cb,
                                              self);
             }
@@ -75,8 +75,9 @@ manufacturer_selection_changed_cb (GtkTreeSelection *selection,
   GtkTreeModel         *model;
   GtkTreeIter           iter;
   GtkTreeView          *models_treeview;
+  PPDManufacturerItem  *manufacturer;
   gchar                *manufacturer_name = NULL;
-  gint                  i, index;
+  gint                  i;
 
   if (gtk_tree_selection_get_selected (selection, &model, &iter))
     {
@@ -87,31 +88,20 @@ manufacturer_selection_changed_cb (GtkTreeSelection *selection,
 
   if (manufacturer_name)
     {
-      index = -1;
-      for (i = 0; i < self->list->num_of_manufacturers; i++)
-        {
-          if (g_strcmp0 (manufacturer_name,
-                         self->list->manufacturers[i]->manufacturer_name) == 0)
-            {
-              index = i;
-              break;
-            }
-        }
-
-      if (index >= 0)
+      manufacturer = ppd_list_get_manufacturer (self->list, manufacturer_name);
+      if (manufacturer != NULL)
         {
           models_treeview = (GtkTreeView*)
             gtk_builder_get_object (self->builder, "ppd-selection-models-treeview");
 
           store = gtk_list_store_new (2, G_TYPE_STRING, G_TYPE_STRING);
 
-          for (i = 0; i < self->list->manufacturers[index]->num_of_ppds; i++)
+          for (i = 0; i < manufacturer->num_of_ppds; i++)
             {
-              gtk_list_store_append (store, &iter);
-              gtk_list_store_set (store, &iter,
-                                  PPD_NAMES_COLUMN, self->list->manufacturers[index]->ppds[i]->ppd_name,
-                                  PPD_DISPLAY_NAMES_COLUMN, self->list->manufacturers[index]->ppds[i]->ppd_display_name,
-                                  -1);
+              gtk_list_store_insert_with_values (store, NULL, -1,
+                                                 PPD_NAMES_COLUMN, manufacturer->ppds[i]->ppd_name,
+                                                 PPD_DISPLAY_NAMES_COLUMN, manufacturer->ppds[i]->ppd_display_name,
+                                                 -1);
             }
 
           gtk_tree_view_set_model (models_treeview, GTK_TREE_MODEL (store));
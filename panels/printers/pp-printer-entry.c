@@ -793,7 +793,7 @@ pp_printer_entry_new (cups_dest_t  printer,
   for (i = 0; i < printer.num_options; i++)
     {
       if (g_strcmp0 (printer.options[i].name, "device-uri") == 0)
-        self->printer_uri = printer.options[i].value;
+        self->printer_uri = g_strdup (printer.options[i].value);
       else if (g_strcmp0 (printer.options[i].name, "printer-uri-supported") == 0)
         printer_uri = printer.options[i].value;
       else if (g_strcmp0 (printer.options[i].name, "printer-type") == 0)
@@ -968,6 +968,7 @@ pp_printer_entry_dispose (GObject *object)
   g_cancellable_cancel (self->check_clean_heads_cancellable);
 
   g_clear_pointer (&self->printer_name, g_free);
+  g_clear_pointer (&self->printer_uri, g_free);
   g_clear_pointer (&self->printer_location, g_free);
   g_clear_pointer (&self->printer_make_and_model, g_free);
   g_clear_pointer (&self->printer_hostname, g_free);
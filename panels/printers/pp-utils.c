@@ -22,6 +22,8 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
+#include <sys/stat.h>
+#include <dirent.h>
 #include <gtk/gtk.h>
 #include <cups/cups.h>
 #include <cups/ppd.h>
@@ -2604,6 +2606,292 @@ static const struct {
   { "zebra", "Zebra" },
 };
 
+/*
+ * The list of all PPDs is cached on disk, as getting it from CUPS can
+ * take seconds when tens of thousands of PPDs are installed. The cache
+ * is invalidated whenever a directory CUPS looks for PPDs in, at any
+ * depth, a driver program or the PPD database of CUPS changes. Driver
+ * programs can list different PPDs without changing themselves, so the
+ * cache also expires after a while. Bump the version whenever the format
+ * of the cache changes.
+ */
+#define PPD_CACHE_VERSION 2
+#define PPD_CACHE_VARIANT_TYPE "(usxa(sx)a(ssa(ss)))"
+#define PPD_CACHE_MAX_AGE (G_TIME_SPAN_DAY)
+#define PPD_SOURCES_MAX_DEPTH 8
+
+#define CUPS_PPD_DATABASE "/var/cache/cups/ppds.dat"
+
+static const gchar *ppd_directories[] = {
+  "/usr/share/cups/model",
+  "/usr/share/cups/drv",
+  "/usr/share/ppd",
+  "/usr/local/share/ppd",
+  "/opt/share/ppd",
+};
+
+static const gchar *driver_directories[] = {
+  "/usr/lib/cups/driver",
+  "/usr/libexec/cups/driver",
+};
+
+static gchar *
+get_ppds_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "ppds.cache", NULL);
+}
+
+static gboolean
+cups_server_is_local (const gchar *cups_server)
+{
+  return cups_server == NULL ||
+         cups_server[0] == '/' ||
+         g_ascii_strncasecmp (cups_server, "localhost", 9) == 0 ||
+         g_ascii_strncasecmp (cups_server, "127.0.0.1", 9) == 0 ||
+         g_ascii_strncasecmp (cups_server, "::1", 3) == 0;
+}
+
+static void
+add_ppd_source (GVariantBuilder *builder,
+                const gchar     *path,
+                GStatBuf        *buf)
+{
+  g_variant_builder_add (builder, "(sx)", path, (gint64) buf->st_mtime);
+}
+
+/*
+ * Adds the modification times of @path and of all the directories below
+ * it, as installing, removing or replacing a PPD changes the directory
+ * it is in. With @add_files, the files are added too, which is what
+ * matters for driver programs.
+ */
+static void
+add_ppd_sources_recursively (GVariantBuilder *builder,
+                             const gchar     *path,
+                             gboolean         add_files,
+                             gint             depth)
+{
+  struct dirent *entry;
+  GStatBuf       buf;
+  DIR           *dir;
+
+  /* Don't follow symlinks to directories, which could loop */
+  if (g_lstat (path, &buf) != 0 || !S_ISDIR (buf.st_mode))
+    return;
+
+  add_ppd_source (builder, path, &buf);
+
+  if (depth >= PPD_SOURCES_MAX_DEPTH)
+    return;
+
+  dir = opendir (path);
+  if (dir == NULL)
+    return;
+
+  while ((entry = readdir (dir)) != NULL)
+    {
+      g_autofree gchar *child = NULL;
+      gboolean          is_dir;
+
+      if (g_str_equal (entry->d_name, ".") || g_str_equal (entry->d_name, ".."))
+        continue;
+
+      /* The directories holding PPD files can be large, so only
+       * the entries whose type the file system doesn't tell are
+       * looked up, and plain files are skipped without a syscall */
+#ifdef _DIRENT_HAVE_D_TYPE
+      if (entry->d_type != DT_UNKNOWN)
+        {
+          is_dir = entry->d_type == DT_DIR;
+        }
+      else
+#endif
+        {
+          child = g_build_filename (path, entry->d_name, NULL);
+          if (g_lstat (child, &buf) != 0)
+            continue;
+          is_dir = S_ISDIR (buf.st_mode);
+        }
+
+      if (!is_dir && !add_files)
+        continue;
+
+      if (child == NULL)
+        child = g_build_filename (path, entry->d_name, NULL);
+
+      if (is_dir)
+        add_ppd_sources_recursively (builder, child, add_files, depth + 1);
+      else if (g_stat (child, &buf) == 0)
+        add_ppd_source (builder, child, &buf);
+    }
+
+  closedir (dir);
+}
+
+static GVariant *
+get_ppd_sources (void)
+{
+  GVariantBuilder builder;
+  GStatBuf        buf;
+  gint            i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sx)"));
+
+  /* Only readable when the user is allowed to, which is fine */
+  if (g_stat (CUPS_PPD_DATABASE, &buf) == 0)
+    add_ppd_source (&builder, CUPS_PPD_DATABASE, &buf);
+
+  for (i = 0; i < G_N_ELEMENTS (ppd_directories); i++)
+    add_ppd_sources_recursively (&builder, ppd_directories[i], FALSE, 0);
+
+  for (i = 0; i < G_N_ELEMENTS (driver_directories); i++)
+    add_ppd_sources_recursively (&builder, driver_directories[i], TRUE, 0);
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static PPDList *
+ppd_list_new_from_variant (GVariant *manufacturers)
+{
+  PPDList *result;
+  gsize    i, j;
+
+  result = g_new0 (PPDList, 1);
+  result->num_of_manufacturers = g_variant_n_children (manufacturers);
+  result->manufacturers = g_new0 (PPDManufacturerItem *, result->num_of_manufacturers);
+
+  for (i = 0; i < result->num_of_manufacturers; i++)
+    {
+      g_autoptr(GVariant) ppds = NULL;
+      PPDManufacturerItem *item;
+
+      item = g_new0 (PPDManufacturerItem, 1);
+      g_variant_get_child (manufacturers, i, "(ss@a(ss))",
+                           &item->manufacturer_name,
+                           &item->manufacturer_display_name,
+                           &ppds);
+
+      item->num_of_ppds = g_variant_n_children (ppds);
+      item->ppds = g_new0 (PPDName *, item->num_of_ppds);
+
+      for (j = 0; j < item->num_of_ppds; j++)
+        {
+          item->ppds[j] = g_new0 (PPDName, 1);
+          g_variant_get_child (ppds, j, "(ss)",
+                               &item->ppds[j]->ppd_name,
+                               &item->ppds[j]->ppd_display_name);
+          item->ppds[j]->ppd_match_level = -1;
+        }
+
+      result->manufacturers[i] = item;
+    }
+
+  return result;
+}
+
+static GVariant *
+ppd_list_to_variant (PPDList *list)
+{
+  GVariantBuilder builder;
+  gsize           i, j;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssa(ss))"));
+
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *item = list->manufacturers[i];
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("(ssa(ss))"));
+      g_variant_builder_add (&builder, "s", item->manufacturer_name);
+      g_variant_builder_add (&builder, "s", item->manufacturer_display_name);
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+
+      for (j = 0; j < item->num_of_ppds; j++)
+        g_variant_builder_add (&builder, "(ss)",
+                               item->ppds[j]->ppd_name,
+                               item->ppds[j]->ppd_display_name);
+
+      g_variant_builder_close (&builder);
+      g_variant_builder_close (&builder);
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static PPDList *
+load_ppds_cache (const gchar *cups_server,
+                 GVariant    *sources)
+{
+  g_autoptr(GVariant)    cached_sources = NULL;
+  g_autoptr(GVariant)    manufacturers = NULL;
+  g_autoptr(GMappedFile) mapped_file = NULL;
+  g_autoptr(GVariant)    cache = NULL;
+  g_autoptr(GBytes)      bytes = NULL;
+  g_autofree gchar      *path = NULL;
+  const gchar           *cached_server;
+  guint32                version;
+  gint64                 timestamp;
+
+  path = get_ppds_cache_path ();
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (PPD_CACHE_VARIANT_TYPE), bytes, FALSE));
+
+  /* Check the version before the rest, whose type could differ */
+  g_variant_get_child (cache, 0, "u", &version);
+  if (version != PPD_CACHE_VERSION)
+    {
+      g_debug ("Ignoring PPD cache with version %u", version);
+      return NULL;
+    }
+
+  g_variant_get (cache, "(u&sx@a(sx)@a(ssa(ss)))", &version, &cached_server, &timestamp, &cached_sources, &manufacturers);
+
+  if (g_strcmp0 (cached_server, cups_server != NULL ? cups_server : "") != 0 ||
+      g_get_real_time () - timestamp > PPD_CACHE_MAX_AGE ||
+      g_get_real_time () < timestamp ||
+      !g_variant_equal (cached_sources, sources))
+    {
+      g_debug ("PPD cache is out of date");
+      return NULL;
+    }
+
+  return ppd_list_new_from_variant (manufacturers);
+}
+
+static void
+save_ppds_cache (PPDList     *list,
+                 const gchar *cups_server,
+                 GVariant    *sources)
+{
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GError)   error = NULL;
+  g_autofree gchar   *path = NULL;
+  g_autofree gchar   *dir = NULL;
+
+  cache = g_variant_ref_sink (g_variant_new ("(usx@a(sx)@a(ssa(ss)))",
+                                             PPD_CACHE_VERSION,
+                                             cups_server != NULL ? cups_server : "",
+                                             g_get_real_time (),
+                                             sources,
+                                             ppd_list_to_variant (list)));
+
+  path = get_ppds_cache_path ();
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  if (!g_file_set_contents (path,
+                            g_variant_get_data (cache),
+                            g_variant_get_size (cache),
+                            &error))
+    {
+      g_debug ("Failed to write the PPD cache: %s", error->message);
+    }
+}
+
 static gpointer
 get_all_ppds_func (gpointer user_data)
 {
@@ -2616,9 +2904,35 @@ get_all_ppds_func (gpointer user_data)
   ipp_t           *response;
   GList           *list;
   gchar           *manufacturer_display_name;
+  g_autoptr(GVariant) sources = NULL;
+  const gchar     *cups_server;
   gint             i, j;
+  static const char * const requested_attributes[] = {
+    "ppd-device-id",
+    "ppd-make-and-model",
+    "ppd-name",
+    "ppd-product",
+    "ppd-make" };
+
+  /* Sources are checked before querying CUPS, so that changes happening
+   * in the meantime invalidate the cache we are going to write. */
+  cups_server = cupsServer ();
+  if (cups_server_is_local (cups_server))
+    {
+      sources = get_ppd_sources ();
+
+      data->result = load_ppds_cache (cups_server, sources);
+      if (data->result != NULL)
+        {
+          get_all_ppds_cb (data);
+          return NULL;
+        }
+    }
 
   request = ippNewRequest (CUPS_GET_PPDS);
+  ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", G_N_ELEMENTS (requested_attributes),
+                 NULL, requested_attributes);
   response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
 
   if (response &&
@@ -2816,6 +3130,9 @@ get_all_ppds_func (gpointer user_data)
       g_list_free_full (sort_list, g_free);
       g_hash_table_destroy (ppds_hash);
       g_hash_table_destroy (manufacturers_hash);
+
+      if (sources != NULL)
+        save_ppds_cache (data->result, cups_server, sources);
     }
 
   get_all_ppds_cb (data);
@@ -2930,6 +3247,73 @@ ppd_list_free (PPDList *list)
     }
 }
 
+/*
+ * Manufacturers are sorted by their normalized names,
+ * so they can be looked up with a binary search.
+ */
+PPDManufacturerItem *
+ppd_list_get_manufacturer (PPDList     *list,
+                           const gchar *manufacturer_name)
+{
+  gsize low = 0, high;
+
+  if (list == NULL || manufacturer_name == NULL)
+    return NULL;
+
+  high = list->num_of_manufacturers;
+  while (low < high)
+    {
+      gsize mid = low + (high - low) / 2;
+      gint  cmp;
+
+      cmp = g_strcmp0 (manufacturer_name, list->manufacturers[mid]->manufacturer_name);
+      if (cmp == 0)
+        return list->manufacturers[mid];
+      else if (cmp < 0)
+        high = mid;
+      else
+        low = mid + 1;
+    }
+
+  return NULL;
+}
+
+/*
+ * Finds the manufacturer of the device with given IEEE 1284 Device ID,
+ * mapping its name the same way get_all_ppds_async() does.
+ */
+PPDManufacturerItem *
+ppd_list_get_manufacturer_for_device_id (PPDList     *list,
+                                         const gchar *device_id)
+{
+  g_autofree gchar *mfg = NULL;
+  g_autofree gchar *mfg_normalized = NULL;
+  gint              i;
+
+  if (list == NULL || device_id == NULL || device_id[0] == '\0')
+    return NULL;
+
+  mfg = get_tag_value (device_id, "mfg");
+  if (mfg == NULL)
+    mfg = get_tag_value (device_id, "manufacturer");
+  if (mfg == NULL)
+    return NULL;
+
+  mfg_normalized = normalize (mfg);
+
+  for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
+    {
+      if (g_strcmp0 (manufacturers_names[i].normalized_name, mfg_normalized) == 0)
+        {
+          g_free (mfg_normalized);
+          mfg_normalized = normalize (manufacturers_names[i].display_name);
+          break;
+        }
+    }
+
+  return ppd_list_get_manufacturer (list, mfg_normalized);
+}
+
 gchar *
 get_standard_manufacturers_name (const gchar *name)
 {
@@ -175,6 +175,12 @@ void        get_all_ppds_async (GCancellable *cancellable,
 PPDList    *ppd_list_copy (PPDList *list);
 void        ppd_list_free (PPDList *list);
 
+PPDManufacturerItem *ppd_list_get_manufacturer (PPDList     *list,
+                                                const gchar *manufacturer_name);
+
+PPDManufacturerItem *ppd_list_get_manufacturer_for_device_id (PPDList     *list,
+                                                              const gchar *device_id);
+
 enum
 {
   IPP_ATTRIBUTE_TYPE_INTEGER = 0,
@@ -30,6 +30,7 @@
 
 #include "list-box-helper.h"
 #include "cc-common-language.h"
+#include "cc-search-table.h"
 #include "cc-util.h"
 
 #define GNOME_DESKTOP_USE_UNSTABLE_API
@@ -63,7 +64,10 @@ struct _CcFormatChooser {
         gboolean no_results;
         gchar *region;
         gchar *preview_region;
-        gchar **filter_words;
+        CcSearchTable *search_table;
+        /* The rows matching the search, or NULL if there is no search */
+        GHashTable *search_matches;
+        GCancellable *cancellable;
 };
 
 G_DEFINE_TYPE (CcFormatChooser, cc_format_chooser, HDY_TYPE_DIALOG)
@@ -371,6 +375,19 @@ region_widget_new (CcFormatChooser *self,
         return row;
 }
 
+static void
+add_to_search_table (CcFormatChooser *chooser,
+                     GtkWidget       *row)
+{
+        const gchar *strings[] = {
+                g_object_get_data (G_OBJECT (row), "locale-name"),
+                g_object_get_data (G_OBJECT (row), "locale-current-name"),
+                g_object_get_data (G_OBJECT (row), "locale-untranslated-name"),
+        };
+
+        cc_search_table_add (chooser->search_table, row, strings, G_N_ELEMENTS (strings));
+}
+
 static void
 add_regions (CcFormatChooser *chooser,
              gchar          **locale_ids,
@@ -410,6 +427,7 @@ add_regions (CcFormatChooser *chooser,
                 if (!widget)
                   continue;
 
+                add_to_search_table (chooser, widget);
                 gtk_widget_show (widget);
                 gtk_container_add (GTK_CONTAINER (chooser->region_listbox), widget);
         }
@@ -428,48 +446,16 @@ add_all_regions (CcFormatChooser *chooser)
         add_regions (chooser, locale_ids, initial);
 }
 
-static gboolean
-match_all (gchar       **words,
-           const gchar  *str)
-{
-        gchar **w;
-
-        for (w = words; *w; ++w)
-                if (!strstr (str, *w))
-                        return FALSE;
-
-        return TRUE;
-}
-
 static gboolean
 region_visible (GtkListBoxRow *row,
                 gpointer   user_data)
 {
         CcFormatChooser *chooser = user_data;
-        g_autofree gchar *locale_name = NULL;
-        g_autofree gchar *locale_current_name = NULL;
-        g_autofree gchar *locale_untranslated_name = NULL;
-        gboolean match = TRUE;
-
-        if (!chooser->filter_words)
-          goto end;
+        gboolean match;
 
-        locale_name =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "locale-name"));
-        if (match_all (chooser->filter_words, locale_name))
-          goto end;
+        match = !chooser->search_matches ||
+                g_hash_table_contains (chooser->search_matches, row);
 
-        locale_current_name =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "locale-current-name"));
-        if (match_all (chooser->filter_words, locale_current_name))
-          goto end;
-
-        locale_untranslated_name =
-                cc_util_normalize_casefold_and_unaccent (g_object_get_data (G_OBJECT (row), "locale-untranslated-name"));
-
-        match = match_all (chooser->filter_words, locale_untranslated_name);
-
- end:
         if (match)
           chooser->no_results = FALSE;
         return match;
@@ -481,7 +467,7 @@ filter_changed (CcFormatChooser *chooser)
         g_autofree gchar *filter_contents = NULL;
         gboolean visible;
 
-        g_clear_pointer (&chooser->filter_words, g_strfreev);
+        g_clear_pointer (&chooser->search_matches, g_hash_table_unref);
 
         filter_contents =
                 cc_util_normalize_casefold_and_unaccent (gtk_entry_get_text (GTK_ENTRY (chooser->region_filter_entry)));
@@ -500,7 +486,12 @@ filter_changed (CcFormatChooser *chooser)
                 gtk_list_box_set_placeholder (GTK_LIST_BOX (chooser->region_listbox), NULL);
                 return;
         }
-        chooser->filter_words = g_strsplit_set (g_strstrip (filter_contents), " ", 0);
+
+        /* Only the rows sharing the search's rarest trigram are compared,
+         * the filter function then just looks the rows up */
+        chooser->search_matches =
+                cc_search_table_match (chooser->search_table,
+                                       gtk_entry_get_text (GTK_ENTRY (chooser->region_filter_entry)));
         gtk_list_box_invalidate_filter (GTK_LIST_BOX (chooser->region_listbox));
 
         if (chooser->no_results)
@@ -548,12 +539,40 @@ activate_default (CcFormatChooser *chooser)
         gtk_widget_activate (focus);
 }
 
+static void
+font_coverage_loaded_cb (GObject      *source_object,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+        CcFormatChooser *chooser;
+        g_autoptr(GError) error = NULL;
+        g_autofree gchar *region = NULL;
+
+        if (!cc_common_language_load_font_coverage_finish (result, &error) &&
+            g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                return;
+
+        chooser = CC_FORMAT_CHOOSER (user_data);
+        add_all_regions (chooser);
+
+        /* Show the region which was set meanwhile */
+        region = g_strdup (chooser->region);
+        if (region != NULL)
+                set_locale_id (chooser, region);
+
+        gtk_list_box_invalidate_filter (GTK_LIST_BOX (chooser->region_listbox));
+}
+
 static void
 cc_format_chooser_dispose (GObject *object)
 {
         CcFormatChooser *chooser = CC_FORMAT_CHOOSER (object);
 
-        g_clear_pointer (&chooser->filter_words, g_strfreev);
+        g_cancellable_cancel (chooser->cancellable);
+        g_clear_object (&chooser->cancellable);
+
+        g_clear_pointer (&chooser->search_matches, g_hash_table_unref);
+        g_clear_pointer (&chooser->search_table, cc_search_table_free);
         g_clear_pointer (&chooser->region, g_free);
 
         G_OBJECT_CLASS (cc_format_chooser_parent_class)->dispose (object);
@@ -612,8 +631,12 @@ cc_format_chooser_init (CcFormatChooser *chooser)
         gtk_list_box_set_header_func (GTK_LIST_BOX (chooser->common_region_listbox),
                                       cc_list_box_update_header_func, NULL, NULL);
 
-        add_all_regions (chooser);
-        gtk_list_box_invalidate_filter (GTK_LIST_BOX (chooser->region_listbox));
+        chooser->search_table = cc_search_table_new ();
+
+        chooser->cancellable = g_cancellable_new ();
+        cc_common_language_load_font_coverage_async (chooser->cancellable,
+                                                     font_coverage_loaded_cb,
+                                                     chooser);
         format_chooser_leaflet_fold_changed_cb (chooser);
 
         g_signal_connect_object (chooser, "activate-default",
@@ -67,6 +67,7 @@ struct _CcInputChooser
 
   GnomeXkbInfo      *xkb_info;
   GHashTable        *ibus_engines;
+  GHashTable        *engine_sources;
   GHashTable        *locales;
   GHashTable        *locales_by_language;
   gboolean           showing_extra;
@@ -78,36 +79,90 @@ struct _CcInputChooser
 
 G_DEFINE_TYPE (CcInputChooser, cc_input_chooser, GTK_TYPE_DIALOG)
 
+/* An input source as listed in the dialog. Rows are only created from
+ * these when the sources of a locale are shown. */
+typedef struct
+{
+  const gchar *type;
+  gchar *id;
+  gchar *name;
+  gchar *unaccented_name;
+} SourceInfo;
+
+/* The XKB layouts of a locale only depend on the installed locales and
+ * on the XKB database, so they are computed once and shared by all the
+ * dialogs opened during the session. */
 typedef struct
 {
   gchar *id;
   gchar *name;
   gchar *unaccented_name;
   gchar *untranslated_name;
-  GtkListBoxRow *default_input_source_row;
+  gchar *language;
+  SourceInfo *default_layout;
+  GPtrArray *layouts;
+} LocaleData;
+
+typedef struct
+{
+  LocaleData *data;
+  SourceInfo *default_source;
+  GPtrArray *engines;
+  gboolean is_extra;
   GtkListBoxRow *locale_row;
   GtkListBoxRow *back_row;
-  GHashTable *layout_rows_by_id;
-  GHashTable *engine_rows_by_id;
 } LocaleInfo;
 
+/* Only accessed from the main thread, and kept until exit */
+static GHashTable *cached_layouts = NULL;  /* id → SourceInfo */
+static GPtrArray *cached_locales = NULL;   /* LocaleData, "Other" last */
+
+static SourceInfo *
+source_info_new (const gchar *type,
+                 const gchar *id,
+                 const gchar *name)
+{
+  SourceInfo *source;
+
+  source = g_new0 (SourceInfo, 1);
+  source->type = type;
+  source->id = g_strdup (id);
+  source->name = g_strdup (name);
+  source->unaccented_name = cc_util_normalize_casefold_and_unaccent (name);
+
+  return source;
+}
+
+static void
+source_info_free (gpointer data)
+{
+  SourceInfo *source = data;
+
+  g_free (source->id);
+  g_free (source->name);
+  g_free (source->unaccented_name);
+  g_free (source);
+}
+
 static void
 locale_info_free (gpointer data)
 {
   LocaleInfo *info = data;
 
-  g_free (info->id);
-  g_free (info->name);
-  g_free (info->unaccented_name);
-  g_free (info->untranslated_name);
-  g_clear_object (&info->default_input_source_row);
+  g_ptr_array_unref (info->engines);
   g_clear_object (&info->locale_row);
   g_clear_object (&info->back_row);
-  g_hash_table_destroy (info->layout_rows_by_id);
-  g_hash_table_destroy (info->engine_rows_by_id);
   g_free (info);
 }
 
+static gboolean
+locale_info_has_sources (LocaleInfo *info)
+{
+  return info->default_source != NULL ||
+         info->data->layouts->len > 0 ||
+         info->engines->len > 0;
+}
+
 static void
 set_row_widget_margins (GtkWidget *widget)
 {
@@ -222,68 +277,36 @@ locale_row_new (const gchar *text)
 }
 
 static GtkListBoxRow *
-input_source_row_new (CcInputChooser *self,
-                      const gchar    *type,
-                      const gchar    *id)
+input_source_row_new (SourceInfo *source)
 {
-  GtkWidget *row = NULL;
+  GtkWidget *row;
   GtkWidget *widget;
 
-  if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
-    {
-      const gchar *display_name;
-
-      gnome_xkb_info_get_layout_info (self->xkb_info, id, &display_name, NULL, NULL, NULL);
-
-      row = gtk_list_box_row_new ();
-      widget = padded_label_new (display_name,
-                                 ROW_LABEL_POSITION_START,
-                                 ROW_TRAVEL_DIRECTION_NONE,
-                                 FALSE);
-      gtk_widget_show (widget);
-      gtk_container_add (GTK_CONTAINER (row), widget);
-      g_object_set_data (G_OBJECT (row), "name", (gpointer) display_name);
-      g_object_set_data_full (G_OBJECT (row), "unaccented-name",
-                              cc_util_normalize_casefold_and_unaccent (display_name), g_free);
-    }
-  else if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS))
+  row = gtk_list_box_row_new ();
+  widget = padded_label_new (source->name,
+                             ROW_LABEL_POSITION_START,
+                             ROW_TRAVEL_DIRECTION_NONE,
+                             FALSE);
+  gtk_widget_show (widget);
+  gtk_container_add (GTK_CONTAINER (row), widget);
+
+  if (g_str_equal (source->type, INPUT_SOURCE_TYPE_IBUS))
     {
-#ifdef HAVE_IBUS
-      gchar *display_name;
       GtkWidget *image;
 
-      display_name = engine_get_display_name (g_hash_table_lookup (self->ibus_engines, id));
-
-      row = gtk_list_box_row_new ();
-      widget = padded_label_new (display_name,
-                                 ROW_LABEL_POSITION_START,
-                                 ROW_TRAVEL_DIRECTION_NONE,
-                                 FALSE);
-      gtk_widget_show (widget);
-      gtk_container_add (GTK_CONTAINER (row), widget);
       image = gtk_image_new_from_icon_name ("system-run-symbolic", GTK_ICON_SIZE_MENU);
       gtk_widget_show (image);
       set_row_widget_margins (image);
       gtk_style_context_add_class (gtk_widget_get_style_context (image), "dim-label");
       gtk_container_add (GTK_CONTAINER (widget), image);
-
-      g_object_set_data_full (G_OBJECT (row), "name", display_name, g_free);
-      g_object_set_data_full (G_OBJECT (row), "unaccented-name",
-                              cc_util_normalize_casefold_and_unaccent (display_name), g_free);
-#else
-      widget = NULL;
-#endif  /* HAVE_IBUS */
     }
 
-  if (row)
-    {
-      g_object_set_data (G_OBJECT (row), "type", (gpointer) type);
-      g_object_set_data (G_OBJECT (row), "id", (gpointer) id);
-
-      return GTK_LIST_BOX_ROW (row);
-    }
+  g_object_set_data (G_OBJECT (row), "name", source->name);
+  g_object_set_data (G_OBJECT (row), "unaccented-name", source->unaccented_name);
+  g_object_set_data (G_OBJECT (row), "type", (gpointer) source->type);
+  g_object_set_data (G_OBJECT (row), "id", source->id);
 
-  return NULL;
+  return GTK_LIST_BOX_ROW (row);
 }
 
 static void
@@ -297,24 +320,38 @@ remove_all_children (GtkContainer *container)
     gtk_container_remove (container, (GtkWidget *) l->data);
 }
 
+static void
+add_input_source_row (CcInputChooser *self,
+                      LocaleInfo     *info,
+                      SourceInfo     *source,
+                      gboolean        is_default)
+{
+  GtkListBoxRow *row;
+
+  row = input_source_row_new (source);
+  gtk_widget_show (GTK_WIDGET (row));
+  g_object_set_data (G_OBJECT (row), "locale-info", info);
+  if (is_default)
+    g_object_set_data (G_OBJECT (row), "default", GINT_TO_POINTER (TRUE));
+
+  gtk_container_add (GTK_CONTAINER (self->input_sources_listbox), GTK_WIDGET (row));
+}
+
+/* The rows of the input sources are only alive while their locale is shown */
 static void
 add_input_source_rows_for_locale (CcInputChooser *self,
                                   LocaleInfo     *info)
 {
-  GtkWidget *row;
-  GHashTableIter iter;
-  const gchar *id;
+  guint i;
 
-  if (info->default_input_source_row)
-    gtk_container_add (GTK_CONTAINER (self->input_sources_listbox), GTK_WIDGET (info->default_input_source_row));
+  if (info->default_source)
+    add_input_source_row (self, info, info->default_source, TRUE);
 
-  g_hash_table_iter_init (&iter, info->layout_rows_by_id);
-  while (g_hash_table_iter_next (&iter, (gpointer *) &id, (gpointer *) &row))
-    gtk_container_add (GTK_CONTAINER (self->input_sources_listbox), row);
+  for (i = 0; i < info->data->layouts->len; i++)
+    add_input_source_row (self, info, g_ptr_array_index (info->data->layouts, i), FALSE);
 
-  g_hash_table_iter_init (&iter, info->engine_rows_by_id);
-  while (g_hash_table_iter_next (&iter, (gpointer *) &id, (gpointer *) &row))
-    gtk_container_add (GTK_CONTAINER (self->input_sources_listbox), row);
+  for (i = 0; i < info->engines->len; i++)
+    add_input_source_row (self, info, g_ptr_array_index (info->engines, i), FALSE);
 }
 
 static void
@@ -325,7 +362,7 @@ show_input_sources_for_locale (CcInputChooser *self,
 
   if (!info->back_row)
     {
-      info->back_row = g_object_ref_sink (back_row_new (info->name));
+      info->back_row = g_object_ref_sink (back_row_new (info->data->name));
       gtk_widget_show (GTK_WIDGET (info->back_row));
       g_object_set_data (G_OBJECT (info->back_row), "back", GINT_TO_POINTER (TRUE));
       g_object_set_data (G_OBJECT (info->back_row), "locale-info", info);
@@ -353,40 +390,41 @@ is_current_locale (const gchar *locale)
   return g_strcmp0 (setlocale (LC_CTYPE, NULL), locale) == 0;
 }
 
+/* Locale rows are only created once they can be seen, so the extra
+ * locales are added when the user asks for more */
 static void
-show_locale_rows (CcInputChooser *self)
+add_locale_rows (CcInputChooser *self)
 {
-  g_autoptr(GHashTable) initial = NULL;
   LocaleInfo *info;
   GHashTableIter iter;
 
-  remove_all_children (GTK_CONTAINER (self->input_sources_listbox));
-
-  if (!self->showing_extra)
-    initial = cc_common_language_get_initial_languages ();
-
   g_hash_table_iter_init (&iter, self->locales);
   while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &info))
     {
-      if (!info->default_input_source_row &&
-          !g_hash_table_size (info->layout_rows_by_id) &&
-          !g_hash_table_size (info->engine_rows_by_id))
+      if (!locale_info_has_sources (info))
+        continue;
+
+      if (info->is_extra && !self->showing_extra)
         continue;
 
       if (!info->locale_row)
         {
-          info->locale_row = g_object_ref_sink (locale_row_new (info->name));
+          info->locale_row = g_object_ref_sink (locale_row_new (info->data->name));
           gtk_widget_show (GTK_WIDGET (info->locale_row));
           g_object_set_data (G_OBJECT (info->locale_row), "locale-info", info);
-
-          if (!self->showing_extra &&
-              !g_hash_table_contains (initial, info->id) &&
-              !is_current_locale (info->id))
-            g_object_set_data (G_OBJECT (info->locale_row), "is-extra", GINT_TO_POINTER (TRUE));
         }
-      gtk_container_add (GTK_CONTAINER (self->input_sources_listbox), GTK_WIDGET (info->locale_row));
+
+      if (!gtk_widget_get_parent (GTK_WIDGET (info->locale_row)))
+        gtk_container_add (GTK_CONTAINER (self->input_sources_listbox), GTK_WIDGET (info->locale_row));
     }
+}
 
+static void
+show_locale_rows (CcInputChooser *self)
+{
+  remove_all_children (GTK_CONTAINER (self->input_sources_listbox));
+
+  add_locale_rows (self);
   gtk_container_add (GTK_CONTAINER (self->input_sources_listbox), GTK_WIDGET (self->more_row));
 
   gtk_adjustment_set_value (self->scroll_adjustment,
@@ -423,12 +461,12 @@ list_sort (GtkListBoxRow *a,
   ib = g_object_get_data (G_OBJECT (b), "locale-info");
 
   /* The "Other" locale always goes at the end */
-  if (!ia->id[0] && ib->id[0])
+  if (!ia->data->id[0] && ib->data->id[0])
     return 1;
-  else if (ia->id[0] && !ib->id[0])
+  else if (ia->data->id[0] && !ib->data->id[0])
     return -1;
 
-  retval = g_strcmp0 (ia->name, ib->name);
+  retval = g_strcmp0 (ia->data->name, ib->data->name);
   if (retval)
     return retval;
 
@@ -467,18 +505,16 @@ match_all (gchar       **words,
 }
 
 static gboolean
-match_source_in_table (gchar      **words,
-                       GHashTable  *table)
+match_source_in_array (gchar     **words,
+                       GPtrArray  *sources)
 {
-  GHashTableIter iter;
-  gpointer row;
-  const gchar *source_name;
+  guint i;
 
-  g_hash_table_iter_init (&iter, table);
-  while (g_hash_table_iter_next (&iter, NULL, &row))
+  for (i = 0; i < sources->len; i++)
     {
-      source_name = g_object_get_data (G_OBJECT (row), "unaccented-name");
-      if (source_name && match_all (words, source_name))
+      SourceInfo *source = g_ptr_array_index (sources, i);
+
+      if (match_all (words, source->unaccented_name))
         return TRUE;
     }
   return FALSE;
@@ -490,17 +526,11 @@ list_filter (GtkListBoxRow *row,
 {
   CcInputChooser *self = user_data;
   LocaleInfo *info;
-  gboolean is_extra;
   const gchar *source_name;
 
   if (row == self->more_row)
     return !self->showing_extra;
 
-  is_extra = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (row), "is-extra"));
-
-  if (!self->showing_extra && is_extra)
-    return FALSE;
-
   if (!self->filter_words)
     return TRUE;
 
@@ -509,10 +539,10 @@ list_filter (GtkListBoxRow *row,
   if (row == info->back_row)
     return TRUE;
 
-  if (match_all (self->filter_words, info->unaccented_name))
+  if (match_all (self->filter_words, info->data->unaccented_name))
     return TRUE;
 
-  if (match_all (self->filter_words, info->untranslated_name))
+  if (match_all (self->filter_words, info->data->untranslated_name))
     return TRUE;
 
   source_name = g_object_get_data (G_OBJECT (row), "unaccented-name");
@@ -523,9 +553,12 @@ list_filter (GtkListBoxRow *row,
     }
   else
     {
-      if (match_source_in_table (self->filter_words, info->layout_rows_by_id))
+      if (info->default_source &&
+          match_all (self->filter_words, info->default_source->unaccented_name))
         return TRUE;
-      if (match_source_in_table (self->filter_words, info->engine_rows_by_id))
+      if (match_source_in_array (self->filter_words, info->data->layouts))
+        return TRUE;
+      if (match_source_in_array (self->filter_words, info->engines))
         return TRUE;
     }
 
@@ -591,6 +624,7 @@ show_more (CcInputChooser *self)
 
   self->showing_extra = TRUE;
 
+  add_locale_rows (self);
   gtk_list_box_invalidate_filter (self->input_sources_listbox);
 }
 
@@ -663,95 +697,48 @@ on_input_sources_listbox_button_release_event_cb (CcInputChooser *self, GdkEvent
   return FALSE;
 }
 
-static void
-add_default_row (CcInputChooser *self,
-                 LocaleInfo     *info,
-                 const gchar    *type,
-                 const gchar    *id)
-{
-  info->default_input_source_row = input_source_row_new (self, type, id);
-  if (info->default_input_source_row)
-    {
-      gtk_widget_show (GTK_WIDGET (info->default_input_source_row));
-      g_object_ref_sink (GTK_WIDGET (info->default_input_source_row));
-      g_object_set_data (G_OBJECT (info->default_input_source_row), "default", GINT_TO_POINTER (TRUE));
-      g_object_set_data (G_OBJECT (info->default_input_source_row), "locale-info", info);
-    }
-}
-
-static void
-add_rows_to_table (CcInputChooser *self,
-                   LocaleInfo     *info,
-                   GList          *list,
-                   const gchar    *type,
-                   const gchar    *default_id)
+#ifdef HAVE_IBUS
+static SourceInfo *
+get_engine_source (CcInputChooser *self,
+                   const gchar    *engine_id,
+                   IBusEngineDesc *engine)
 {
-  GHashTable *table;
-  GtkListBoxRow *row;
-  const gchar *id;
+  g_autofree gchar *display_name = NULL;
+  SourceInfo *source;
 
-  if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
-    table = info->layout_rows_by_id;
-  else if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS))
-    table = info->engine_rows_by_id;
-  else
-    return;
-
-  while (list)
-    {
-      id = (const gchar *) list->data;
+  source = g_hash_table_lookup (self->engine_sources, engine_id);
+  if (source)
+    return source;
 
-      /* The widget for the default input source lives elsewhere */
-      if (g_strcmp0 (id, default_id))
-        {
-          row = input_source_row_new (self, type, id);
-          gtk_widget_show (GTK_WIDGET (row));
-          if (row)
-            {
-              g_object_set_data (G_OBJECT (row), "locale-info", info);
-              g_hash_table_replace (table, (gpointer) id, g_object_ref_sink (row));
-            }
-        }
-      list = list->next;
-    }
-}
+  display_name = engine_get_display_name (engine);
+  source = source_info_new (INPUT_SOURCE_TYPE_IBUS, engine_id, display_name);
+  g_hash_table_insert (self->engine_sources, source->id, source);
 
-static void
-add_row (CcInputChooser *self,
-         LocaleInfo     *info,
-         const gchar    *type,
-         const gchar    *id)
-{
-  GList tmp = { 0 };
-  tmp.data = (gpointer) id;
-  add_rows_to_table (self, info, &tmp, type, NULL);
+  return source;
 }
 
 static void
-add_row_other (CcInputChooser *self,
-               const gchar    *type,
-               const gchar    *id)
+add_engine_other (CcInputChooser *self,
+                  SourceInfo     *source)
 {
   LocaleInfo *info = g_hash_table_lookup (self->locales, "");
-  add_row (self, info, type, id);
+  g_ptr_array_add (info->engines, source);
 }
 
-#ifdef HAVE_IBUS
 static gboolean
-maybe_set_as_default (CcInputChooser *self,
-                      LocaleInfo     *info,
-                      const gchar    *engine_id)
+maybe_set_as_default (LocaleInfo *info,
+                      SourceInfo *source)
 {
   const gchar *type, *id;
 
-  if (!gnome_get_input_source_from_locale (info->id, &type, &id))
+  if (!gnome_get_input_source_from_locale (info->data->id, &type, &id))
     return FALSE;
 
   if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS) &&
-      g_str_equal (id, engine_id) &&
-      info->default_input_source_row == NULL)
+      g_str_equal (id, source->id) &&
+      info->default_source == NULL)
     {
-      add_default_row (self, info, type, id);
+      info->default_source = source;
       return TRUE;
     }
 
@@ -775,6 +762,7 @@ get_ibus_locale_infos (CcInputChooser *self)
       g_autofree gchar *lang_code = NULL;
       g_autofree gchar *country_code = NULL;
       const gchar *ibus_locale = ibus_engine_desc_get_language (engine);
+      SourceInfo *source = get_engine_source (self, engine_id, engine);
 
       if (gnome_parse_locale (ibus_locale, &lang_code, &country_code, NULL, NULL) &&
           lang_code != NULL &&
@@ -791,16 +779,16 @@ get_ibus_locale_infos (CcInputChooser *self)
                   g_str_equal (type, INPUT_SOURCE_TYPE_IBUS) &&
                   g_str_equal (id, engine_id))
                 {
-                  add_default_row (self, info, type, id);
+                  info->default_source = source;
                 }
               else
                 {
-                  add_row (self, info, INPUT_SOURCE_TYPE_IBUS, engine_id);
+                  g_ptr_array_add (info->engines, source);
                 }
             }
           else
             {
-              add_row_other (self, INPUT_SOURCE_TYPE_IBUS, engine_id);
+              add_engine_other (self, source);
             }
         }
       else if (lang_code != NULL)
@@ -822,39 +810,66 @@ get_ibus_locale_infos (CcInputChooser *self)
             {
               g_hash_table_iter_init (&iter, locales_for_language);
               while (g_hash_table_iter_next (&iter, (gpointer *) &info, NULL))
-                if (!maybe_set_as_default (self, info, engine_id))
-                  add_row (self, info, INPUT_SOURCE_TYPE_IBUS, engine_id);
+                if (!maybe_set_as_default (info, source))
+                  g_ptr_array_add (info->engines, source);
             }
           else
             {
-              add_row_other (self, INPUT_SOURCE_TYPE_IBUS, engine_id);
+              add_engine_other (self, source);
             }
         }
       else
         {
-          add_row_other (self, INPUT_SOURCE_TYPE_IBUS, engine_id);
+          add_engine_other (self, source);
         }
     }
 }
 #endif  /* HAVE_IBUS */
 
-static void
-add_locale_to_table (GHashTable  *table,
-                     const gchar *lang_code,
-                     LocaleInfo  *info)
+static SourceInfo *
+get_cached_layout (GnomeXkbInfo *xkb_info,
+                   const gchar  *id)
 {
-  GHashTable *set;
-  g_autofree gchar *language = NULL;
+  SourceInfo *source;
+  const gchar *display_name;
 
-  language = gnome_get_language_from_code (lang_code, NULL);
+  source = g_hash_table_lookup (cached_layouts, id);
+  if (source)
+    return source;
 
-  set = g_hash_table_lookup (table, language);
-  if (!set)
+  if (!gnome_xkb_info_get_layout_info (xkb_info, id, &display_name, NULL, NULL, NULL))
+    return NULL;
+
+  source = source_info_new (INPUT_SOURCE_TYPE_XKB, id, display_name);
+  g_hash_table_insert (cached_layouts, source->id, source);
+
+  return source;
+}
+
+static void
+add_layouts_to_locale (GnomeXkbInfo *xkb_info,
+                       LocaleData   *data,
+                       GHashTable   *seen,
+                       GList        *list)
+{
+  while (list)
     {
-      set = g_hash_table_new (NULL, NULL);
-      g_hash_table_replace (table, g_strdup (language), set);
+      const gchar *id = list->data;
+      SourceInfo *source;
+
+      list = list->next;
+
+      /* The default input source is listed first, on its own */
+      if (g_hash_table_contains (seen, id))
+        continue;
+
+      source = get_cached_layout (xkb_info, id);
+      if (!source)
+        continue;
+
+      g_hash_table_add (seen, source->id);
+      g_ptr_array_add (data->layouts, source);
     }
-  g_hash_table_add (set, info);
 }
 
 static void
@@ -868,30 +883,52 @@ add_ids_to_set (GHashTable *set,
     }
 }
 
-static void
-get_locale_infos (CcInputChooser *self)
+static LocaleData *
+locale_data_new (const gchar *id,
+                 const gchar *name,
+                 const gchar *untranslated_name)
 {
+  LocaleData *data;
+
+  data = g_new0 (LocaleData, 1);
+  data->id = g_strdup (id);
+  data->name = g_strdup (name);
+  data->unaccented_name = cc_util_normalize_casefold_and_unaccent (name);
+  data->untranslated_name = cc_util_normalize_casefold_and_unaccent (untranslated_name);
+  data->layouts = g_ptr_array_new ();
+
+  return data;
+}
+
+static GPtrArray *
+get_cached_locales (GnomeXkbInfo *xkb_info)
+{
+  g_autoptr(GHashTable) simple_locales = NULL;
   g_autoptr(GHashTable) layouts_with_locale = NULL;
-  LocaleInfo *info;
+  LocaleData *data;
   g_auto(GStrv) locale_ids = NULL;
   gchar **locale;
   g_autoptr(GList) all_layouts = NULL;
   GList *l;
 
-  self->locales = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                         g_free, locale_info_free);
-  self->locales_by_language = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                     g_free, (GDestroyNotify) g_hash_table_unref);
+  if (cached_locales)
+    return cached_locales;
+
+  cached_layouts = g_hash_table_new (g_str_hash, g_str_equal);
+  cached_locales = g_ptr_array_new ();
 
+  simple_locales = g_hash_table_new (g_str_hash, g_str_equal);
   layouts_with_locale = g_hash_table_new (g_str_hash, g_str_equal);
 
   locale_ids = gnome_get_all_locales ();
   for (locale = locale_ids; *locale; ++locale)
     {
+      g_autoptr(GHashTable) seen = NULL;
       g_autofree gchar *lang_code = NULL;
       g_autofree gchar *country_code = NULL;
       g_autofree gchar *simple_locale = NULL;
-      g_autofree gchar *tmp = NULL;
+      g_autofree gchar *name = NULL;
+      g_autofree gchar *untranslated_name = NULL;
       const gchar *type = NULL;
       const gchar *id = NULL;
       g_autoptr(GList) language_layouts = NULL;
@@ -904,61 +941,106 @@ get_locale_infos (CcInputChooser *self)
       else
 	simple_locale = g_strdup_printf ("%s.UTF-8", lang_code);
 
-      if (g_hash_table_contains (self->locales, simple_locale))
+      if (g_hash_table_contains (simple_locales, simple_locale))
           continue;
 
-      info = g_new0 (LocaleInfo, 1);
-      info->id = g_strdup (simple_locale);
-      info->name = gnome_get_language_from_locale (simple_locale, NULL);
-      info->unaccented_name = cc_util_normalize_casefold_and_unaccent (info->name);
-      tmp = gnome_get_language_from_locale (simple_locale, "C");
-      info->untranslated_name = cc_util_normalize_casefold_and_unaccent (tmp);
+      name = gnome_get_language_from_locale (simple_locale, NULL);
+      untranslated_name = gnome_get_language_from_locale (simple_locale, "C");
+      data = locale_data_new (simple_locale, name, untranslated_name);
+      data->language = gnome_get_language_from_code (lang_code, NULL);
+
+      g_ptr_array_add (cached_locales, data);
+      g_hash_table_add (simple_locales, data->id);
 
-      g_hash_table_replace (self->locales, g_strdup (simple_locale), info);
-      add_locale_to_table (self->locales_by_language, lang_code, info);
+      seen = g_hash_table_new (g_str_hash, g_str_equal);
 
       if (gnome_get_input_source_from_locale (simple_locale, &type, &id) &&
           g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
         {
-          add_default_row (self, info, type, id);
-          g_hash_table_add (layouts_with_locale, (gpointer) id);
+          data->default_layout = get_cached_layout (xkb_info, id);
+          if (data->default_layout)
+            {
+              g_hash_table_add (seen, data->default_layout->id);
+              g_hash_table_add (layouts_with_locale, data->default_layout->id);
+            }
         }
 
-      /* We don't own these ids */
-      info->layout_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                       NULL, g_object_unref);
-      info->engine_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                       NULL, g_object_unref);
-
-      language_layouts = gnome_xkb_info_get_layouts_for_language (self->xkb_info, lang_code);
-      add_rows_to_table (self, info, language_layouts, INPUT_SOURCE_TYPE_XKB, id);
+      language_layouts = gnome_xkb_info_get_layouts_for_language (xkb_info, lang_code);
+      add_layouts_to_locale (xkb_info, data, seen, language_layouts);
       add_ids_to_set (layouts_with_locale, language_layouts);
 
       if (country_code != NULL)
         {
-          g_autoptr(GList) country_layouts = gnome_xkb_info_get_layouts_for_country (self->xkb_info, country_code);
-          add_rows_to_table (self, info, country_layouts, INPUT_SOURCE_TYPE_XKB, id);
+          g_autoptr(GList) country_layouts = gnome_xkb_info_get_layouts_for_country (xkb_info, country_code);
+          add_layouts_to_locale (xkb_info, data, seen, country_layouts);
           add_ids_to_set (layouts_with_locale, country_layouts);
         }
     }
 
   /* Add a "Other" locale to hold the remaining input sources */
-  info = g_new0 (LocaleInfo, 1);
-  info->id = g_strdup ("");
-  info->name = g_strdup (C_("Input Source", "Other"));
-  info->unaccented_name = g_strdup ("");
-  info->untranslated_name = g_strdup ("");
-  g_hash_table_replace (self->locales, g_strdup (info->id), info);
-
-  info->layout_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                   NULL, g_object_unref);
-  info->engine_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                   NULL, g_object_unref);
-
-  all_layouts = gnome_xkb_info_get_all_layouts (self->xkb_info);
+  data = locale_data_new ("", C_("Input Source", "Other"), "");
+  g_ptr_array_add (cached_locales, data);
+
+  all_layouts = gnome_xkb_info_get_all_layouts (xkb_info);
   for (l = all_layouts; l; l = l->next)
     if (!g_hash_table_contains (layouts_with_locale, l->data))
-      add_row_other (self, INPUT_SOURCE_TYPE_XKB, l->data);
+      {
+        SourceInfo *source = get_cached_layout (xkb_info, l->data);
+
+        if (source)
+          g_ptr_array_add (data->layouts, source);
+      }
+
+  return cached_locales;
+}
+
+static void
+add_locale_to_table (GHashTable  *table,
+                     const gchar *language,
+                     LocaleInfo  *info)
+{
+  GHashTable *set;
+
+  set = g_hash_table_lookup (table, language);
+  if (!set)
+    {
+      set = g_hash_table_new (NULL, NULL);
+      g_hash_table_replace (table, g_strdup (language), set);
+    }
+  g_hash_table_add (set, info);
+}
+
+static void
+get_locale_infos (CcInputChooser *self)
+{
+  g_autoptr(GHashTable) initial = NULL;
+  GPtrArray *locales;
+  guint i;
+
+  self->locales = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, locale_info_free);
+  self->locales_by_language = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                     g_free, (GDestroyNotify) g_hash_table_unref);
+
+  initial = cc_common_language_get_initial_languages ();
+
+  locales = get_cached_locales (self->xkb_info);
+  for (i = 0; i < locales->len; i++)
+    {
+      LocaleData *data = g_ptr_array_index (locales, i);
+      LocaleInfo *info;
+
+      info = g_new0 (LocaleInfo, 1);
+      info->data = data;
+      info->default_source = data->default_layout;
+      info->engines = g_ptr_array_new ();
+      info->is_extra = !g_hash_table_contains (initial, data->id) &&
+                       !is_current_locale (data->id);
+
+      g_hash_table_replace (self->locales, data->id, info);
+      if (data->language)
+        add_locale_to_table (self->locales_by_language, data->language, info);
+    }
 }
 
 static gboolean
@@ -986,6 +1068,7 @@ cc_input_chooser_dispose (GObject *object)
   g_clear_pointer (&self->ibus_engines, g_hash_table_unref);
   g_clear_pointer (&self->locales, g_hash_table_unref);
   g_clear_pointer (&self->locales_by_language, g_hash_table_unref);
+  g_clear_pointer (&self->engine_sources, g_hash_table_unref);
   g_clear_pointer (&self->filter_words, g_strfreev);
   g_clear_handle_id (&self->filter_timeout_id, g_source_remove);
 
@@ -1019,6 +1102,9 @@ void
 cc_input_chooser_init (CcInputChooser *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
+
+  self->engine_sources = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                NULL, source_info_free);
 }
 
 CcInputChooser *
@@ -90,11 +90,13 @@ struct _CcAddUserDialog {
         ActUser            *user;
 
         gboolean            has_custom_username;
+        GCancellable       *username_choices_cancellable;
         gint                local_name_timeout_id;
         gint                local_username_timeout_id;
         ActUserPasswordMode local_password_mode;
         gint                local_password_timeout_id;
         gboolean            local_valid_username;
+        PwStrengthChecker  *strength_checker;
 
         guint               realmd_watch;
         CcRealmManager     *realm_manager;
@@ -198,6 +200,9 @@ create_user_done (ActUserManager  *manager,
         error = NULL;
         user = act_user_manager_create_user_finish (manager, res, &error);
 
+        /* The name may have been taken even if creating the user failed */
+        clear_username_cache ();
+
         if (user == NULL) {
                 finish_action (self);
                 g_debug ("Failed to create user: %s", error->message);
@@ -242,11 +247,41 @@ local_create_user (CcAddUserDialog *self)
                                             self);
 }
 
+static gint update_password_strength (CcAddUserDialog *self);
+
+static void
+password_strength_checked_cb (GObject      *source_object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+        g_autoptr(CcAddUserDialog) self = CC_ADD_USER_DIALOG (user_data);
+        g_autoptr(GError) error = NULL;
+        g_autofree gchar *username = NULL;
+        const gchar *hint;
+
+        pw_strength_checker_check_finish (result, &hint, NULL, &error);
+        if (error != NULL) {
+                if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                        g_warning ("Failed to check the password: %s", error->message);
+                return;
+        }
+
+        /* Wait for the next check if the password changed in the meantime */
+        username = gtk_combo_box_text_get_active_text (self->local_username_combo);
+        if (!pw_strength_checker_lookup (self->strength_checker,
+                                         gtk_entry_get_text (self->local_password_entry),
+                                         NULL, username, &hint, NULL))
+                return;
+
+        update_password_strength (self);
+        dialog_validate (self);
+}
+
 static gint
 update_password_strength (CcAddUserDialog *self)
 {
         const gchar *password;
-        const gchar *username;
+        g_autofree gchar *username = NULL;
         const gchar *hint;
         const gchar *verify;
         gint strength_level;
@@ -254,7 +289,27 @@ update_password_strength (CcAddUserDialog *self)
         password = gtk_entry_get_text (self->local_password_entry);
         username = gtk_combo_box_text_get_active_text (self->local_username_combo);
 
-        pw_strength (password, NULL, username, &hint, &strength_level);
+        /* The check is done in a thread, and the dialog is validated
+         * again once the result is known. Meanwhile, nothing is shown
+         * that belongs to the previous password. */
+        if (!pw_strength_checker_lookup (self->strength_checker,
+                                         password, NULL, username,
+                                         &hint, &strength_level)) {
+                pw_strength_checker_check_async (self->strength_checker,
+                                                 password, NULL, username,
+                                                 password_strength_checked_cb,
+                                                 g_object_ref (self));
+
+                gtk_label_set_label (self->local_hint_label, "");
+                gtk_level_bar_set_value (self->local_strength_indicator, 0);
+                clear_entry_validation_error (self->local_password_entry);
+
+                verify = gtk_entry_get_text (self->local_verify_entry);
+                if (strlen (verify) == 0)
+                        gtk_widget_set_sensitive (GTK_WIDGET (self->local_verify_entry), FALSE);
+
+                return 0;
+        }
 
         gtk_label_set_label (self->local_hint_label, hint);
         gtk_level_bar_set_value (self->local_strength_indicator, strength_level);
@@ -320,7 +375,7 @@ static void local_username_is_valid_cb (GObject *source_object,
 
         valid = is_valid_username_finish (result, &tip, &username, &error);
         if (error != NULL) {
-                g_warning ("Could not check username by usermod: %s", error->message);
+                g_warning ("Could not check username: %s", error->message);
                 valid = TRUE;
         }
 
@@ -408,10 +463,28 @@ local_name_entry_focus_out_event_cb (CcAddUserDialog *self)
 }
 
 static void
-generate_username_choices (const gchar  *name,
-                           GtkListStore *store)
+add_username_choice (GPtrArray   *choices,
+                     const gchar *username)
+{
+        guint i;
+
+        if (g_ascii_isdigit (username[0]))
+                return;
+
+        for (i = 0; i < choices->len; i++) {
+                if (g_strcmp0 (g_ptr_array_index (choices, i), username) == 0)
+                        return;
+        }
+
+        g_ptr_array_add (choices, g_strdup (username));
+}
+
+/* Returns the suggested usernames for @name, most relevant first.
+ * Whether they are available is checked by the caller. */
+static GPtrArray *
+generate_username_choices (const gchar *name)
 {
-        gboolean in_use, same_as_initial;
+        GPtrArray *choices;
         char *lc_name, *ascii_name, *stripped_name;
         char **words1;
         char **words2 = NULL;
@@ -422,11 +495,9 @@ generate_username_choices (const gchar  *name,
         GString *item0, *item1, *item2, *item3, *item4;
         int len;
         int nwords1, nwords2, i;
-        GHashTable *items;
-        GtkTreeIter iter;
         gsize max_name_length;
 
-        gtk_list_store_clear (store);
+        choices = g_ptr_array_new_with_free_func (g_free);
 
         ascii_name = g_convert_with_fallback (name, -1, "ASCII//TRANSLIT", "UTF-8",
                                               unicode_fallback, NULL, NULL, NULL);
@@ -457,7 +528,7 @@ generate_username_choices (const gchar  *name,
                 g_free (ascii_name);
                 g_free (lc_name);
                 g_free (stripped_name);
-                return;
+                return choices;
         }
 
         /* we split name on spaces, and then on dashes, so that we can treat
@@ -561,70 +632,25 @@ generate_username_choices (const gchar  *name,
         g_string_truncate (item3, max_name_length);
         g_string_truncate (item4, max_name_length);
 
-        items = g_hash_table_new (g_str_hash, g_str_equal);
-
-        in_use = is_username_used (item0->str);
-        if (!in_use && !g_ascii_isdigit (item0->str[0])) {
-                gtk_list_store_append (store, &iter);
-                gtk_list_store_set (store, &iter, 0, item0->str, -1);
-                g_hash_table_insert (items, item0->str, item0->str);
-        }
+        add_username_choice (choices, item0->str);
 
-        in_use = is_username_used (item1->str);
-        same_as_initial = (g_strcmp0 (item0->str, item1->str) == 0);
-        if (!same_as_initial && nwords2 > 0 && !in_use && !g_ascii_isdigit (item1->str[0])) {
-                gtk_list_store_append (store, &iter);
-                gtk_list_store_set (store, &iter, 0, item1->str, -1);
-                g_hash_table_insert (items, item1->str, item1->str);
-        }
+        if (nwords2 > 0)
+                add_username_choice (choices, item1->str);
 
         /* if there's only one word, would be the same as item1 */
         if (nwords2 > 1) {
                 /* add other items */
-                in_use = is_username_used (item2->str);
-                if (!in_use && !g_ascii_isdigit (item2->str[0]) &&
-                    !g_hash_table_lookup (items, item2->str)) {
-                        gtk_list_store_append (store, &iter);
-                        gtk_list_store_set (store, &iter, 0, item2->str, -1);
-                        g_hash_table_insert (items, item2->str, item2->str);
-                }
-
-                in_use = is_username_used (item3->str);
-                if (!in_use && !g_ascii_isdigit (item3->str[0]) &&
-                    !g_hash_table_lookup (items, item3->str)) {
-                        gtk_list_store_append (store, &iter);
-                        gtk_list_store_set (store, &iter, 0, item3->str, -1);
-                        g_hash_table_insert (items, item3->str, item3->str);
-                }
-
-                in_use = is_username_used (item4->str);
-                if (!in_use && !g_ascii_isdigit (item4->str[0]) &&
-                    !g_hash_table_lookup (items, item4->str)) {
-                        gtk_list_store_append (store, &iter);
-                        gtk_list_store_set (store, &iter, 0, item4->str, -1);
-                        g_hash_table_insert (items, item4->str, item4->str);
-                }
+                add_username_choice (choices, item2->str);
+                add_username_choice (choices, item3->str);
+                add_username_choice (choices, item4->str);
 
                 /* add the last word */
-                in_use = is_username_used (last_word->str);
-                if (!in_use && !g_ascii_isdigit (last_word->str[0]) &&
-                    !g_hash_table_lookup (items, last_word->str)) {
-                        gtk_list_store_append (store, &iter);
-                        gtk_list_store_set (store, &iter, 0, last_word->str, -1);
-                        g_hash_table_insert (items, last_word->str, last_word->str);
-                }
+                add_username_choice (choices, last_word->str);
 
                 /* ...and the first one */
-                in_use = is_username_used (first_word->str);
-                if (!in_use && !g_ascii_isdigit (first_word->str[0]) &&
-                    !g_hash_table_lookup (items, first_word->str)) {
-                        gtk_list_store_append (store, &iter);
-                        gtk_list_store_set (store, &iter, 0, first_word->str, -1);
-                        g_hash_table_insert (items, first_word->str, first_word->str);
-                }
+                add_username_choice (choices, first_word->str);
         }
 
-        g_hash_table_destroy (items);
         g_strfreev (words1);
         g_string_free (first_word, TRUE);
         g_string_free (last_word, TRUE);
@@ -633,6 +659,99 @@ generate_username_choices (const gchar  *name,
         g_string_free (item2, TRUE);
         g_string_free (item3, TRUE);
         g_string_free (item4, TRUE);
+
+        return choices;
+}
+
+typedef struct {
+        CcAddUserDialog *self;
+        GPtrArray       *choices;
+        gboolean        *valid;
+        guint            pending;
+        gboolean         cancelled;
+} UsernameChoicesData;
+
+static void
+username_choices_data_free (UsernameChoicesData *data)
+{
+        g_object_unref (data->self);
+        g_ptr_array_unref (data->choices);
+        g_free (data->valid);
+        g_free (data);
+}
+
+static void
+username_choice_validated_cb (GObject      *source_object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+        UsernameChoicesData *data = user_data;
+        CcAddUserDialog *self = data->self;
+        g_autoptr(GError) error = NULL;
+        g_autofree gchar *username = NULL;
+        gboolean valid;
+        GtkTreeIter iter;
+        guint i;
+
+        valid = is_valid_username_finish (result, NULL, &username, &error);
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                data->cancelled = TRUE;
+        else if (error != NULL)
+                valid = TRUE;
+
+        for (i = 0; i < data->choices->len; i++) {
+                if (g_strcmp0 (g_ptr_array_index (data->choices, i), username) == 0)
+                        data->valid[i] = valid;
+        }
+
+        if (--data->pending > 0)
+                return;
+
+        if (!data->cancelled) {
+                for (i = 0; i < data->choices->len; i++) {
+                        if (!data->valid[i])
+                                continue;
+
+                        gtk_list_store_append (self->local_username_model, &iter);
+                        gtk_list_store_set (self->local_username_model, &iter,
+                                            0, g_ptr_array_index (data->choices, i),
+                                            -1);
+                }
+
+                if (!self->has_custom_username)
+                        gtk_combo_box_set_active (GTK_COMBO_BOX (self->local_username_combo), 0);
+        }
+
+        username_choices_data_free (data);
+}
+
+/* All the suggestions are checked at once, and only the available ones
+ * are shown, once they have all been checked */
+static void
+update_username_choices (CcAddUserDialog *self,
+                         const gchar     *name)
+{
+        UsernameChoicesData *data;
+        g_autoptr(GPtrArray) choices = NULL;
+        guint i;
+
+        choices = generate_username_choices (name);
+        if (choices->len == 0)
+                return;
+
+        self->username_choices_cancellable = g_cancellable_new ();
+
+        data = g_new0 (UsernameChoicesData, 1);
+        data->self = g_object_ref (self);
+        data->choices = g_ptr_array_ref (choices);
+        data->valid = g_new0 (gboolean, choices->len);
+        data->pending = choices->len;
+
+        for (i = 0; i < choices->len; i++)
+                is_valid_username_async (g_ptr_array_index (choices, i),
+                                         self->username_choices_cancellable,
+                                         username_choice_validated_cb,
+                                         data);
 }
 
 static void
@@ -642,13 +761,14 @@ local_name_entry_changed_cb (CcAddUserDialog *self)
 
         gtk_list_store_clear (self->local_username_model);
 
+        g_cancellable_cancel (self->username_choices_cancellable);
+        g_clear_object (&self->username_choices_cancellable);
+
         name = gtk_entry_get_text (self->local_name_entry);
         if ((name == NULL || strlen (name) == 0) && !self->has_custom_username) {
                 gtk_entry_set_text (self->local_username_entry, "");
         } else if (name != NULL && strlen (name) != 0) {
-                generate_username_choices (name, self->local_username_model);
-                if (!self->has_custom_username)
-                        gtk_combo_box_set_active (GTK_COMBO_BOX (self->local_username_combo), 0);
+                update_username_choices (self, name);
         }
 
         if (self->local_name_timeout_id != 0) {
@@ -1570,6 +1690,8 @@ cc_add_user_dialog_init (CcAddUserDialog *self)
 {
         GNetworkMonitor *monitor;
 
+        self->strength_checker = pw_strength_checker_new ();
+
         gtk_widget_init_template (GTK_WIDGET (self));
 
         self->cancellable = g_cancellable_new ();
@@ -1647,7 +1769,11 @@ cc_add_user_dialog_dispose (GObject *obj)
         if (self->cancellable)
                 g_cancellable_cancel (self->cancellable);
 
+        g_cancellable_cancel (self->username_choices_cancellable);
+        g_clear_object (&self->username_choices_cancellable);
+
         g_clear_object (&self->user);
+        g_clear_pointer (&self->strength_checker, pw_strength_checker_free);
 
         if (self->realmd_watch)
                 g_bus_unwatch_name (self->realmd_watch);
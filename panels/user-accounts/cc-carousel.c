@@ -292,39 +292,145 @@ cc_carousel_goto_next_page (GtkWidget *button,
         cc_carousel_select_item_at_index (self, self->visible_page * ITEMS_PER_PAGE);
 }
 
+/* Packs the items of @page and of the following pages into their boxes,
+ * after items were inserted or removed before them. The items are moved,
+ * not recreated. */
 static void
-cc_carousel_add (GtkContainer *container,
-                 GtkWidget    *widget)
+cc_carousel_repack_from_page (CcCarousel *self,
+                              gint        page)
 {
-        CcCarousel *self = CC_CAROUSEL (container);
-        gboolean last_box_is_full;
+        g_autoptr(GList) boxes = NULL;
+        GList *moved = NULL;
+        GList *l;
+        gint index;
+
+        /* Take the items out of the pages which change, and drop those pages */
+        boxes = gtk_container_get_children (GTK_CONTAINER (self->stack));
+        for (l = g_list_nth (boxes, page); l != NULL; l = l->next) {
+                g_autoptr(GList) items = NULL;
+                GList *i;
+
+                items = gtk_container_get_children (GTK_CONTAINER (l->data));
+                for (i = items; i != NULL; i = i->next) {
+                        moved = g_list_prepend (moved, g_object_ref (i->data));
+                        gtk_container_remove (GTK_CONTAINER (l->data), i->data);
+                }
+                gtk_widget_destroy (l->data);
+        }
 
-        if (!CC_IS_CAROUSEL_ITEM (widget)) {
-                GTK_CONTAINER_CLASS (cc_carousel_parent_class)->add (container, widget);
-                return;
+        /* The pages before are full */
+        self->last_box = page > 0 ? g_list_nth_data (boxes, page - 1) : NULL;
+
+        index = page * ITEMS_PER_PAGE;
+        for (l = g_list_nth (self->children, index); l != NULL; l = l->next, index++) {
+                if (index % ITEMS_PER_PAGE == 0) {
+                        self->last_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+                        gtk_widget_show (self->last_box);
+                        gtk_widget_set_valign (self->last_box, GTK_ALIGN_CENTER);
+                        gtk_container_add (GTK_CONTAINER (self->stack), self->last_box);
+                }
+
+                CC_CAROUSEL_ITEM (l->data)->page = index / ITEMS_PER_PAGE;
+                gtk_box_pack_start (GTK_BOX (self->last_box), l->data, TRUE, FALSE, 10);
         }
 
+        g_list_free_full (moved, g_object_unref);
+
+        if (self->selected_item != NULL) {
+                self->visible_page = self->selected_item->page;
+                gtk_stack_set_visible_child (self->stack,
+                                             gtk_widget_get_parent (GTK_WIDGET (self->selected_item)));
+        } else if (self->visible_page > get_last_page_number (self)) {
+                self->visible_page = get_last_page_number (self);
+        }
+
+        update_buttons_visibility (self);
+}
+
+static void
+cc_carousel_insert_item (CcCarousel     *self,
+                         CcCarouselItem *item,
+                         gint            position)
+{
+        GtkWidget *widget = GTK_WIDGET (item);
+
         gtk_style_context_add_class (gtk_widget_get_style_context (widget), "menu");
         gtk_button_set_relief (GTK_BUTTON (widget), GTK_RELIEF_NONE);
 
-        self->children = g_list_append (self->children, widget);
-        CC_CAROUSEL_ITEM (widget)->page = get_last_page_number (self);
         if (self->selected_item != NULL)
                 gtk_radio_button_join_group (GTK_RADIO_BUTTON (widget), GTK_RADIO_BUTTON (self->selected_item));
         g_signal_connect (widget, "button-press-event", G_CALLBACK (on_item_toggled), self);
 
-        last_box_is_full = ((g_list_length (self->children) - 1) % ITEMS_PER_PAGE == 0);
-        if (last_box_is_full) {
-                self->last_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
-                gtk_widget_show (self->last_box);
-                gtk_widget_set_valign (self->last_box, GTK_ALIGN_CENTER);
-                gtk_container_add (GTK_CONTAINER (self->stack), self->last_box);
+        gtk_widget_show_all (widget);
+
+        self->children = g_list_insert (self->children, widget, position);
+        if (position < 0)
+                position = g_list_length (self->children) - 1;
+
+        cc_carousel_repack_from_page (self, position / ITEMS_PER_PAGE);
+}
+
+static void
+cc_carousel_add (GtkContainer *container,
+                 GtkWidget    *widget)
+{
+        CcCarousel *self = CC_CAROUSEL (container);
+
+        if (!CC_IS_CAROUSEL_ITEM (widget)) {
+                GTK_CONTAINER_CLASS (cc_carousel_parent_class)->add (container, widget);
+                return;
         }
 
-        gtk_widget_show_all (widget);
-        gtk_box_pack_start (GTK_BOX (self->last_box), widget, TRUE, FALSE, 10);
+        cc_carousel_insert_item (self, CC_CAROUSEL_ITEM (widget), -1);
+}
 
-        update_buttons_visibility (self);
+/**
+ * cc_carousel_insert_item_sorted:
+ * @carousel: an CcCarousel instance
+ * @item: the item to insert
+ * @func: the function used to compare items
+ *
+ * Inserts @item after all the items which compare lower or equal to it.
+ * Only the pages after the insertion point are re-laid out.
+ */
+void
+cc_carousel_insert_item_sorted (CcCarousel     *self,
+                                CcCarouselItem *item,
+                                GCompareFunc    func)
+{
+        GList *l;
+        gint position = 0;
+
+        for (l = self->children; l != NULL && func (l->data, item) <= 0; l = l->next)
+                position++;
+
+        cc_carousel_insert_item (self, item, position);
+}
+
+/**
+ * cc_carousel_remove_item:
+ * @carousel: an CcCarousel instance
+ * @item: the item to remove
+ *
+ * Removes and destroys @item. If it was selected, no item is selected
+ * anymore.
+ */
+void
+cc_carousel_remove_item (CcCarousel     *self,
+                         CcCarouselItem *item)
+{
+        gint position;
+
+        position = g_list_index (self->children, item);
+        g_return_if_fail (position >= 0);
+
+        self->children = g_list_remove (self->children, item);
+        if (self->selected_item == item)
+                self->selected_item = NULL;
+
+        gtk_widget_destroy (GTK_WIDGET (item));
+
+        cc_carousel_repack_from_page (self, position / ITEMS_PER_PAGE);
 }
 
 void
@@ -38,6 +38,13 @@ CcCarousel      *cc_carousel_new         (void);
 
 void             cc_carousel_purge_items (CcCarousel     *self);
 
+void             cc_carousel_insert_item_sorted (CcCarousel     *self,
+                                                 CcCarouselItem *item,
+                                                 GCompareFunc    func);
+
+void             cc_carousel_remove_item (CcCarousel     *self,
+                                          CcCarouselItem *item);
+
 CcCarouselItem  *cc_carousel_find_item   (CcCarousel     *self,
                                           gconstpointer   data,
                                           GCompareFunc    func);
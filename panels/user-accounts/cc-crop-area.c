@@ -32,6 +32,8 @@ struct _CcCropArea {
         GtkDrawingArea parent_instance;
 
         GdkPixbuf *browse_pixbuf;
+        /* browse_pixbuf, downsampled to at most the size of the screen */
+        GdkPixbuf *working_pixbuf;
         GdkPixbuf *pixbuf;
         GdkPixbuf *color_shifted;
         gdouble scale;
@@ -48,12 +50,9 @@ struct _CcCropArea {
 
 G_DEFINE_TYPE (CcCropArea, cc_crop_area, GTK_TYPE_DRAWING_AREA);
 
-static inline guchar
-shift_color_byte (guchar b,
-                  int    shift)
-{
-        return CLAMP(b + shift, 0, 255);
-}
+/* Working copies never need to be larger than the screen, as the
+ * widget cannot be. This is used when there is no monitor yet. */
+#define FALLBACK_WORKING_SIZE 2048
 
 static void
 shift_colors (GdkPixbuf *pixbuf,
@@ -62,7 +61,9 @@ shift_colors (GdkPixbuf *pixbuf,
               gint       blue,
               gint       alpha)
 {
-        gint x, y, offset, y_offset, rowstride, width, height;
+        g_autofree gint16 *row_shifts = NULL;
+        gint x, y, row_length, rowstride, width, height;
+        gint16 shifts[4];
         guchar *pixels;
         gint channels;
 
@@ -72,22 +73,76 @@ shift_colors (GdkPixbuf *pixbuf,
         pixels = gdk_pixbuf_get_pixels (pixbuf);
         channels = gdk_pixbuf_get_n_channels (pixbuf);
 
+        shifts[0] = red;
+        shifts[1] = green;
+        shifts[2] = blue;
+        shifts[3] = alpha;
+
+        /* Spell out the shift of every byte of a row, so that the loop
+         * below has no branches and the compiler can vectorize it */
+        row_length = width * channels;
+        row_shifts = g_new (gint16, row_length);
+        for (x = 0; x < row_length; x++)
+                row_shifts[x] = shifts[x % channels];
+
         for (y = 0; y < height; y++) {
-                y_offset = y * rowstride;
-                for (x = 0; x < width; x++) {
-                        offset = y_offset + x * channels;
-                        if (red != 0)
-                                pixels[offset] = shift_color_byte (pixels[offset], red);
-                        if (green != 0)
-                                pixels[offset + 1] = shift_color_byte (pixels[offset + 1], green);
-                        if (blue != 0)
-                                pixels[offset + 2] = shift_color_byte (pixels[offset + 2], blue);
-                        if (alpha != 0 && channels >= 4)
-                                pixels[offset + 3] = shift_color_byte (pixels[offset + 3], blue);
+                guchar *row = pixels + y * rowstride;
+
+                for (x = 0; x < row_length; x++) {
+                        gint16 value = row[x] + row_shifts[x];
+
+                        row[x] = CLAMP (value, 0, 255);
                 }
         }
 }
 
+static gint
+get_max_working_size (CcCropArea *area)
+{
+        GdkDisplay *display;
+        gint max_size = 0;
+        gint i;
+
+        display = gtk_widget_get_display (GTK_WIDGET (area));
+        for (i = 0; i < gdk_display_get_n_monitors (display); i++) {
+                GdkRectangle geometry;
+
+                gdk_monitor_get_geometry (gdk_display_get_monitor (display, i), &geometry);
+                max_size = MAX (max_size, MAX (geometry.width, geometry.height));
+        }
+
+        return max_size > 0 ? max_size : FALLBACK_WORKING_SIZE;
+}
+
+static void
+update_working_pixbuf (CcCropArea *area)
+{
+        gint width, height, max_size;
+        gdouble scale;
+
+        g_clear_object (&area->working_pixbuf);
+
+        if (area->browse_pixbuf == NULL)
+                return;
+
+        width = gdk_pixbuf_get_width (area->browse_pixbuf);
+        height = gdk_pixbuf_get_height (area->browse_pixbuf);
+        max_size = get_max_working_size (area);
+
+        if (width <= max_size && height <= max_size) {
+                area->working_pixbuf = g_object_ref (area->browse_pixbuf);
+                return;
+        }
+
+        /* Rescaling while the dialog is resized then only depends on
+         * the size of the screen, not on the size of the picture */
+        scale = MIN ((gdouble) max_size / width, (gdouble) max_size / height);
+        area->working_pixbuf = gdk_pixbuf_scale_simple (area->browse_pixbuf,
+                                                        MAX (1, width * scale),
+                                                        MAX (1, height * scale),
+                                                        GDK_INTERP_BILINEAR);
+}
+
 static void
 update_pixbufs (CcCropArea *area)
 {
@@ -101,6 +156,8 @@ update_pixbufs (CcCropArea *area)
         widget = GTK_WIDGET (area);
         gtk_widget_get_allocation (widget, &allocation);
 
+        /* The crop rectangle and the scale are relative to the
+         * original picture, only the drawing uses the working copy */
         width = gdk_pixbuf_get_width (area->browse_pixbuf);
         height = gdk_pixbuf_get_height (area->browse_pixbuf);
 
@@ -108,26 +165,19 @@ update_pixbufs (CcCropArea *area)
         if (scale * width > allocation.width)
                 scale = allocation.width / (gdouble)width;
 
-        dest_width = width * scale;
-        dest_height = height * scale;
+        dest_width = MAX (1, width * scale);
+        dest_height = MAX (1, height * scale);
 
         if (area->pixbuf == NULL ||
-            gdk_pixbuf_get_width (area->pixbuf) != allocation.width ||
-            gdk_pixbuf_get_height (area->pixbuf) != allocation.height) {
+            gdk_pixbuf_get_width (area->pixbuf) != dest_width ||
+            gdk_pixbuf_get_height (area->pixbuf) != dest_height) {
+                if (area->working_pixbuf == NULL)
+                        update_working_pixbuf (area);
+
                 g_clear_object (&area->pixbuf);
-                area->pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
-                                                     gdk_pixbuf_get_has_alpha (area->browse_pixbuf),
-                                                     8,
-                                                     dest_width, dest_height);
-                gdk_pixbuf_fill (area->pixbuf, 0x0);
-
-                gdk_pixbuf_scale (area->browse_pixbuf,
-                                  area->pixbuf,
-                                  0, 0,
-                                  dest_width, dest_height,
-                                  0, 0,
-                                  scale, scale,
-                                  GDK_INTERP_BILINEAR);
+                area->pixbuf = gdk_pixbuf_scale_simple (area->working_pixbuf,
+                                                        dest_width, dest_height,
+                                                        GDK_INTERP_BILINEAR);
 
                 g_clear_object (&area->color_shifted);
                 area->color_shifted = gdk_pixbuf_copy (area->pixbuf);
@@ -148,13 +198,13 @@ update_pixbufs (CcCropArea *area)
                         area->crop.x = (gdk_pixbuf_get_width (area->browse_pixbuf) - area->crop.width) / 2;
                         area->crop.y = (gdk_pixbuf_get_height (area->browse_pixbuf) - area->crop.height) / 2;
                 }
-
-                area->scale = scale;
-                area->image.x = (allocation.width - dest_width) / 2;
-                area->image.y = (allocation.height - dest_height) / 2;
-                area->image.width = dest_width;
-                area->image.height = dest_height;
         }
+
+        area->scale = scale;
+        area->image.x = (allocation.width - dest_width) / 2;
+        area->image.y = (allocation.height - dest_height) / 2;
+        area->image.width = dest_width;
+        area->image.height = dest_height;
 }
 
 static void
@@ -695,6 +745,7 @@ cc_crop_area_finalize (GObject *object)
         CcCropArea *area = CC_CROP_AREA (object);
 
         g_clear_object (&area->browse_pixbuf);
+        g_clear_object (&area->working_pixbuf);
         g_clear_object (&area->pixbuf);
         g_clear_object (&area->color_shifted);
 
@@ -767,6 +818,9 @@ cc_crop_area_set_picture (CcCropArea *area,
                 g_object_unref (area->browse_pixbuf);
                 area->browse_pixbuf = NULL;
         }
+        g_clear_object (&area->working_pixbuf);
+        g_clear_object (&area->pixbuf);
+        g_clear_object (&area->color_shifted);
         if (pixbuf) {
                 area->browse_pixbuf = g_object_ref (pixbuf);
                 width = gdk_pixbuf_get_width (pixbuf);
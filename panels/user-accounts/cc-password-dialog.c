@@ -64,10 +64,41 @@ struct _CcPasswordDialog
         gint                old_password_entry_timeout_id;
 
         PasswdHandler      *passwd_handler;
+
+        PwStrengthChecker  *strength_checker;
 };
 
 G_DEFINE_TYPE (CcPasswordDialog, cc_password_dialog, HDY_TYPE_DIALOG)
 
+static gint update_password_strength (CcPasswordDialog *self);
+
+static void
+password_strength_checked_cb (GObject      *source_object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+        g_autoptr(CcPasswordDialog) self = CC_PASSWORD_DIALOG (user_data);
+        g_autoptr(GError) error = NULL;
+        const gchar *hint;
+
+        pw_strength_checker_check_finish (result, &hint, NULL, &error);
+        if (error != NULL) {
+                if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                        g_warning ("Failed to check the password: %s", error->message);
+                return;
+        }
+
+        /* Wait for the next check if the password changed in the meantime */
+        if (!pw_strength_checker_lookup (self->strength_checker,
+                                         gtk_entry_get_text (self->password_entry),
+                                         gtk_entry_get_text (self->old_password_entry),
+                                         act_user_get_user_name (self->user),
+                                         &hint, NULL))
+                return;
+
+        update_password_strength (self);
+}
+
 static gint
 update_password_strength (CcPasswordDialog *self)
 {
@@ -82,11 +113,22 @@ update_password_strength (CcPasswordDialog *self)
         old_password = gtk_entry_get_text (self->old_password_entry);
         username = act_user_get_user_name (self->user);
 
-        pw_strength (password, old_password, username,
-                     &hint, &strength_level);
-
-        gtk_level_bar_set_value (self->strength_indicator, strength_level);
-        gtk_label_set_label (self->password_hint_label, hint);
+        /* The check is done in a thread, and this is called again
+         * once the result is known. Meanwhile, the hint of the previous
+         * password is cleared. */
+        if (pw_strength_checker_lookup (self->strength_checker,
+                                        password, old_password, username,
+                                        &hint, &strength_level)) {
+                gtk_level_bar_set_value (self->strength_indicator, strength_level);
+                gtk_label_set_label (self->password_hint_label, hint);
+        } else {
+                pw_strength_checker_check_async (self->strength_checker,
+                                                 password, old_password, username,
+                                                 password_strength_checked_cb,
+                                                 g_object_ref (self));
+                gtk_level_bar_set_value (self->strength_indicator, 0);
+                gtk_label_set_label (self->password_hint_label, "");
+        }
 
         strength_level = (strlen (password) >= MINIMUM_PASSCODE_LENGTH) + 1; /* Hack */
 
@@ -436,6 +478,7 @@ cc_password_dialog_dispose (GObject *object)
         CcPasswordDialog *self = CC_PASSWORD_DIALOG (object);
 
         g_clear_object (&self->user);
+        g_clear_pointer (&self->strength_checker, pw_strength_checker_free);
 
         if (self->passwd_handler) {
                 passwd_destroy (self->passwd_handler);
@@ -495,6 +538,8 @@ cc_password_dialog_init (CcPasswordDialog *self)
 {
         g_resources_register (cc_user_accounts_get_resource ());
 
+        self->strength_checker = pw_strength_checker_new ();
+
         gtk_widget_init_template (GTK_WIDGET (self));
 }
 
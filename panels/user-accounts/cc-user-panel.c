@@ -103,13 +103,16 @@ struct _CcUserPanel {
 
         CcAvatarChooser *avatar_chooser;
 
+        /* uid → CcCarouselItem, for the non-system users */
+        GHashTable *carousel_items;
+        /* uids of the unlocked administrators */
+        GHashTable *active_admins;
         gint other_accounts;
 };
 
 CC_PANEL_REGISTER (CcUserPanel, cc_user_panel)
 
 static void show_restart_notification (CcUserPanel *self, const gchar *locale);
-static gint user_compare (gconstpointer i, gconstpointer u);
 
 typedef struct {
         CcUserPanel *self;
@@ -221,64 +224,235 @@ create_carousel_entry (CcUserPanel *self, ActUser *user)
         return box;
 }
 
-static void
-user_added (CcUserPanel *self, ActUser *user)
+static gint
+compare_carousel_items (gconstpointer a, gconstpointer b)
 {
-        GtkWidget *item, *widget;
-        gboolean show_carousel;
+        uid_t uid_a, uid_b;
 
-        if (act_user_is_system_account (user)) {
-                return;
-        }
+        uid_a = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (a), "uid"));
+        uid_b = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (b), "uid"));
 
-        g_debug ("user added: %d %s\n", act_user_get_uid (user), get_real_or_user_name (user));
+        /* Make sure the current user is shown first */
+        if (uid_a == getuid ())
+                return uid_b == getuid () ? 0 : -1;
+        else if (uid_b == getuid ())
+                return 1;
+
+        return strcmp (g_object_get_data (G_OBJECT (a), "sort-key"),
+                       g_object_get_data (G_OBJECT (b), "sort-key"));
+}
+
+static CcCarouselItem *
+create_carousel_item (CcUserPanel *self, ActUser *user)
+{
+        GtkWidget *item;
 
-        widget = create_carousel_entry (self, user);
         item = cc_carousel_item_new ();
-        gtk_container_add (GTK_CONTAINER (item), widget);
+        gtk_container_add (GTK_CONTAINER (item), create_carousel_entry (self, user));
 
         g_object_set_data (G_OBJECT (item), "uid", GINT_TO_POINTER (act_user_get_uid (user)));
-        gtk_container_add (GTK_CONTAINER (self->carousel), item);
+        g_object_set_data_full (G_OBJECT (item), "sort-key",
+                                g_utf8_collate_key (get_real_or_user_name (user), -1),
+                                g_free);
+
+        return CC_CAROUSEL_ITEM (item);
+}
+
+static void
+insert_carousel_item (CcUserPanel *self, CcCarouselItem *item)
+{
+        uid_t uid;
 
-        if (act_user_get_uid (user) != getuid ()) {
+        uid = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "uid"));
+        g_hash_table_insert (self->carousel_items, GINT_TO_POINTER (uid), item);
+        cc_carousel_insert_item_sorted (self->carousel, item, compare_carousel_items);
+
+        if (uid != getuid ()) {
                 self->other_accounts++;
         }
+}
+
+static void
+remove_carousel_item (CcUserPanel *self, CcCarouselItem *item)
+{
+        uid_t uid;
+
+        uid = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "uid"));
+        g_hash_table_remove (self->carousel_items, GINT_TO_POINTER (uid));
+        cc_carousel_remove_item (self->carousel, item);
+
+        if (uid != getuid ()) {
+                self->other_accounts--;
+        }
+}
 
-        /* Show heading for other accounts if new one have been added. */
-        show_carousel = (self->other_accounts > 0);
-        gtk_revealer_set_reveal_child (GTK_REVEALER (self->carousel), show_carousel);
+static void
+update_carousel_visibility (CcUserPanel *self)
+{
+        if (cc_carousel_get_item_count (self->carousel) == 0)
+                gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->no_users_box));
+        else
+                gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->users_overlay));
 
-        gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->users_overlay));
+        /* Only show the heading for other accounts if there are some */
+        gtk_revealer_set_reveal_child (GTK_REVEALER (self->carousel), self->other_accounts > 0);
 }
 
-static gint
-sort_users (gconstpointer a, gconstpointer b)
+static gboolean
+disable_carousel_animations (CcUserPanel *self)
 {
-        ActUser *ua, *ub;
-        gchar *name1, *name2;
-        gint result;
+        GtkSettings *settings;
+        gboolean animations;
 
-        ua = ACT_USER (a);
-        ub = ACT_USER (b);
+        settings = gtk_widget_get_settings (GTK_WIDGET (self->carousel));
 
-        /* Make sure the current user is shown first */
-        if (act_user_get_uid (ua) == getuid ()) {
-                result = -G_MAXINT32;
+        g_object_get (settings, "gtk-enable-animations", &animations, NULL);
+        g_object_set (settings, "gtk-enable-animations", FALSE, NULL);
+
+        return animations;
+}
+
+static void
+restore_carousel_animations (CcUserPanel *self, gboolean animations)
+{
+        GtkSettings *settings;
+
+        settings = gtk_widget_get_settings (GTK_WIDGET (self->carousel));
+        g_object_set (settings, "gtk-enable-animations", animations, NULL);
+}
+
+static void
+update_active_admin (CcUserPanel *self, ActUser *user)
+{
+        gpointer uid = GINT_TO_POINTER (act_user_get_uid (user));
+
+        if (act_user_get_account_type (user) == ACT_USER_ACCOUNT_TYPE_ADMINISTRATOR &&
+            !act_user_get_locked (user))
+                g_hash_table_add (self->active_admins, uid);
+        else
+                g_hash_table_remove (self->active_admins, uid);
+}
+
+static gboolean
+is_selected_user (CcUserPanel *self, ActUser *user)
+{
+        return self->selected_user != NULL &&
+               act_user_get_uid (self->selected_user) == act_user_get_uid (user);
+}
+
+static void
+select_current_user (CcUserPanel *self)
+{
+        CcCarouselItem *item = NULL;
+
+        if (self->selected_user != NULL)
+                item = g_hash_table_lookup (self->carousel_items,
+                                            GINT_TO_POINTER (act_user_get_uid (self->selected_user)));
+
+        /* This shows the user again, so that "Account Type" is only
+         * visible when there are other accounts */
+        cc_carousel_select_item (self->carousel, item);
+}
+
+static void
+user_added (CcUserPanel *self, ActUser *user)
+{
+        gboolean animations;
+
+        update_active_admin (self, user);
+
+        if (act_user_is_system_account (user) ||
+            g_hash_table_contains (self->carousel_items, GINT_TO_POINTER (act_user_get_uid (user)))) {
+                return;
         }
-        else if (act_user_get_uid (ub) == getuid ()) {
-                result = G_MAXINT32;
+
+        g_debug ("user added: %d %s\n", act_user_get_uid (user), get_real_or_user_name (user));
+
+        animations = disable_carousel_animations (self);
+
+        insert_carousel_item (self, create_carousel_item (self, user));
+        update_carousel_visibility (self);
+        select_current_user (self);
+
+        restore_carousel_animations (self, animations);
+}
+
+static void
+remove_user_item (CcUserPanel *self, ActUser *user, CcCarouselItem *item)
+{
+        gboolean animations;
+
+        g_debug ("user removed: %d %s\n", act_user_get_uid (user), get_real_or_user_name (user));
+
+        animations = disable_carousel_animations (self);
+
+        remove_carousel_item (self, item);
+        update_carousel_visibility (self);
+
+        if (is_selected_user (self, user))
+                g_clear_object (&self->selected_user);
+        select_current_user (self);
+
+        restore_carousel_animations (self, animations);
+}
+
+static void
+user_removed (CcUserPanel *self, ActUser *user)
+{
+        CcCarouselItem *item;
+
+        g_hash_table_remove (self->active_admins, GINT_TO_POINTER (act_user_get_uid (user)));
+
+        item = g_hash_table_lookup (self->carousel_items, GINT_TO_POINTER (act_user_get_uid (user)));
+        if (item != NULL)
+                remove_user_item (self, user, item);
+}
+
+static void
+user_changed (CcUserPanel *self, ActUser *user)
+{
+        CcCarouselItem *item;
+        GtkWidget *entry;
+        g_autofree gchar *sort_key = NULL;
+        gboolean animations;
+        guint num_admin;
+
+        item = g_hash_table_lookup (self->carousel_items, GINT_TO_POINTER (act_user_get_uid (user)));
+        if (item == NULL) {
+                user_added (self, user);
+                return;
         }
-        else {
-                name1 = g_utf8_collate_key (get_real_or_user_name (ua), -1);
-                name2 = g_utf8_collate_key (get_real_or_user_name (ub), -1);
 
-                result = strcmp (name1, name2);
+        num_admin = g_hash_table_size (self->active_admins);
+        update_active_admin (self, user);
+
+        if (act_user_is_system_account (user)) {
+                remove_user_item (self, user, item);
+                return;
+        }
 
-                g_free (name1);
-                g_free (name2);
+        sort_key = g_utf8_collate_key (get_real_or_user_name (user), -1);
+        if (g_strcmp0 (sort_key, g_object_get_data (G_OBJECT (item), "sort-key")) == 0) {
+                /* The position is unchanged, only refresh the avatar and labels */
+                gtk_widget_destroy (gtk_bin_get_child (GTK_BIN (item)));
+                entry = create_carousel_entry (self, user);
+                gtk_widget_show_all (entry);
+                gtk_container_add (GTK_CONTAINER (item), entry);
+
+                /* Whether the selected user is the only administrator may have changed too */
+                if (self->selected_user != NULL &&
+                    (is_selected_user (self, user) || num_admin != g_hash_table_size (self->active_admins)))
+                        show_user (self->selected_user, self);
+                return;
         }
 
-        return result;
+        animations = disable_carousel_animations (self);
+
+        remove_carousel_item (self, item);
+        insert_carousel_item (self, create_carousel_item (self, user));
+        select_current_user (self);
+
+        restore_carousel_animations (self, animations);
 }
 
 static void
@@ -286,65 +460,53 @@ reload_users (CcUserPanel *self, ActUser *selected_user)
 {
         ActUser *user;
         GSList *list, *l;
+        GList *items = NULL, *i;
         CcCarouselItem *item = NULL;
-        GtkSettings *settings;
         gboolean animations;
 
-        settings = gtk_widget_get_settings (GTK_WIDGET (self->carousel));
-
-        g_object_get (settings, "gtk-enable-animations", &animations, NULL);
-        g_object_set (settings, "gtk-enable-animations", FALSE, NULL);
+        animations = disable_carousel_animations (self);
 
         cc_carousel_purge_items (self->carousel);
+        g_hash_table_remove_all (self->carousel_items);
+        g_hash_table_remove_all (self->active_admins);
         self->other_accounts = 0;
 
         list = act_user_manager_list_users (self->um);
         g_debug ("Got %d users\n", g_slist_length (list));
 
-        list = g_slist_sort (list, (GCompareFunc) sort_users);
         for (l = list; l; l = l->next) {
                 user = l->data;
+                update_active_admin (self, user);
+
+                if (act_user_is_system_account (user))
+                        continue;
+
                 g_debug ("adding user %s\n", get_real_or_user_name (user));
-                user_added (self, user);
+                items = g_list_prepend (items, create_carousel_item (self, user));
         }
         g_slist_free (list);
 
-        if (cc_carousel_get_item_count (self->carousel) == 0)
-                gtk_stack_set_visible_child (self->stack, GTK_WIDGET (self->no_users_box));
-        if (self->other_accounts == 0)
-                gtk_revealer_set_reveal_child (GTK_REVEALER (self->carousel), FALSE);
+        /* The items are appended in order, so that each one is only packed once */
+        items = g_list_sort (items, compare_carousel_items);
+        for (i = items; i; i = i->next) {
+                uid_t uid = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (i->data), "uid"));
 
-        if (selected_user)
-                item = cc_carousel_find_item (self->carousel, selected_user, user_compare);
-        cc_carousel_select_item (self->carousel, item);
-
-        g_object_set (settings, "gtk-enable-animations", animations, NULL);
-}
+                g_hash_table_insert (self->carousel_items, GINT_TO_POINTER (uid), i->data);
+                gtk_container_add (GTK_CONTAINER (self->carousel), i->data);
 
-static gint
-user_compare (gconstpointer i,
-              gconstpointer u)
-{
-        CcCarouselItem *item;
-        ActUser *user;
-        gint uid_a, uid_b;
-        gint result;
-
-        item = (CcCarouselItem *) i;
-        user = ACT_USER (u);
-
-        uid_a = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "uid"));
-        uid_b = act_user_get_uid (user);
+                if (uid != getuid ()) {
+                        self->other_accounts++;
+                }
+        }
+        g_list_free (items);
 
-        result = uid_a - uid_b;
+        update_carousel_visibility (self);
 
-        return result;
-}
+        if (selected_user)
+                item = g_hash_table_lookup (self->carousel_items, GINT_TO_POINTER (act_user_get_uid (selected_user)));
+        cc_carousel_select_item (self->carousel, item);
 
-static void
-user_changed (CcUserPanel *self, ActUser *user)
-{
-        reload_users (self, self->selected_user);
+        restore_carousel_animations (self, animations);
 }
 
 static void
@@ -364,7 +526,10 @@ add_user (CcUserPanel *self)
         user = cc_add_user_dialog_get_user (dialog);
         if (user != NULL) {
                 set_default_avatar (user);
-                reload_users (self, user);
+                user_added (self, user);
+                cc_carousel_select_item (self->carousel,
+                                         g_hash_table_lookup (self->carousel_items,
+                                                              GINT_TO_POINTER (act_user_get_uid (user))));
         }
 
         gtk_widget_destroy (GTK_WIDGET (dialog));
@@ -378,6 +543,7 @@ delete_user_done (ActUserManager *manager,
         GError *error;
 
         error = NULL;
+        clear_username_cache ();
         if (!act_user_manager_delete_user_finish (manager, res, &error)) {
                 if (!g_error_matches (error, ACT_USER_MANAGER_ERROR,
                                       ACT_USER_MANAGER_ERROR_PERMISSION_DENIED))
@@ -1148,7 +1314,7 @@ users_loaded (CcUserPanel *self)
         g_signal_connect_object (self->um, "user-changed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
         g_signal_connect_object (self->um, "user-is-logged-in-changed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
         g_signal_connect_object (self->um, "user-added", G_CALLBACK (user_added), self, G_CONNECT_SWAPPED);
-        g_signal_connect_object (self->um, "user-removed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (self->um, "user-removed", G_CALLBACK (user_removed), self, G_CONNECT_SWAPPED);
 
         reload_users (self, NULL);
 }
@@ -1184,30 +1350,9 @@ remove_unlock_tooltip (GtkWidget *widget)
                                               G_CALLBACK (show_tooltip_now), NULL);
 }
 
-static guint
-get_num_active_admin (ActUserManager *um)
-{
-        GSList *list;
-        GSList *l;
-        guint num_admin = 0;
-
-        list = act_user_manager_list_users (um);
-        for (l = list; l != NULL; l = l->next) {
-                ActUser *u = l->data;
-                if (act_user_get_account_type (u) == ACT_USER_ACCOUNT_TYPE_ADMINISTRATOR && !act_user_get_locked (u)) {
-                        num_admin++;
-                }
-        }
-        g_slist_free (list);
-
-        return num_admin;
-}
-
 static gboolean
-would_demote_only_admin (ActUser *user)
+would_demote_only_admin (CcUserPanel *self, ActUser *user)
 {
-        ActUserManager *um = act_user_manager_get_default ();
-
         /* Prevent the user from demoting the only admin account.
          * Returns TRUE when user is an administrator and there is only
          * one enabled administrator. */
@@ -1216,7 +1361,7 @@ would_demote_only_admin (ActUser *user)
             act_user_get_locked (user))
                 return FALSE;
 
-        if (get_num_active_admin (um) > 1)
+        if (g_hash_table_size (self->active_admins) > 1)
                 return FALSE;
 
         return TRUE;
@@ -1258,7 +1403,7 @@ on_permission_changed (CcUserPanel *self)
 
         self_selected = act_user_get_uid (user) == geteuid ();
         gtk_widget_set_sensitive (GTK_WIDGET (self->remove_user_button), is_authorized && !self_selected
-                                  && !would_demote_only_admin (user));
+                                  && !would_demote_only_admin (self, user));
         if (is_authorized) {
                 setup_tooltip_with_embedded_icon (GTK_WIDGET (self->remove_user_button), _("Delete the selected user account"), NULL, NULL);
         }
@@ -1285,7 +1430,7 @@ on_permission_changed (CcUserPanel *self)
                 remove_unlock_tooltip (GTK_WIDGET (self->autologin_row));
 
         } else if (is_authorized && act_user_is_local_account (user)) {
-                if (would_demote_only_admin (user)) {
+                if (would_demote_only_admin (self, user)) {
                         gtk_widget_set_sensitive (GTK_WIDGET (self->account_type_row), FALSE);
                 } else {
                         gtk_widget_set_sensitive (GTK_WIDGET (self->account_type_row), TRUE);
@@ -1297,7 +1442,7 @@ on_permission_changed (CcUserPanel *self)
         }
         else {
                 gtk_widget_set_sensitive (GTK_WIDGET (self->account_type_row), FALSE);
-                if (would_demote_only_admin (user)) {
+                if (would_demote_only_admin (self, user)) {
                         remove_unlock_tooltip (GTK_WIDGET (self->account_type_row));
                 } else {
                         add_unlock_tooltip (GTK_WIDGET (self->account_type_row));
@@ -1455,6 +1600,8 @@ cc_user_panel_init (CcUserPanel *self)
         gtk_widget_init_template (GTK_WIDGET (self));
 
         self->um = act_user_manager_get_default ();
+        self->carousel_items = g_hash_table_new (g_direct_hash, g_direct_equal);
+        self->active_admins = g_hash_table_new (g_direct_hash, g_direct_equal);
 
         provider = gtk_css_provider_new ();
         gtk_css_provider_load_from_resource (provider, "/org/gnome/control-center/user-accounts/user-accounts-dialog.css");
@@ -1481,6 +1628,18 @@ cc_user_panel_dispose (GObject *object)
         G_OBJECT_CLASS (cc_user_panel_parent_class)->dispose (object);
 }
 
+static void
+cc_user_panel_finalize (GObject *object)
+{
+        CcUserPanel *self = CC_USER_PANEL (object);
+
+        /* The user manager handlers use these until the panel is finalized */
+        g_clear_pointer (&self->carousel_items, g_hash_table_unref);
+        g_clear_pointer (&self->active_admins, g_hash_table_unref);
+
+        G_OBJECT_CLASS (cc_user_panel_parent_class)->finalize (object);
+}
+
 static const char *
 cc_user_panel_get_help_uri (CcPanel *panel)
 {
@@ -1495,6 +1654,7 @@ cc_user_panel_class_init (CcUserPanelClass *klass)
         CcPanelClass   *panel_class  = CC_PANEL_CLASS (klass);
 
         object_class->dispose = cc_user_panel_dispose;
+        object_class->finalize = cc_user_panel_finalize;
         object_class->constructed = cc_user_panel_constructed;
 
         panel_class->get_help_uri = cc_user_panel_get_help_uri;
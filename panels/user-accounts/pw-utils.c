@@ -24,31 +24,64 @@
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <string.h>
 
 #include <pwquality.h>
 
+/* pwquality_check() may be slow with cracklib, and is not thread-safe */
+G_LOCK_DEFINE_STATIC (pwq_check);
+
+#define RESULT_KEY_SIZE 32
+
+struct _PwStrengthChecker
+{
+        GHashTable   *results;     /* HMAC → PwStrengthResult */
+        guchar        result_key[RESULT_KEY_SIZE];
+        GCancellable *cancellable; /* of the request in flight */
+};
+
+typedef struct
+{
+        gdouble      strength;
+        gint         level;
+        const gchar *hint;
+} PwStrengthResult;
+
+typedef struct
+{
+        PwStrengthChecker *checker;
+        gchar             *key;
+        gchar             *password;
+        gchar             *old_password;
+        gchar             *username;
+} CheckData;
+
 static pwquality_settings_t *
 get_pwq (void)
 {
         static pwquality_settings_t *settings;
 
-        if (settings == NULL) {
+        if (g_once_init_enter (&settings)) {
+                pwquality_settings_t *new_settings;
                 gchar *err = NULL;
                 gint rv = 0;
 
-                settings = pwquality_default_settings ();
-                pwquality_set_int_value (settings, PWQ_SETTING_MAX_SEQUENCE, 4);
+                new_settings = pwquality_default_settings ();
+                pwquality_set_int_value (new_settings, PWQ_SETTING_MAX_SEQUENCE, 4);
 
-                rv = pwquality_read_config (settings, NULL, (gpointer)&err);
+                rv = pwquality_read_config (new_settings, NULL, (gpointer)&err);
                 if (rv < 0) {
                         g_warning ("failed to read pwquality configuration: %s\n",
                                    pwquality_strerror (NULL, 0, rv, err));
-                        pwquality_free_settings (settings);
+                        pwquality_free_settings (new_settings);
 
                         /* Load just default settings in case of failure. */
-                        settings = pwquality_default_settings ();
-                        pwquality_set_int_value (settings, PWQ_SETTING_MAX_SEQUENCE, 4);
+                        new_settings = pwquality_default_settings ();
+                        pwquality_set_int_value (new_settings, PWQ_SETTING_MAX_SEQUENCE, 4);
                 }
+
+                g_once_init_leave (&settings, new_settings);
         }
 
         return settings;
@@ -133,21 +166,32 @@ pw_error_hint (gint error)
         }
 }
 
-gdouble
-pw_strength (const gchar  *password,
-             const gchar  *old_password,
-             const gchar  *username,
-             const gchar **hint,
-             gint         *strength_level)
+/* Returns %FALSE if @cancellable was cancelled before the check started */
+static gboolean
+check_password (const gchar      *password,
+                const gchar      *old_password,
+                const gchar      *username,
+                GCancellable     *cancellable,
+                PwStrengthResult *result)
 {
         gint rv, level, length = 0;
         gdouble strength = 0.0;
         void *auxerror;
 
+        G_LOCK (pwq_check);
+
+        /* Superseded requests queue up here, skip them */
+        if (g_cancellable_is_cancelled (cancellable)) {
+                G_UNLOCK (pwq_check);
+                return FALSE;
+        }
+
         rv = pwquality_check (get_pwq (),
                               password, old_password, username,
                               &auxerror);
 
+        G_UNLOCK (pwq_check);
+
         if (password != NULL)
                 length = strlen (password);
 
@@ -166,12 +210,216 @@ pw_strength (const gchar  *password,
         }
 
         if (length && length < pw_min_length())
-                *hint = pw_error_hint (PWQ_ERROR_MIN_LENGTH);
+                result->hint = pw_error_hint (PWQ_ERROR_MIN_LENGTH);
         else
-                *hint = pw_error_hint (rv);
+                result->hint = pw_error_hint (rv);
+
+        result->strength = strength;
+        result->level = level;
+
+        return TRUE;
+}
+
+gdouble
+pw_strength (const gchar  *password,
+             const gchar  *old_password,
+             const gchar  *username,
+             const gchar **hint,
+             gint         *strength_level)
+{
+        PwStrengthResult result;
+
+        check_password (password, old_password, username, NULL, &result);
+
+        *hint = result.hint;
+        if (strength_level)
+                *strength_level = result.level;
+
+        return result.strength;
+}
+
+/* The passwords themselves are not kept around in the results table.
+ * They are keyed on an HMAC with a random key of the checker, so the
+ * table can't be matched against precomputed hashes of passwords. */
+static gchar *
+get_result_key (PwStrengthChecker *checker,
+                const gchar       *password,
+                const gchar       *old_password,
+                const gchar       *username)
+{
+        g_autoptr(GHmac) hmac = NULL;
+
+        hmac = g_hmac_new (G_CHECKSUM_SHA256, checker->result_key, RESULT_KEY_SIZE);
+        g_hmac_update (hmac, (const guchar *) (password ? password : ""), -1);
+        g_hmac_update (hmac, (const guchar *) "", 1);
+        g_hmac_update (hmac, (const guchar *) (old_password ? old_password : ""), -1);
+        g_hmac_update (hmac, (const guchar *) "", 1);
+        g_hmac_update (hmac, (const guchar *) (username ? username : ""), -1);
+
+        return g_strdup (g_hmac_get_string (hmac));
+}
+
+static void
+check_data_free (CheckData *data)
+{
+        g_free (data->key);
+        g_free (data->password);
+        g_free (data->old_password);
+        g_free (data->username);
+        g_free (data);
+}
+
+/**
+ * pw_strength_checker_new:
+ *
+ * Creates a checker which evaluates passwords in a thread, and remembers
+ * the results for as long as it lives, typically the lifetime of a dialog.
+ */
+PwStrengthChecker *
+pw_strength_checker_new (void)
+{
+        PwStrengthChecker *checker;
+        guint i;
+
+        checker = g_new0 (PwStrengthChecker, 1);
+        checker->results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+        for (i = 0; i < RESULT_KEY_SIZE; i++)
+                checker->result_key[i] = g_random_int_range (0, 256);
+
+        return checker;
+}
+
+void
+pw_strength_checker_free (PwStrengthChecker *checker)
+{
+        g_return_if_fail (checker != NULL);
+
+        g_cancellable_cancel (checker->cancellable);
+        g_clear_object (&checker->cancellable);
+        g_hash_table_unref (checker->results);
+        memset (checker->result_key, 0, RESULT_KEY_SIZE);
+        g_free (checker);
+}
+
+/**
+ * pw_strength_checker_lookup:
+ *
+ * Returns: %TRUE and sets @hint and @strength_level if the password
+ * was already checked, %FALSE otherwise.
+ */
+gboolean
+pw_strength_checker_lookup (PwStrengthChecker  *checker,
+                            const gchar        *password,
+                            const gchar        *old_password,
+                            const gchar        *username,
+                            const gchar       **hint,
+                            gint               *strength_level)
+{
+        g_autofree gchar *key = NULL;
+        PwStrengthResult *result;
+
+        g_return_val_if_fail (checker != NULL, FALSE);
+
+        key = get_result_key (checker, password, old_password, username);
+        result = g_hash_table_lookup (checker->results, key);
+        if (result == NULL)
+                return FALSE;
+
+        *hint = result->hint;
+        if (strength_level)
+                *strength_level = result->level;
+
+        return TRUE;
+}
+
+static void
+check_thread_func (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+        CheckData *data = task_data;
+        PwStrengthResult *result;
+
+        result = g_new0 (PwStrengthResult, 1);
+        if (!check_password (data->password, data->old_password, data->username,
+                             cancellable, result)) {
+                g_free (result);
+                g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                                         "The password check was superseded");
+                return;
+        }
+
+        g_task_return_pointer (task, result, g_free);
+}
+
+/**
+ * pw_strength_checker_check_async:
+ *
+ * Checks the password in a thread. Any check still in flight is
+ * cancelled, so only the latest one completes.
+ */
+void
+pw_strength_checker_check_async (PwStrengthChecker   *checker,
+                                 const gchar         *password,
+                                 const gchar         *old_password,
+                                 const gchar         *username,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+        g_autoptr(GTask) task = NULL;
+        CheckData *data;
+
+        g_return_if_fail (checker != NULL);
+
+        g_cancellable_cancel (checker->cancellable);
+        g_clear_object (&checker->cancellable);
+        checker->cancellable = g_cancellable_new ();
+
+        data = g_new0 (CheckData, 1);
+        data->checker = checker;
+        data->key = get_result_key (checker, password, old_password, username);
+        data->password = g_strdup (password);
+        data->old_password = g_strdup (old_password);
+        data->username = g_strdup (username);
+
+        task = g_task_new (NULL, checker->cancellable, callback, user_data);
+        g_task_set_source_tag (task, pw_strength_checker_check_async);
+        g_task_set_task_data (task, data, (GDestroyNotify) check_data_free);
+        g_task_run_in_thread (task, check_thread_func);
+}
+
+/**
+ * pw_strength_checker_check_finish:
+ *
+ * Returns: the strength of the password, or -1 with @error set if the
+ * check was cancelled, in which case the checker may already be freed.
+ */
+gdouble
+pw_strength_checker_check_finish (GAsyncResult  *res,
+                                  const gchar  **hint,
+                                  gint          *strength_level,
+                                  GError       **error)
+{
+        PwStrengthResult *result;
+        CheckData *data;
+
+        g_return_val_if_fail (g_task_is_valid (res, NULL), -1);
+        g_return_val_if_fail (g_task_get_source_tag (G_TASK (res)) == pw_strength_checker_check_async, -1);
+
+        /* A freed checker cancels its request, so it is
+         * still alive if the task did not fail */
+        result = g_task_propagate_pointer (G_TASK (res), error);
+        if (result == NULL)
+                return -1;
+
+        data = g_task_get_task_data (G_TASK (res));
+        g_hash_table_replace (data->checker->results, g_strdup (data->key), result);
 
+        *hint = result->hint;
         if (strength_level)
-                *strength_level = level;
+                *strength_level = result->level;
 
-        return strength;
+        return result->strength;
 }
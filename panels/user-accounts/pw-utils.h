@@ -20,7 +20,9 @@
 
 #pragma once
 
-#include <glib.h>
+#include <gio/gio.h>
+
+typedef struct _PwStrengthChecker PwStrengthChecker;
 
 gint     pw_min_length (void);
 gchar   *pw_generate   (void);
@@ -29,3 +31,24 @@ gdouble  pw_strength   (const gchar  *password,
                         const gchar  *username,
                         const gchar **hint,
                         gint         *strength_level);
+
+PwStrengthChecker *pw_strength_checker_new          (void);
+void               pw_strength_checker_free         (PwStrengthChecker   *checker);
+gboolean           pw_strength_checker_lookup       (PwStrengthChecker   *checker,
+                                                     const gchar         *password,
+                                                     const gchar         *old_password,
+                                                     const gchar         *username,
+                                                     const gchar        **hint,
+                                                     gint                *strength_level);
+void               pw_strength_checker_check_async  (PwStrengthChecker   *checker,
+                                                     const gchar         *password,
+                                                     const gchar         *old_password,
+                                                     const gchar         *username,
+                                                     GAsyncReadyCallback  callback,
+                                                     gpointer             user_data);
+gdouble            pw_strength_checker_check_finish (GAsyncResult        *res,
+                                                     const gchar        **hint,
+                                                     gint                *strength_level,
+                                                     GError             **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwStrengthChecker, pw_strength_checker_free)
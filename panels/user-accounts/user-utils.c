@@ -20,19 +20,15 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <math.h>
 #include <stdlib.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <limits.h>
 #include <unistd.h>
 #include <utmpx.h>
 #include <pwd.h>
 
-#ifdef __FreeBSD__
-#include <sysexits.h>
-#endif
-
 #include <gio/gio.h>
 #include <gio/gunixoutputstream.h>
 #include <glib/gi18n.h>
@@ -351,18 +347,135 @@ get_username_max_length (void)
         return sizeof (((struct utmpx *)NULL)->ut_user);
 }
 
+/* Looking users up can block for a long time with network backed NSS
+ * modules, so the answers are kept for a while. They are not kept for
+ * longer, as users may be added or removed meanwhile. */
+#define USERNAME_CACHE_TIMEOUT (60 * G_USEC_PER_SEC)
+
+typedef struct {
+        gboolean in_use;
+        gint64   timestamp;
+} UsernameLookup;
+
+G_LOCK_DEFINE_STATIC (username_cache);
+static GHashTable *username_cache = NULL;
+static gint64 username_cache_cleared = 0;
+
+static gboolean
+username_lookup_expired (gpointer key,
+                         gpointer value,
+                         gpointer user_data)
+{
+        UsernameLookup *lookup = value;
+        gint64 *now = user_data;
+
+        return *now - lookup->timestamp >= USERNAME_CACHE_TIMEOUT;
+}
+
+static gboolean
+lookup_cached_username (const gchar *username,
+                        gboolean    *in_use)
+{
+        UsernameLookup *lookup = NULL;
+        gint64 now;
+
+        now = g_get_monotonic_time ();
+
+        G_LOCK (username_cache);
+
+        if (username_cache != NULL)
+                lookup = g_hash_table_lookup (username_cache, username);
+        if (lookup != NULL && username_lookup_expired (NULL, lookup, &now)) {
+                g_hash_table_remove (username_cache, username);
+                lookup = NULL;
+        }
+        if (lookup != NULL)
+                *in_use = lookup->in_use;
+
+        G_UNLOCK (username_cache);
+
+        return lookup != NULL;
+}
+
+/* @timestamp is when the lookup started, so that answers which may
+ * predate clearing the cache are not kept */
+static void
+cache_username (const gchar *username,
+                gboolean     in_use,
+                gint64       timestamp)
+{
+        UsernameLookup *lookup;
+        gint64 now;
+
+        now = g_get_monotonic_time ();
+
+        G_LOCK (username_cache);
+
+        if (timestamp <= username_cache_cleared) {
+                G_UNLOCK (username_cache);
+                return;
+        }
+
+        lookup = g_new (UsernameLookup, 1);
+        lookup->in_use = in_use;
+        lookup->timestamp = timestamp;
+
+        if (username_cache == NULL)
+                username_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+        else
+                g_hash_table_foreach_remove (username_cache, username_lookup_expired, &now);
+        g_hash_table_insert (username_cache, g_strdup (username), lookup);
+
+        G_UNLOCK (username_cache);
+}
+
+/* To be called once users were added or removed */
+void
+clear_username_cache (void)
+{
+        G_LOCK (username_cache);
+
+        username_cache_cleared = g_get_monotonic_time ();
+        if (username_cache != NULL)
+                g_hash_table_remove_all (username_cache);
+
+        G_UNLOCK (username_cache);
+}
+
+/* Can be called from any thread */
 gboolean
 is_username_used (const gchar *username)
 {
-        struct passwd *pwent;
+        struct passwd pwent;
+        struct passwd *result = NULL;
+        g_autofree gchar *buffer = NULL;
+        glong buffer_size;
+        gboolean in_use;
+        gint64 timestamp;
 
         if (username == NULL || username[0] == '\0') {
                 return FALSE;
         }
 
-        pwent = getpwnam (username);
+        if (lookup_cached_username (username, &in_use))
+                return in_use;
+
+        timestamp = g_get_monotonic_time ();
 
-        return pwent != NULL;
+        buffer_size = sysconf (_SC_GETPW_R_SIZE_MAX);
+        if (buffer_size <= 0)
+                buffer_size = 16384;
+        buffer = g_malloc (buffer_size);
+
+        while (getpwnam_r (username, &pwent, buffer, buffer_size, &result) == ERANGE) {
+                buffer_size *= 2;
+                buffer = g_realloc (buffer, buffer_size);
+        }
+
+        in_use = (result != NULL);
+        cache_username (username, in_use, timestamp);
+
+        return in_use;
 }
 
 gboolean
@@ -407,56 +520,52 @@ is_valid_username_data_free (isValidUsernameData *data)
         g_free (data);
 }
 
-#ifdef __FreeBSD__
-/* Taken from pw(8) man page. */
-#define E_SUCCESS EX_OK
-#define E_BAD_ARG EX_DATAERR
-#define E_NOTFOUND EX_NOUSER
-#else
-/* Taken from usermod.c in shadow-utils. */
-#define E_SUCCESS 0
-#define E_BAD_ARG 3
-#define E_NOTFOUND 6
-#endif
+/* The default rules of useradd in shadow-utils: a lower case letter or
+ * an underscore, followed by lower case letters, digits, underscores or
+ * dashes. A trailing dollar sign is allowed for Samba machine accounts. */
+static gboolean
+is_valid_username_syntax (const gchar *username)
+{
+        const gchar *c;
+
+        if (!g_ascii_islower (username[0]) && username[0] != '_')
+                return FALSE;
+
+        for (c = username + 1; *c != '\0'; c++) {
+                if (g_ascii_islower (*c) || g_ascii_isdigit (*c) ||
+                    *c == '_' || *c == '-')
+                        continue;
+
+                if (*c == '$' && c[1] == '\0')
+                        continue;
+
+                return FALSE;
+        }
+
+        return TRUE;
+}
 
 static void
-is_valid_username_child_watch_cb (GPid pid,
-                                  gint status,
-                                  gpointer user_data)
+return_username_lookup (GTask    *task,
+                        gboolean  in_use)
 {
-        GTask *task = G_TASK (user_data);
         isValidUsernameData *data = g_task_get_task_data (task);
-        GError *error = NULL;
-        gboolean valid = FALSE;
-        const gchar *tip = NULL;
-
-        if (WIFEXITED (status)) {
-                switch (WEXITSTATUS (status)) {
-                        case E_NOTFOUND:
-                                valid = TRUE;
-                                break;
-                        case E_BAD_ARG:
-                                tip = _("The username should usually only consist of lower case letters from a-z, digits and the following characters: - _");
-                                valid = FALSE;
-                                break;
-                        case E_SUCCESS:
-                                tip = _("Sorry, that user name isn’t available. Please try another.");
-                                valid = FALSE;
-                                break;
-                }
-        }
 
-        if (valid || tip != NULL) {
-                data->tip = g_strdup (tip);
-                g_task_return_boolean (task, valid);
-        }
-        else {
-                g_spawn_check_exit_status (status, &error);
-                g_task_return_error (task, error);
-        }
+        if (in_use)
+                data->tip = g_strdup (_("Sorry, that user name isn’t available. Please try another."));
 
-        g_spawn_close_pid (pid);
-        g_object_unref (task);
+        g_task_return_boolean (task, !in_use);
+}
+
+static void
+is_valid_username_thread (GTask        *task,
+                          gpointer      source_object,
+                          gpointer      task_data,
+                          GCancellable *cancellable)
+{
+        isValidUsernameData *data = task_data;
+
+        return_username_lookup (task, is_username_used (data->username));
 }
 
 void
@@ -465,11 +574,9 @@ is_valid_username_async (const gchar *username,
                          GAsyncReadyCallback callback,
                          gpointer callback_data)
 {
-        GTask *task;
+        g_autoptr(GTask) task = NULL;
         isValidUsernameData *data;
-        gchar *argv[6];
-        GPid pid;
-        GError *error = NULL;
+        gboolean in_use;
 
         task = g_task_new (NULL, cancellable, callback, callback_data);
         g_task_set_source_tag (task, is_valid_username_async);
@@ -480,54 +587,21 @@ is_valid_username_async (const gchar *username,
 
         if (username == NULL || username[0] == '\0') {
                 g_task_return_boolean (task, FALSE);
-                g_object_unref (task);
-
-                return;
         }
         else if (strlen (username) > get_username_max_length ()) {
                 data->tip = g_strdup (_("The username is too long."));
                 g_task_return_boolean (task, FALSE);
-                g_object_unref (task);
-
-                return;
         }
-
-#ifdef __FreeBSD__
-        /* Abuse "pw usershow -n <name>" in the same way as the code below. We
-         * don't use "pw usermod -n <name> -N -l <newname>" here because it has
-         * a special case for "root" to reject changes to the root user.
-         */
-        argv[0] = "pw";
-        argv[1] = "usershow";
-        argv[2] = "-n";
-        argv[3] = data->username;
-        argv[4] = NULL;
-#else
-        /* "usermod --login" is meant to be used to change a username, but the
-         * exit codes can be safely abused to check the validity of username.
-         * However, the current "usermod" implementation may change in the
-         * future, so it would be nice to have some official way for this
-         * instead of relying on the current "--login" implementation.
-         */
-        argv[0] = "/usr/sbin/usermod";
-        argv[1] = "--login";
-        argv[2] = data->username;
-        argv[3] = "--";
-        argv[4] = data->username;
-        argv[5] = NULL;
-#endif
-
-        if (!g_spawn_async (NULL, argv, NULL,
-                            G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
-                            G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
-                            NULL, NULL, &pid, &error)) {
-                g_task_return_error (task, error);
-                g_object_unref (task);
-
-                return;
+        else if (!is_valid_username_syntax (username)) {
+                data->tip = g_strdup (_("The username should usually only consist of lower case letters from a-z, digits and the following characters: - _"));
+                g_task_return_boolean (task, FALSE);
+        }
+        else if (lookup_cached_username (username, &in_use)) {
+                return_username_lookup (task, in_use);
+        }
+        else {
+                g_task_run_in_thread (task, is_valid_username_thread);
         }
-
-        g_child_watch_add (pid, (GChildWatchFunc) is_valid_username_child_watch_cb, task);
 }
 
 gboolean
@@ -40,6 +40,7 @@ void     clear_entry_validation_error     (GtkEntry    *entry);
 
 gsize    get_username_max_length          (void);
 gboolean is_username_used                 (const gchar *username);
+void     clear_username_cache             (void);
 gboolean is_valid_name                    (const gchar *name);
 void     is_valid_username_async          (const gchar *username,
                                            GCancellable *cancellable,
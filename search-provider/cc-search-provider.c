@@ -49,6 +49,12 @@ typedef enum {
   MATCH_SUBSTRING
 } PanelSearchMatch;
 
+typedef struct
+{
+  const gchar *id;
+  guint64      sort_key;
+} SearchResult;
+
 G_DEFINE_TYPE (CcSearchProvider, cc_search_provider, G_TYPE_OBJECT)
 
 static char **
@@ -94,36 +100,126 @@ get_model (void)
   return GTK_TREE_MODEL (cc_search_provider_app_get_model (app));
 }
 
-static gchar **
-get_results (gchar **terms)
+static GHashTable *
+ensure_iter_table (CcSearchProvider *self)
 {
-  g_auto(GStrv) casefolded_terms = NULL;
-  GtkTreeModel *model = get_model ();
+  GtkTreeModel *model;
   GtkTreeIter iter;
-  GPtrArray *results;
   gboolean ok;
+  gchar *id;
 
-  casefolded_terms = get_casefolded_terms (terms);
-  results = g_ptr_array_new ();
+  /* Caching GtkTreeIters in this way is only OK because the model is
+   * a GtkListStore which guarantees that while a row exists, the iter
+   * is persistent.
+   */
+  if (self->iter_table)
+    return self->iter_table;
 
-  cc_shell_model_set_sort_terms (CC_SHELL_MODEL (model), casefolded_terms);
+  self->iter_table = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            g_free, (GDestroyNotify) gtk_tree_iter_free);
 
+  model = get_model ();
   ok = gtk_tree_model_get_iter_first (model, &iter);
   while (ok)
     {
-      if (matches_all_terms (model, &iter, casefolded_terms))
+      gtk_tree_model_get (model, &iter, COL_ID, &id, -1);
+
+      g_hash_table_replace (self->iter_table, id, gtk_tree_iter_copy (&iter));
+
+      ok = gtk_tree_model_iter_next (model, &iter);
+    }
+
+  return self->iter_table;
+}
+
+static GtkTreeIter *
+get_iter_for_result (CcSearchProvider *self,
+                     const gchar      *result)
+{
+  return g_hash_table_lookup (ensure_iter_table (self), result);
+}
+
+static void
+maybe_add_result (GArray       *results,
+                  GtkTreeModel *model,
+                  GtkTreeIter  *iter,
+                  const gchar  *id,
+                  char        **terms)
+{
+  SearchResult result;
+
+  if (!matches_all_terms (model, iter, terms))
+    return;
+
+  result.id = id;
+  result.sort_key = cc_shell_model_iter_get_sort_key (CC_SHELL_MODEL (model), iter, terms);
+
+  g_array_append_val (results, result);
+}
+
+static gint
+compare_results (gconstpointer a,
+                 gconstpointer b)
+{
+  const SearchResult *result_a = a;
+  const SearchResult *result_b = b;
+
+  if (result_a->sort_key < result_b->sort_key)
+    return -1;
+  else if (result_a->sort_key > result_b->sort_key)
+    return 1;
+
+  return 0;
+}
+
+static gchar **
+get_results (CcSearchProvider  *self,
+             gchar            **terms,
+             gchar            **previous_results)
+{
+  g_auto(GStrv) casefolded_terms = NULL;
+  g_autoptr(GArray) results = NULL;
+  GtkTreeModel *model = get_model ();
+  GtkTreeIter *iter;
+  gchar **ids;
+  guint i;
+
+  casefolded_terms = get_casefolded_terms (terms);
+  results = g_array_new (FALSE, FALSE, sizeof (SearchResult));
+
+  if (previous_results)
+    {
+      /* The new terms can only narrow the previous results down, so
+       * there's no need to look at any other row.
+       */
+      for (i = 0; previous_results[i]; i++)
         {
-          gchar *id;
-          gtk_tree_model_get (model, &iter, COL_ID, &id, -1);
-          g_ptr_array_add (results, id);
+          iter = get_iter_for_result (self, previous_results[i]);
+          if (iter)
+            maybe_add_result (results, model, iter, previous_results[i], casefolded_terms);
         }
+    }
+  else
+    {
+      GHashTableIter hash_iter;
+      gpointer id;
 
-      ok = gtk_tree_model_iter_next (model, &iter);
+      g_hash_table_iter_init (&hash_iter, ensure_iter_table (self));
+      while (g_hash_table_iter_next (&hash_iter, &id, (gpointer *) &iter))
+        maybe_add_result (results, model, iter, id, casefolded_terms);
     }
 
-  g_ptr_array_add (results, NULL);
+  /* Rank the matches the same way the model sorts them, without
+   * re-sorting the model itself.
+   */
+  g_array_sort (results, compare_results);
 
-  return (char**) g_ptr_array_free (results, FALSE);
+  ids = g_new (gchar *, results->len + 1);
+  for (i = 0; i < results->len; i++)
+    ids[i] = g_strdup (g_array_index (results, SearchResult, i).id);
+  ids[results->len] = NULL;
+
+  return ids;
 }
 
 static gboolean
@@ -132,7 +228,7 @@ handle_get_initial_result_set (CcShellSearchProvider2  *skeleton,
                                char                   **terms,
                                CcSearchProvider        *self)
 {
-  g_auto(GStrv) results = get_results (terms);
+  g_auto(GStrv) results = get_results (self, terms, NULL);
   cc_shell_search_provider2_complete_get_initial_result_set (skeleton,
                                                              invocation,
                                                              (const char* const*) results);
@@ -146,54 +242,13 @@ handle_get_subsearch_result_set (CcShellSearchProvider2  *skeleton,
                                  char                   **terms,
                                  CcSearchProvider        *self)
 {
-  /* We ignore the previous results here since the model re-sorts for
-   * the new terms. This means that we're not really doing a subsearch
-   * but, on the other hand, the results are consistent with the
-   * control center's own search. In any case, the number of elements
-   * in the model is always small enough that we don't need to worry
-   * about this taking too long.
-   */
-  g_auto(GStrv) results = get_results (terms);
+  g_auto(GStrv) results = get_results (self, terms, previous_results);
   cc_shell_search_provider2_complete_get_subsearch_result_set (skeleton,
                                                                invocation,
                                                                (const char* const*) results);
   return TRUE;
 }
 
-static GtkTreeIter *
-get_iter_for_result (CcSearchProvider *self,
-                     const gchar      *result)
-{
-  GtkTreeModel *model;
-  GtkTreeIter iter;
-  gboolean ok;
-  gchar *id;
-
-  /* Caching GtkTreeIters in this way is only OK because the model is
-   * a GtkListStore which guarantees that while a row exists, the iter
-   * is persistent.
-   */
-  if (self->iter_table)
-    goto lookup;
-
-  self->iter_table = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                            g_free, (GDestroyNotify) gtk_tree_iter_free);
-
-  model = get_model ();
-  ok = gtk_tree_model_get_iter_first (model, &iter);
-  while (ok)
-    {
-      gtk_tree_model_get (model, &iter, COL_ID, &id, -1);
-
-      g_hash_table_replace (self->iter_table, id, gtk_tree_iter_copy (&iter));
-
-      ok = gtk_tree_model_iter_next (model, &iter);
-    }
-
- lookup:
-  return g_hash_table_lookup (self->iter_table, result);
-}
-
 static gboolean
 handle_get_result_metas (CcShellSearchProvider2  *skeleton,
                          GDBusMethodInvocation   *invocation,
@@ -204,7 +259,6 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
   GtkTreeIter *iter;
   int i;
   GVariantBuilder builder;
-  const char *id;
 
   g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
 
@@ -213,7 +267,7 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
       g_autofree gchar *escaped_description = NULL;
       g_autofree gchar *description = NULL;
       g_autofree gchar *name = NULL;
-      g_autoptr(GAppInfo) app = NULL;
+      g_autofree gchar *app_id = NULL;
       g_autoptr(GIcon) icon = NULL;
 
       iter = get_iter_for_result (self, results[i]);
@@ -221,17 +275,16 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
         continue;
 
       gtk_tree_model_get (model, iter,
-                          COL_APP, &app,
+                          COL_APP_ID, &app_id,
                           COL_NAME, &name,
                           COL_GICON, &icon,
                           COL_DESCRIPTION, &description,
                           -1);
-      id = g_app_info_get_id (app);
       escaped_description = g_markup_escape_text (description, -1);
 
       g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
       g_variant_builder_add (&builder, "{sv}",
-                             "id", g_variant_new_string (id));
+                             "id", g_variant_new_string (app_id));
       g_variant_builder_add (&builder, "{sv}",
                              "name", g_variant_new_string (name));
       g_variant_builder_add (&builder, "{sv}",
@@ -55,6 +55,9 @@ struct _CcPanelList
 
   gchar              *current_panel_id;
   gchar              *search_query;
+  gchar              *casefolded_search_query;
+
+  CcShellModel       *model;
 
   CcPanelListView     previous_view;
   CcPanelListView     view;
@@ -358,11 +361,6 @@ filter_func (GtkListBoxRow *row,
 {
   CcPanelList *self;
   RowData *data;
-  g_autofree gchar *search_text = NULL;
-  g_autofree gchar *panel_text = NULL;
-  g_autofree gchar *panel_description = NULL;
-  gboolean retval = FALSE;
-  gint i;
 
   self = CC_PANEL_LIST (user_data);
   data = g_object_get_data (G_OBJECT (row), "data");
@@ -370,27 +368,16 @@ filter_func (GtkListBoxRow *row,
   if (!self->search_query)
     return TRUE;
 
-  panel_text = cc_util_normalize_casefold_and_unaccent (data->name);
-  search_text = cc_util_normalize_casefold_and_unaccent (self->search_query);
-  panel_description = cc_util_normalize_casefold_and_unaccent (data->description);
-
-  g_strstrip (panel_text);
-  g_strstrip (search_text);
-  g_strstrip (panel_description);
-
   /*
    * The description label is only visible when the search is
    * happening.
    */
   gtk_widget_set_visible (data->description_label, self->view == CC_PANEL_LIST_SEARCH);
 
-  for (i = 0; !retval && data->keywords[i] != NULL; i++)
-      retval = (strstr (data->keywords[i], search_text) == data->keywords[i]);
-
-  retval = retval || g_strstr_len (panel_text, -1, search_text) != NULL ||
-           g_strstr_len (panel_description, -1, search_text) != NULL;
+  if (!self->model)
+    return TRUE;
 
-  return retval;
+  return cc_shell_model_panel_matches_search (self->model, data->id, self->casefolded_search_query);
 }
 
 static const gchar * const panel_order[] = {
@@ -475,12 +462,12 @@ search_sort_function (GtkListBoxRow *a,
   RowData *a_data, *b_data;
   g_autofree gchar *a_name = NULL;
   g_autofree gchar *b_name = NULL;
-  g_autofree gchar *search = NULL;
+  const gchar *search;
   gchar *a_strstr, *b_strstr;
   gint a_distance, b_distance;
 
   self = CC_PANEL_LIST (user_data);
-  search = NULL;
+  search = self->casefolded_search_query;
   a_data = g_object_get_data (G_OBJECT (a), "data");
   b_data = g_object_get_data (G_OBJECT (b), "data");
 
@@ -491,12 +478,6 @@ search_sort_function (GtkListBoxRow *a,
   g_strstrip (a_name);
   g_strstrip (b_name);
 
-  if (self->search_query)
-    {
-      search = cc_util_normalize_casefold_and_unaccent (self->search_query);
-      g_strstrip (search);
-    }
-
   /* Default result for empty search */
   if (!search || g_utf8_strlen (search, -1) == 0)
     return g_strcmp0 (a_name, b_name);
@@ -669,7 +650,9 @@ cc_panel_list_finalize (GObject *object)
   CcPanelList *self = (CcPanelList *)object;
 
   g_clear_pointer (&self->search_query, g_free);
+  g_clear_pointer (&self->casefolded_search_query, g_free);
   g_clear_pointer (&self->current_panel_id, g_free);
+  g_clear_object (&self->model);
   g_clear_pointer (&self->id_to_data, g_hash_table_destroy);
   g_clear_pointer (&self->id_to_search_data, g_hash_table_destroy);
 
@@ -892,8 +875,16 @@ cc_panel_list_set_search_query (CcPanelList *self,
   if (g_strcmp0 (self->search_query, search) != 0)
     {
       g_clear_pointer (&self->search_query, g_free);
+      g_clear_pointer (&self->casefolded_search_query, g_free);
       self->search_query = g_strdup (search);
 
+      /* Normalize the query once, rather than for every row */
+      if (search)
+        {
+          self->casefolded_search_query = cc_util_normalize_casefold_and_unaccent (search);
+          g_strstrip (self->casefolded_search_query);
+        }
+
       update_search (self);
 
       g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SEARCH_QUERY]);
@@ -903,6 +894,26 @@ cc_panel_list_set_search_query (CcPanelList *self,
     }
 }
 
+/**
+ * cc_panel_list_set_model:
+ * @self: a #CcPanelList
+ * @model: the #CcShellModel the panels were added from
+ *
+ * Sets the model whose search index is used to filter the
+ * search results.
+ */
+void
+cc_panel_list_set_model (CcPanelList  *self,
+                         CcShellModel *model)
+{
+  g_return_if_fail (CC_IS_PANEL_LIST (self));
+  g_return_if_fail (CC_IS_SHELL_MODEL (model));
+
+  g_set_object (&self->model, model);
+
+  gtk_list_box_invalidate_filter (GTK_LIST_BOX (self->search_listbox));
+}
+
 CcPanelListView
 cc_panel_list_get_view (CcPanelList *self)
 {
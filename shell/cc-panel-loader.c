@@ -24,6 +24,7 @@
 #include <string.h>
 #include <gio/gdesktopappinfo.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include "cc-panel.h"
 #include "cc-panel-loader.h"
@@ -146,6 +147,13 @@ static CcPanelLoaderVtable default_panels[] =
 static CcPanelLoaderVtable *panels_vtable = default_panels;
 static gsize panels_vtable_len = G_N_ELEMENTS (default_panels);
 
+/* Cache of the normalized panel metadata, shared by gnome-control-center
+ * and the search provider. Bump the version whenever the format of the
+ * cache or of the serialized model items changes.
+ */
+#define PANEL_CACHE_VERSION 1
+#define PANEL_CACHE_VARIANT_TYPE "(uasa(ssx)v)"
+
 
 static int
 parse_categories (GDesktopAppInfo *app)
@@ -233,17 +241,169 @@ cc_panel_loader_load_by_name (CcShell     *shell,
 
 #endif /* CC_PANEL_LOADER_NO_GTYPES */
 
-/**
- * cc_panel_loader_fill_model:
- * @model: a #CcShellModel
- *
- * Fills @model with information from the available panels. It
- * iterates over the panel vtable, gathering the panel names,
- * build the desktop filename from it, and retrieves additional
- * information from it.
+static gchar *
+get_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "panels.cache", NULL);
+}
+
+static gchar *
+get_desktop_name (const gchar *panel_name)
+{
+  return g_strconcat ("gnome-", panel_name, "-panel.desktop", NULL);
+}
+
+/* Desktop IDs map to subdirectories: "prefix-name.desktop" is also
+ * looked up as "prefix/name.desktop", like GIO does.
  */
-void
-cc_panel_loader_fill_model (CcShellModel *model)
+static gchar *
+find_desktop_file_in_dir (const gchar *dir,
+                          const gchar *desktop_name,
+                          GStatBuf    *st)
+{
+  g_autofree gchar *path = NULL;
+  const gchar *p;
+
+  path = g_build_filename (dir, desktop_name, NULL);
+  if (g_stat (path, st) == 0)
+    return g_steal_pointer (&path);
+
+  for (p = strchr (desktop_name, '-'); p; p = strchr (p + 1, '-'))
+    {
+      g_autofree gchar *prefix = NULL;
+      g_autofree gchar *subdir = NULL;
+      gchar *found;
+
+      prefix = g_strndup (desktop_name, p - desktop_name);
+      subdir = g_build_filename (dir, prefix, NULL);
+
+      if (!g_file_test (subdir, G_FILE_TEST_IS_DIR))
+        continue;
+
+      found = find_desktop_file_in_dir (subdir, p + 1, st);
+      if (found)
+        return found;
+    }
+
+  return NULL;
+}
+
+/* Looks @desktop_name up in the same directories, and in the same
+ * order, as g_desktop_app_info_new() does.
+ */
+static gchar *
+find_desktop_file (const gchar *desktop_name,
+                   gint64      *out_mtime)
+{
+  const gchar * const *data_dirs;
+  GStatBuf st;
+  gint i;
+
+  data_dirs = g_get_system_data_dirs ();
+
+  for (i = -1; i == -1 || data_dirs[i]; i++)
+    {
+      g_autofree gchar *dir = NULL;
+      gchar *path;
+
+      dir = g_build_filename (i == -1 ? g_get_user_data_dir () : data_dirs[i],
+                              "applications",
+                              NULL);
+
+      path = find_desktop_file_in_dir (dir, desktop_name, &st);
+      if (path)
+        {
+          *out_mtime = st.st_mtime;
+          return path;
+        }
+    }
+
+  *out_mtime = 0;
+  return g_strdup ("");
+}
+
+/* The desktop file and its modification time for each panel. The cache
+ * is only valid as long as these don't change.
+ */
+static GVariant *
+get_panel_sources (void)
+{
+  GVariantBuilder builder;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssx)"));
+
+  for (i = 0; i < panels_vtable_len; i++)
+    {
+      g_autofree gchar *desktop_name = NULL;
+      g_autofree gchar *path = NULL;
+      gint64 mtime;
+
+      desktop_name = get_desktop_name (panels_vtable[i].name);
+      path = find_desktop_file (desktop_name, &mtime);
+
+      g_variant_builder_add (&builder, "(ssx)", panels_vtable[i].name, path, mtime);
+    }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static GVariant *
+get_language_names (void)
+{
+  return g_variant_ref_sink (g_variant_new_strv (g_get_language_names (), -1));
+}
+
+static gboolean
+fill_model_from_cache (CcShellModel *model,
+                       GVariant     *sources)
+{
+  g_autoptr(GVariant) cached_languages = NULL;
+  g_autoptr(GVariant) cached_sources = NULL;
+  g_autoptr(GVariant) languages = NULL;
+  g_autoptr(GMappedFile) mapped_file = NULL;
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GVariant) items = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autofree gchar *path = NULL;
+  guint32 version;
+
+  path = get_cache_path ();
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (!mapped_file)
+    return FALSE;
+
+  /* The cache is mapped rather than read, and only the strings that end
+   * up in the model are copied out of it.
+   */
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (PANEL_CACHE_VARIANT_TYPE), bytes, FALSE));
+
+  g_variant_get (cache, "(u@as@a(ssx)v)", &version, &cached_languages, &cached_sources, &items);
+
+  if (version != PANEL_CACHE_VERSION)
+    {
+      g_debug ("Ignoring panel cache with version %u", version);
+      return FALSE;
+    }
+
+  languages = get_language_names ();
+
+  if (!g_variant_equal (languages, cached_languages) ||
+      !g_variant_equal (sources, cached_sources) ||
+      !g_variant_is_of_type (items, CC_SHELL_MODEL_ITEMS_VARIANT_TYPE))
+    {
+      g_debug ("Panel cache is out of date");
+      return FALSE;
+    }
+
+  cc_shell_model_add_items_from_variant (model, items);
+
+  return TRUE;
+}
+
+static void
+fill_model_from_desktop_files (CcShellModel *model)
 {
   guint i;
 
@@ -253,7 +413,7 @@ cc_panel_loader_fill_model (CcShellModel *model)
       g_autofree gchar *desktop_name = NULL;
       gint category;
 
-      desktop_name = g_strconcat ("gnome-", panels_vtable[i].name, "-panel.desktop", NULL);
+      desktop_name = get_desktop_name (panels_vtable[i].name);
       app = g_desktop_app_info_new (desktop_name);
 
       if (!app)
@@ -268,6 +428,77 @@ cc_panel_loader_fill_model (CcShellModel *model)
 
       cc_shell_model_add_item (model, category, G_APP_INFO (app), panels_vtable[i].name);
     }
+}
+
+static void
+write_cache (CcShellModel *model,
+             GVariant     *sources)
+{
+  g_autoptr(GVariant) languages = NULL;
+  g_autoptr(GVariant) items = NULL;
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *dir = NULL;
+
+  items = cc_shell_model_to_variant (model);
+  if (!items)
+    return;
+
+  languages = get_language_names ();
+  cache = g_variant_ref_sink (g_variant_new ("(u@as@a(ssx)v)",
+                                             PANEL_CACHE_VERSION,
+                                             languages,
+                                             sources,
+                                             items));
+
+  path = get_cache_path ();
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  if (!g_file_set_contents (path,
+                            g_variant_get_data (cache),
+                            g_variant_get_size (cache),
+                            &error))
+    {
+      g_debug ("Failed to write the panel cache: %s", error->message);
+    }
+}
+
+/**
+ * cc_panel_loader_fill_model:
+ * @model: a #CcShellModel
+ *
+ * Fills @model with information from the available panels. It
+ * iterates over the panel vtable, gathering the panel names,
+ * build the desktop filename from it, and retrieves additional
+ * information from it.
+ *
+ * The normalized information is cached on disk, and reused for as
+ * long as none of the desktop files changed.
+ */
+void
+cc_panel_loader_fill_model (CcShellModel *model)
+{
+  g_autoptr(GVariant) sources = NULL;
+  gboolean use_cache;
+#ifndef CC_PANEL_LOADER_NO_GTYPES
+  guint i;
+#endif
+
+  /* Tests override the panels, and shouldn't replace the real cache */
+  use_cache = panels_vtable == default_panels;
+
+  if (use_cache)
+    sources = get_panel_sources ();
+
+  if (!use_cache || !fill_model_from_cache (model, sources))
+    {
+      fill_model_from_desktop_files (model);
+
+      if (use_cache)
+        write_cache (model, sources);
+    }
 
   /* If there's an static init function, execute it after adding all panels to
    * the model. This will allow the panels to show or hide themselves without
@@ -20,6 +20,7 @@
  */
 
 #include "cc-shell-model.h"
+#include "cc-shell-model-private.h"
 #include "cc-util.h"
 
 #include <string.h>
@@ -30,159 +31,286 @@
 #define GNOME_SETTINGS_PANEL_CATEGORY GNOME_SETTINGS_PANEL_ID_KEY
 #define GNOME_SETTINGS_PANEL_ID_KEYWORDS "Keywords"
 
+/* Packs three bytes of a casefolded string into a trigram key */
+#define TRIGRAM(s) (((guint) (guchar) (s)[0] << 16) | \
+                    ((guint) (guchar) (s)[1] << 8)  | \
+                    ((guint) (guchar) (s)[2]))
+
+typedef struct
+{
+  gchar       *id;
+  gchar       *casefolded_name;
+  gchar       *casefolded_description;
+  GStrv        keywords;
+  GtkTreeIter  iter;
+  guint        index;
+  guint        name_rank;
+  guint32      score;       /* for the current sort terms */
+} SearchEntry;
+
 struct _CcShellModel
 {
   GtkListStore parent;
 
   GStrv        sort_terms;
+
+  /* Search index, filled once per row in cc_shell_model_add_item() */
+  GPtrArray   *entries;      /* SearchEntry, in insertion order */
+  GHashTable  *id_to_entry;  /* COL_ID -> SearchEntry */
+  GHashTable  *row_to_entry; /* GtkTreeIter user_data -> SearchEntry */
+  SearchEntry *adding_entry; /* of the row being inserted */
+  GHashTable  *trigrams;     /* trigram -> GArray of guint32, bitset over entries */
+  gboolean     name_ranks_valid;
 };
 
 G_DEFINE_TYPE (CcShellModel, cc_shell_model, GTK_TYPE_LIST_STORE)
 
 static gint
-sort_by_name (GtkTreeModel *model,
-              GtkTreeIter  *a,
-              GtkTreeIter  *b)
+count_matches (gchar **keywords,
+               gchar **terms)
 {
-  g_autofree gchar *a_name = NULL;
-  g_autofree gchar *b_name = NULL;
+  gint i, j, c;
+
+  if (!keywords || !terms)
+    return 0;
 
-  gtk_tree_model_get (model, a, COL_CASEFOLDED_NAME, &a_name, -1);
-  gtk_tree_model_get (model, b, COL_CASEFOLDED_NAME, &b_name, -1);
+  c = 0;
 
-  return g_strcmp0 (a_name, b_name);
+  for (i = 0; terms[i]; ++i)
+    for (j = 0; keywords[j]; ++j)
+      if (strstr (keywords[j], terms[i]))
+        c += 1;
+
+  return c;
 }
 
-static gint
-sort_by_name_with_terms (GtkTreeModel  *model,
-                         GtkTreeIter   *a,
-                         GtkTreeIter   *b,
-                         gchar        **terms)
+static void
+search_entry_free (SearchEntry *entry)
 {
-  gboolean a_match, b_match;
-  g_autofree gchar *a_name = NULL;
-  g_autofree gchar *b_name = NULL;
-  gint i;
+  g_free (entry->id);
+  g_free (entry->casefolded_name);
+  g_free (entry->casefolded_description);
+  g_strfreev (entry->keywords);
+  g_free (entry);
+}
 
-  gtk_tree_model_get (model, a, COL_CASEFOLDED_NAME, &a_name, -1);
-  gtk_tree_model_get (model, b, COL_CASEFOLDED_NAME, &b_name, -1);
+static void
+index_string (CcShellModel *self,
+              SearchEntry  *entry,
+              const gchar  *str)
+{
+  guint word = entry->index / 32;
+  guint32 mask = 1u << (entry->index % 32);
+  gsize i;
 
-  for (i = 0; terms[i]; ++i)
+  if (!str)
+    return;
+
+  for (i = 0; str[i] && str[i + 1] && str[i + 2]; i++)
+    {
+      gpointer key = GUINT_TO_POINTER (TRIGRAM (str + i));
+      GArray *bits;
+
+      bits = g_hash_table_lookup (self->trigrams, key);
+      if (!bits)
+        {
+          bits = g_array_new (FALSE, TRUE, sizeof (guint32));
+          g_hash_table_insert (self->trigrams, key, bits);
+        }
+
+      if (bits->len <= word)
+        g_array_set_size (bits, word + 1);
+
+      g_array_index (bits, guint32, word) |= mask;
+    }
+}
+
+/*
+ * Every substring of an indexed string has all of its trigrams in the
+ * index, so if any trigram of @term is missing for @entry the entry
+ * cannot match and the string comparisons can be skipped.
+ */
+static gboolean
+trigrams_may_match (CcShellModel *self,
+                    SearchEntry  *entry,
+                    const gchar  *term)
+{
+  guint word = entry->index / 32;
+  guint32 mask = 1u << (entry->index % 32);
+  gsize i;
+
+  for (i = 0; term[i] && term[i + 1] && term[i + 2]; i++)
     {
-      a_match = strstr (a_name, terms[i]) != NULL;
-      b_match = strstr (b_name, terms[i]) != NULL;
+      GArray *bits;
+
+      bits = g_hash_table_lookup (self->trigrams, GUINT_TO_POINTER (TRIGRAM (term + i)));
 
-      if (a_match && !b_match)
-        return -1;
-      else if (!a_match && b_match)
-        return 1;
+      if (!bits || bits->len <= word || !(g_array_index (bits, guint32, word) & mask))
+        return FALSE;
     }
 
-  return 0;
+  return TRUE;
 }
 
-static gint
-count_matches (gchar **keywords,
-               gchar **terms)
+static gboolean
+search_entry_matches (CcShellModel *self,
+                      SearchEntry  *entry,
+                      const gchar  *term)
 {
-  gint i, j, c;
+  gint i;
 
-  if (!keywords || !terms)
+  if (!trigrams_may_match (self, entry, term))
+    return FALSE;
+
+  if (strstr (entry->casefolded_name, term) != NULL)
+    return TRUE;
+
+  if (entry->casefolded_description && strstr (entry->casefolded_description, term) != NULL)
+    return TRUE;
+
+  for (i = 0; entry->keywords[i]; i++)
+    {
+      if (g_str_has_prefix (entry->keywords[i], term))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static guint
+count_description_matches (const gchar  *description,
+                           gchar       **terms)
+{
+  guint i, c;
+
+  if (!description)
     return 0;
 
   c = 0;
 
-  for (i = 0; terms[i]; ++i)
-    for (j = 0; keywords[j]; ++j)
-      if (strstr (keywords[j], terms[i]))
-        c += 1;
+  /* Count the space-separated words containing each term, without
+   * splitting the description.
+   */
+  for (i = 0; terms[i]; i++)
+    {
+      const gchar *word = description;
+
+      while (TRUE)
+        {
+          const gchar *end = strchr (word, ' ');
+          gsize len = end ? (gsize) (end - word) : strlen (word);
+
+          if (g_strstr_len (word, len, terms[i]) != NULL)
+            c += 1;
+
+          if (!end)
+            break;
+
+          word = end + 1;
+        }
+    }
 
   return c;
 }
 
-static gint
-sort_by_keywords_with_terms (GtkTreeModel  *model,
-                             GtkTreeIter   *a,
-                             GtkTreeIter   *b,
-                             gchar        **terms)
+/*
+ * Packs the search relevance of @entry into an integer, so that a higher
+ * score sorts first. From most to least significant: which terms match
+ * the name (earlier terms weighing more), the number of keyword matches,
+ * whether there is a description and the number of description matches.
+ */
+static guint32
+search_entry_get_score (SearchEntry  *entry,
+                        gchar       **terms)
 {
-  gint a_matches, b_matches;
-  g_auto(GStrv) a_keywords = NULL;
-  g_auto(GStrv) b_keywords = NULL;
+  guint32 name_bits = 0;
+  guint32 keyword_matches;
+  guint32 description_matches;
+  guint i;
 
-  gtk_tree_model_get (model, a, COL_KEYWORDS, &a_keywords, -1);
-  gtk_tree_model_get (model, b, COL_KEYWORDS, &b_keywords, -1);
+  if (!terms || !terms[0])
+    return 0;
 
-  a_matches = count_matches (a_keywords, terms);
-  b_matches = count_matches (b_keywords, terms);
+  for (i = 0; terms[i] && i < 8; i++)
+    {
+      if (strstr (entry->casefolded_name, terms[i]) != NULL)
+        name_bits |= 1 << (7 - i);
+    }
 
-  if (a_matches > b_matches)
-    return -1;
-  else if (a_matches < b_matches)
-    return 1;
+  keyword_matches = MIN (count_matches (entry->keywords, terms), 0xff);
+  description_matches = MIN (count_description_matches (entry->casefolded_description, terms), 0x7f);
 
-  return 0;
+  return name_bits << 24 |
+         keyword_matches << 16 |
+         (entry->casefolded_description ? 1 : 0) << 15 |
+         description_matches << 8;
 }
 
 static gint
-sort_by_description_with_terms (GtkTreeModel  *model,
-                                GtkTreeIter   *a,
-                                GtkTreeIter   *b,
-                                gchar        **terms)
+compare_entries_by_name (gconstpointer a,
+                         gconstpointer b)
 {
-  gint a_matches, b_matches;
-  g_autofree gchar *a_description = NULL;
-  g_autofree gchar *b_description = NULL;
-  g_auto(GStrv) a_description_split = NULL;
-  g_auto(GStrv) b_description_split = NULL;
+  const SearchEntry *entry_a = *(SearchEntry **) a;
+  const SearchEntry *entry_b = *(SearchEntry **) b;
 
-  gtk_tree_model_get (model, a, COL_DESCRIPTION, &a_description, -1);
-  gtk_tree_model_get (model, b, COL_DESCRIPTION, &b_description, -1);
+  return g_strcmp0 (entry_a->casefolded_name, entry_b->casefolded_name);
+}
 
-  if (a_description && !b_description)
-    return -1;
-  else if (!a_description && b_description)
-    return 1;
-  else if (!a_description && !b_description)
-    return 0;
+static void
+ensure_name_ranks (CcShellModel *self)
+{
+  g_autoptr(GPtrArray) sorted = NULL;
+  guint i;
 
-  a_description_split = g_strsplit (a_description, " ", -1);
-  b_description_split = g_strsplit (b_description, " ", -1);
+  if (self->name_ranks_valid)
+    return;
 
-  a_matches = count_matches (a_description_split, terms);
-  b_matches = count_matches (b_description_split, terms);
+  sorted = g_ptr_array_sized_new (self->entries->len);
+  for (i = 0; i < self->entries->len; i++)
+    g_ptr_array_add (sorted, g_ptr_array_index (self->entries, i));
 
-  if (a_matches > b_matches)
-    return -1;
-  else if (a_matches < b_matches)
-    return 1;
+  g_ptr_array_sort (sorted, compare_entries_by_name);
 
-  return 0;
+  for (i = 0; i < sorted->len; i++)
+    {
+      SearchEntry *entry = g_ptr_array_index (sorted, i);
+      entry->name_rank = i;
+    }
+
+  self->name_ranks_valid = TRUE;
 }
 
-static gint
-sort_with_terms (GtkTreeModel  *model,
-                 GtkTreeIter   *a,
-                 GtkTreeIter   *b,
-                 gchar        **terms)
+static guint64
+search_entry_get_sort_key (SearchEntry  *entry,
+                           gchar       **terms)
 {
-  gint rval;
+  guint32 score = search_entry_get_score (entry, terms);
 
-  rval = sort_by_name_with_terms (model, a, b, terms);
-  if (rval)
-    return rval;
+  return (guint64) (G_MAXUINT32 - score) << 32 | entry->name_rank;
+}
 
-  rval = sort_by_keywords_with_terms (model, a, b, terms);
-  if (rval)
-    return rval;
+/*
+ * The iters of a GtkListStore stay valid for as long as their row exists,
+ * and their user_data identifies the row, so it is used to find the
+ * search data of a row without copying any of its values. The row being
+ * inserted is sorted before add_row() knows its iter, and is the only
+ * one missing from the table.
+ */
+static SearchEntry *
+lookup_entry_for_iter (CcShellModel *self,
+                       GtkTreeIter  *iter)
+{
+  SearchEntry *entry;
 
-  rval = sort_by_description_with_terms (model, a, b, terms);
-  if (rval)
-    return rval;
+  entry = g_hash_table_lookup (self->row_to_entry, iter->user_data);
 
-  return sort_by_name (model, a, b);
+  return entry ? entry : self->adding_entry;
 }
 
+/*
+ * The scores are computed once per row in cc_shell_model_set_sort_terms(),
+ * so comparing two rows doesn't copy or allocate anything.
+ */
 static gint
 cc_shell_model_sort_func (GtkTreeModel *model,
                           GtkTreeIter  *a,
@@ -190,11 +318,18 @@ cc_shell_model_sort_func (GtkTreeModel *model,
                           gpointer      data)
 {
   CcShellModel *self = data;
+  SearchEntry *entry_a;
+  SearchEntry *entry_b;
+
+  entry_a = lookup_entry_for_iter (self, a);
+  entry_b = lookup_entry_for_iter (self, b);
+
+  if (entry_a->score > entry_b->score)
+    return -1;
+  else if (entry_a->score < entry_b->score)
+    return 1;
 
-  if (!self->sort_terms || !self->sort_terms[0])
-    return sort_by_name (model, a, b);
-  else
-    return sort_with_terms (model, a, b, self->sort_terms);
+  return g_strcmp0 (entry_a->casefolded_name, entry_b->casefolded_name);
 }
 
 static void
@@ -203,6 +338,10 @@ cc_shell_model_finalize (GObject *object)
   CcShellModel *self = CC_SHELL_MODEL (object);
 
   g_clear_pointer (&self->sort_terms, g_strfreev);
+  g_clear_pointer (&self->id_to_entry, g_hash_table_destroy);
+  g_clear_pointer (&self->row_to_entry, g_hash_table_destroy);
+  g_clear_pointer (&self->trigrams, g_hash_table_destroy);
+  g_clear_pointer (&self->entries, g_ptr_array_unref);
 
   G_OBJECT_CLASS (cc_shell_model_parent_class)->finalize (object);
 }
@@ -218,12 +357,18 @@ cc_shell_model_class_init (CcShellModelClass *klass)
 static void
 cc_shell_model_init (CcShellModel *self)
 {
-  GType types[] = {G_TYPE_STRING, G_TYPE_STRING, G_TYPE_APP_INFO, G_TYPE_STRING, G_TYPE_UINT,
+  GType types[] = {G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_UINT,
                    G_TYPE_STRING, G_TYPE_STRING, G_TYPE_ICON, G_TYPE_STRV, G_TYPE_UINT, G_TYPE_BOOLEAN };
 
   gtk_list_store_set_column_types (GTK_LIST_STORE (self),
                                    N_COLS, types);
 
+  self->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) search_entry_free);
+  self->id_to_entry = g_hash_table_new (g_str_hash, g_str_equal);
+  self->row_to_entry = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->trigrams = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                          NULL, (GDestroyNotify) g_array_unref);
+
   gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (self),
                                            cc_shell_model_sort_func,
                                            self, NULL);
@@ -274,6 +419,58 @@ symbolicize_g_icon (GIcon *gicon)
   return g_themed_icon_new_with_default_fallbacks (new_name);
 }
 
+static void
+add_row (CcShellModel    *model,
+         CcPanelCategory  category,
+         const gchar     *id,
+         const gchar     *app_id,
+         const gchar     *name,
+         gchar           *casefolded_name,
+         const gchar     *description,
+         gchar           *casefolded_description,
+         GIcon           *icon,
+         GStrv            keywords,
+         gboolean         has_sidebar)
+{
+  SearchEntry *entry;
+  gint i;
+
+  entry = g_new0 (SearchEntry, 1);
+  entry->id = g_strdup (id);
+  entry->casefolded_name = casefolded_name;
+  entry->casefolded_description = casefolded_description;
+  entry->keywords = keywords;
+  entry->index = model->entries->len;
+  entry->score = search_entry_get_score (entry, model->sort_terms);
+
+  index_string (model, entry, entry->casefolded_name);
+  index_string (model, entry, entry->casefolded_description);
+  for (i = 0; entry->keywords[i]; i++)
+    index_string (model, entry, entry->keywords[i]);
+
+  g_ptr_array_add (model->entries, entry);
+  g_hash_table_insert (model->id_to_entry, entry->id, entry);
+  model->name_ranks_valid = FALSE;
+
+  model->adding_entry = entry;
+  gtk_list_store_insert_with_values (GTK_LIST_STORE (model), &entry->iter, 0,
+                                     COL_NAME, name,
+                                     COL_CASEFOLDED_NAME, entry->casefolded_name,
+                                     COL_APP_ID, app_id,
+                                     COL_ID, id,
+                                     COL_CATEGORY, category,
+                                     COL_DESCRIPTION, description,
+                                     COL_CASEFOLDED_DESCRIPTION, entry->casefolded_description,
+                                     COL_GICON, icon,
+                                     COL_KEYWORDS, entry->keywords,
+                                     COL_VISIBILITY, CC_PANEL_VISIBLE,
+                                     COL_HAS_SIDEBAR, has_sidebar,
+                                     -1);
+  model->adding_entry = NULL;
+
+  g_hash_table_insert (model->row_to_entry, entry->iter.user_data, entry);
+}
+
 void
 cc_shell_model_add_item (CcShellModel    *model,
                          CcPanelCategory  category,
@@ -283,54 +480,145 @@ cc_shell_model_add_item (CcShellModel    *model,
   g_autoptr(GIcon) icon = NULL;
   const gchar *name = g_app_info_get_name (appinfo);
   const gchar *comment = g_app_info_get_description (appinfo);
-  g_auto(GStrv) keywords = NULL;
-  g_autofree gchar *casefolded_name = NULL;
-  g_autofree gchar *casefolded_description = NULL;
   gboolean has_sidebar;
 
-  casefolded_name = cc_util_normalize_casefold_and_unaccent (name);
-  casefolded_description = cc_util_normalize_casefold_and_unaccent (comment);
-  keywords = get_casefolded_keywords (appinfo);
   icon = symbolicize_g_icon (g_app_info_get_icon (appinfo));
   has_sidebar = g_desktop_app_info_get_boolean (G_DESKTOP_APP_INFO (appinfo), "X-GNOME-ControlCenter-HasSidebar");
 
-  gtk_list_store_insert_with_values (GTK_LIST_STORE (model), NULL, 0,
-                                     COL_NAME, name,
-                                     COL_CASEFOLDED_NAME, casefolded_name,
-                                     COL_APP, appinfo,
-                                     COL_ID, id,
-                                     COL_CATEGORY, category,
-                                     COL_DESCRIPTION, comment,
-                                     COL_CASEFOLDED_DESCRIPTION, casefolded_description,
-                                     COL_GICON, icon,
-                                     COL_KEYWORDS, keywords,
-                                     COL_VISIBILITY, CC_PANEL_VISIBLE,
-                                     COL_HAS_SIDEBAR, has_sidebar,
-                                     -1);
+  add_row (model,
+           category,
+           id,
+           g_app_info_get_id (appinfo),
+           name,
+           cc_util_normalize_casefold_and_unaccent (name),
+           comment,
+           cc_util_normalize_casefold_and_unaccent (comment),
+           icon,
+           get_casefolded_keywords (appinfo),
+           has_sidebar);
 }
 
-gboolean
-cc_shell_model_has_panel (CcShellModel *model,
-                          const char   *id)
+/**
+ * cc_shell_model_add_items_from_variant:
+ * @model: a #CcShellModel
+ * @items: a #GVariant of type %CC_SHELL_MODEL_ITEMS_VARIANT_TYPE
+ *
+ * Adds the items serialized by cc_shell_model_to_variant() to @model.
+ * The names, descriptions and keywords in @items are already
+ * normalized, so this is much cheaper than cc_shell_model_add_item().
+ */
+void
+cc_shell_model_add_items_from_variant (CcShellModel *model,
+                                       GVariant     *items)
 {
-  GtkTreeIter iter;
-  gboolean valid;
+  GVariantIter iter;
+  const gchar *id, *app_id, *name, *casefolded_name;
+  const gchar *description, *casefolded_description;
+  GVariant *icon_variant;
+  GStrv keywords;
+  guint32 category;
+  gboolean has_sidebar;
 
-  g_assert (id);
+  g_return_if_fail (CC_IS_SHELL_MODEL (model));
+  g_return_if_fail (g_variant_is_of_type (items, CC_SHELL_MODEL_ITEMS_VARIANT_TYPE));
 
-  valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (model), &iter);
-  while (valid)
+  g_variant_iter_init (&iter, items);
+  while (g_variant_iter_next (&iter, "(&s&su&s&sm&sm&sv^asb)",
+                              &id, &app_id, &category,
+                              &name, &casefolded_name,
+                              &description, &casefolded_description,
+                              &icon_variant, &keywords, &has_sidebar))
     {
-      g_autofree gchar *panel_id = NULL;
+      g_autoptr(GIcon) icon = g_icon_deserialize (icon_variant);
+
+      g_variant_unref (icon_variant);
+
+      if (!icon || category >= CC_CATEGORY_LAST)
+        {
+          g_warning ("Ignoring invalid serialized panel %s", id);
+          g_strfreev (keywords);
+          continue;
+        }
+
+      add_row (model,
+               category,
+               id,
+               app_id,
+               name,
+               g_strdup (casefolded_name),
+               description,
+               g_strdup (casefolded_description),
+               icon,
+               keywords,
+               has_sidebar);
+    }
+}
 
-      gtk_tree_model_get (GTK_TREE_MODEL (model), &iter, COL_ID, &panel_id, -1);
-      if (g_str_equal (id, panel_id))
-        return TRUE;
+/**
+ * cc_shell_model_to_variant:
+ * @model: a #CcShellModel
+ *
+ * Serializes the items of @model, with their normalized search data,
+ * so that they can be added back with cc_shell_model_add_items_from_variant().
+ *
+ * Returns: (transfer full) (nullable): a #GVariant of type
+ * %CC_SHELL_MODEL_ITEMS_VARIANT_TYPE, or %NULL if an item can't be serialized.
+ */
+GVariant *
+cc_shell_model_to_variant (CcShellModel *model)
+{
+  g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (CC_SHELL_MODEL_ITEMS_VARIANT_TYPE);
+  guint i;
+
+  g_return_val_if_fail (CC_IS_SHELL_MODEL (model), NULL);
 
-      valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (model), &iter);
+  for (i = 0; i < model->entries->len; i++)
+    {
+      SearchEntry *entry = g_ptr_array_index (model->entries, i);
+      g_autoptr(GVariant) icon_variant = NULL;
+      g_autoptr(GIcon) icon = NULL;
+      g_autofree gchar *app_id = NULL;
+      g_autofree gchar *name = NULL;
+      g_autofree gchar *description = NULL;
+      CcPanelCategory category;
+      gboolean has_sidebar;
+
+      gtk_tree_model_get (GTK_TREE_MODEL (model), &entry->iter,
+                          COL_APP_ID, &app_id,
+                          COL_CATEGORY, &category,
+                          COL_NAME, &name,
+                          COL_DESCRIPTION, &description,
+                          COL_GICON, &icon,
+                          COL_HAS_SIDEBAR, &has_sidebar,
+                          -1);
+
+      icon_variant = g_icon_serialize (icon);
+      if (!icon_variant)
+        return NULL;
+
+      g_variant_builder_add (&builder, "(ssussmsmsv^asb)",
+                             entry->id,
+                             app_id,
+                             (guint32) category,
+                             name,
+                             entry->casefolded_name,
+                             description,
+                             entry->casefolded_description,
+                             icon_variant,
+                             entry->keywords,
+                             has_sidebar);
     }
 
-  return FALSE;
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+gboolean
+cc_shell_model_has_panel (CcShellModel *model,
+                          const char   *id)
+{
+  g_assert (id);
+
+  return g_hash_table_contains (model->id_to_entry, id);
 }
 
 gboolean
@@ -338,42 +626,98 @@ cc_shell_model_iter_matches_search (CcShellModel *model,
                                     GtkTreeIter  *iter,
                                     const char   *term)
 {
-  g_autofree gchar *name = NULL;
-  g_autofree gchar *description = NULL;
-  gboolean result;
-  g_auto(GStrv) keywords = NULL;
+  SearchEntry *entry;
+
+  g_return_val_if_fail (CC_IS_SHELL_MODEL (model), FALSE);
 
-  gtk_tree_model_get (GTK_TREE_MODEL (model), iter,
-                      COL_CASEFOLDED_NAME, &name,
-                      COL_CASEFOLDED_DESCRIPTION, &description,
-                      COL_KEYWORDS, &keywords,
-                      -1);
+  entry = lookup_entry_for_iter (model, iter);
+  g_return_val_if_fail (entry != NULL, FALSE);
 
-  result = (strstr (name, term) != NULL);
+  return search_entry_matches (model, entry, term);
+}
 
-  if (!result && description)
-    result = (strstr (description, term) != NULL);
+/**
+ * cc_shell_model_panel_matches_search:
+ * @model: a #CcShellModel
+ * @id: the id of the panel
+ * @term: a term normalized with cc_util_normalize_casefold_and_unaccent()
+ *
+ * Same as cc_shell_model_iter_matches_search(), but looks the panel up
+ * by its id. Neither function copies any row data.
+ *
+ * Returns: %TRUE if the panel matches @term
+ */
+gboolean
+cc_shell_model_panel_matches_search (CcShellModel *model,
+                                     const char   *id,
+                                     const char   *term)
+{
+  SearchEntry *entry;
 
-  if (!result && keywords)
-    {
-      gint i;
+  g_return_val_if_fail (CC_IS_SHELL_MODEL (model), FALSE);
 
-      for (i = 0; !result && keywords[i]; i++)
-        result = (strstr (keywords[i], term) == keywords[i]);
-    }
+  entry = g_hash_table_lookup (model->id_to_entry, id);
+  if (!entry)
+    return FALSE;
+
+  return search_entry_matches (model, entry, term);
+}
+
+gconstpointer
+cc_shell_model_iter_get_search_entry (CcShellModel *model,
+                                      GtkTreeIter  *iter)
+{
+  g_return_val_if_fail (CC_IS_SHELL_MODEL (model), NULL);
+
+  return lookup_entry_for_iter (model, iter);
+}
+
+/**
+ * cc_shell_model_iter_get_sort_key:
+ * @model: a #CcShellModel
+ * @iter: a #GtkTreeIter pointing to a row of @model
+ * @terms: (nullable): terms normalized with cc_util_normalize_casefold_and_unaccent()
+ *
+ * Computes a key that orders the rows the same way the model sorts
+ * them for @terms: a row with a lower key comes first. This lets a
+ * subset of the rows be ranked without re-sorting the whole model.
+ *
+ * Returns: the sort key of the row
+ */
+guint64
+cc_shell_model_iter_get_sort_key (CcShellModel  *model,
+                                  GtkTreeIter   *iter,
+                                  gchar        **terms)
+{
+  SearchEntry *entry;
+
+  g_return_val_if_fail (CC_IS_SHELL_MODEL (model), G_MAXUINT64);
+
+  entry = lookup_entry_for_iter (model, iter);
+  g_return_val_if_fail (entry != NULL, G_MAXUINT64);
+
+  ensure_name_ranks (model);
 
-  return result;
+  return search_entry_get_sort_key (entry, terms);
 }
 
 void
 cc_shell_model_set_sort_terms (CcShellModel  *self,
                                gchar        **terms)
 {
+  guint i;
+
   g_return_if_fail (CC_IS_SHELL_MODEL (self));
 
   g_clear_pointer (&self->sort_terms, g_strfreev);
   self->sort_terms = g_strdupv (terms);
 
+  for (i = 0; i < self->entries->len; i++)
+    {
+      SearchEntry *entry = g_ptr_array_index (self->entries, i);
+      entry->score = search_entry_get_score (entry, self->sort_terms);
+    }
+
   /* trigger a re-sort */
   gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (self),
                                            cc_shell_model_sort_func,
@@ -386,37 +730,16 @@ cc_shell_model_set_panel_visibility (CcShellModel      *self,
                                      const gchar       *id,
                                      CcPanelVisibility  visibility)
 {
-  GtkTreeModel *model;
-  GtkTreeIter iter;
-  gboolean valid;
+  SearchEntry *entry;
 
   g_return_if_fail (CC_IS_SHELL_MODEL (self));
 
-  model = GTK_TREE_MODEL (self);
-
-  /* Find the iter for the panel with the given id */
-  valid = gtk_tree_model_get_iter_first (model, &iter);
-
-  while (valid)
-    {
-      g_autofree gchar *item_id = NULL;
-
-      gtk_tree_model_get (model, &iter, COL_ID, &item_id, -1);
-
-      /* Found the iter */
-      if (g_str_equal (id, item_id))
-        break;
-
-      /* If not found, continue */
-      valid = gtk_tree_model_iter_next (model, &iter);
-    }
+  entry = g_hash_table_lookup (self->id_to_entry, id);
 
-  /* If we don't find any panel with the given id, we'll iterate until
-   * valid == FALSE, so we can use this variable to determine if the
-   * panel was found or not. It is a programming error to try to set
-   * the visibility of a non-existant panel.
+  /* It is a programming error to try to set the visibility of a
+   * non-existant panel.
    */
-  g_assert (valid);
+  g_assert (entry != NULL);
 
-  gtk_list_store_set (GTK_LIST_STORE (self), &iter, COL_VISIBILITY, visibility, -1);
+  gtk_list_store_set (GTK_LIST_STORE (self), &entry->iter, COL_VISIBILITY, visibility, -1);
 }
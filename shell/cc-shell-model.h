@@ -46,7 +46,7 @@ enum
 {
   COL_NAME,
   COL_CASEFOLDED_NAME,
-  COL_APP,
+  COL_APP_ID,
   COL_ID,
   COL_CATEGORY,
   COL_DESCRIPTION,
@@ -59,6 +59,11 @@ enum
   N_COLS
 };
 
+/* id, app id, category, name, casefolded name, description,
+ * casefolded description, serialized icon, casefolded keywords
+ * and whether the panel has a sidebar.
+ */
+#define CC_SHELL_MODEL_ITEMS_VARIANT_TYPE G_VARIANT_TYPE ("a(ssussmsmsvasb)")
 
 CcShellModel* cc_shell_model_new                 (void);
 
@@ -67,6 +72,11 @@ void          cc_shell_model_add_item            (CcShellModel       *model,
                                                   GAppInfo           *appinfo,
                                                   const char         *id);
 
+void          cc_shell_model_add_items_from_variant (CcShellModel   *model,
+                                                     GVariant       *items);
+
+GVariant*     cc_shell_model_to_variant          (CcShellModel       *model);
+
 gboolean      cc_shell_model_has_panel           (CcShellModel       *model,
                                                   const char         *id);
 
@@ -74,6 +84,14 @@ gboolean      cc_shell_model_iter_matches_search (CcShellModel       *model,
                                                   GtkTreeIter        *iter,
                                                   const char         *term);
 
+gboolean      cc_shell_model_panel_matches_search (CcShellModel      *model,
+                                                   const char        *id,
+                                                   const char        *term);
+
+guint64       cc_shell_model_iter_get_sort_key    (CcShellModel      *model,
+                                                   GtkTreeIter       *iter,
+                                                   GStrv              terms);
+
 void          cc_shell_model_set_sort_terms       (CcShellModel      *model,
                                                    GStrv              terms);
 
@@ -330,6 +330,7 @@ setup_model (CcWindow *self)
   model = GTK_TREE_MODEL (self->store);
 
   cc_panel_loader_fill_model (self->store);
+  cc_panel_list_set_model (self->panel_list, self->store);
 
   /* Create a row for each panel */
   valid = gtk_tree_model_get_iter_first (model, &iter);
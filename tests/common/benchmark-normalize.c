@@ -0,0 +1,101 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Compares how long cc_util_normalize_casefold_and_unaccent() and the
+ * implementation it replaced take over every assigned code point and
+ * random mixes of ASCII and other text. test-normalize checks that both
+ * give the same results. */
+
+#include <config.h>
+
+#include <glib.h>
+
+#include "benchmark-utils.h"
+#include "cc-util.h"
+#include "normalize-corpus.h"
+
+static gint iterations = 3;
+
+static gdouble
+time_normalizing (GPtrArray *strings,
+		  gchar *  (*normalize) (const gchar *str))
+{
+	g_autoptr(GTimer) timer = g_timer_new ();
+	guint i;
+	gint n;
+
+	for (n = 0; n < iterations; n++)
+		for (i = 0; i < strings->len; i++)
+			g_free (normalize (g_ptr_array_index (strings, i)));
+
+	return g_timer_elapsed (timer, NULL);
+}
+
+static gdouble
+time_normalizing_to_buffer (GPtrArray *strings)
+{
+	g_autoptr(GString) buffer = g_string_new (NULL);
+	g_autoptr(GTimer) timer = g_timer_new ();
+	guint i;
+	gint n;
+
+	for (n = 0; n < iterations; n++)
+		for (i = 0; i < strings->len; i++)
+			cc_util_normalize_casefold_and_unaccent_to_buffer (g_ptr_array_index (strings, i), buffer);
+
+	return g_timer_elapsed (timer, NULL);
+}
+
+static void
+print_times (const gchar *title,
+	     GPtrArray   *strings)
+{
+	gdouble calls = (gdouble) strings->len * iterations;
+
+	g_print ("%s (%u strings)\n", title, strings->len);
+	g_print ("  previous implementation: %.3f µs per string\n",
+		 time_normalizing (strings, normalize_reference) * G_USEC_PER_SEC / calls);
+	g_print ("  new implementation:      %.3f µs per string\n",
+		 time_normalizing (strings, cc_util_normalize_casefold_and_unaccent) * G_USEC_PER_SEC / calls);
+	g_print ("  into a reused buffer:    %.3f µs per string\n",
+		 time_normalizing_to_buffer (strings) * G_USEC_PER_SEC / calls);
+}
+
+int main (int argc, char **argv)
+{
+	g_autoptr(GPtrArray) corpus = NULL;
+	g_autoptr(GPtrArray) ascii = NULL;
+	guint i;
+
+	if (!benchmark_init (&argc, &argv, "- benchmark the search normalization", &iterations))
+		return 1;
+
+	corpus = normalize_corpus_new ();
+	ascii = g_ptr_array_new ();
+
+	for (i = 0; i < corpus->len; i++) {
+		const gchar *str = g_ptr_array_index (corpus, i);
+
+		if (g_str_is_ascii (str))
+			g_ptr_array_add (ascii, (gpointer) str);
+	}
+
+	print_times ("All strings", corpus);
+	print_times ("ASCII strings", ascii);
+
+	return 0;
+}
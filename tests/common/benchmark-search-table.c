@@ -0,0 +1,84 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Types searches into the strings of the language chooser, one
+ * character at a time, and compares normalizing the strings of every
+ * row on each keystroke with looking them up in a CcSearchTable.
+ * test-search-table checks that both find the same rows. */
+
+#include <config.h>
+
+#include <glib.h>
+
+#include "benchmark-utils.h"
+#include "search-table-corpus.h"
+
+int main (int argc, char **argv)
+{
+	g_autoptr(GPtrArray) rows = NULL;
+	g_autoptr(CcSearchTable) table = NULL;
+	g_autoptr(GTimer) timer = NULL;
+	gdouble normalizing_time = 0.0;
+	gdouble table_time = 0.0;
+	gint iterations = 20;
+	guint keystrokes = 0;
+	guint i;
+	gint n;
+
+	if (!benchmark_init (&argc, &argv, "- benchmark searching the language chooser", &iterations))
+		return 1;
+
+	rows = search_table_corpus_new ();
+	table = cc_search_table_new ();
+
+	timer = g_timer_new ();
+	search_table_corpus_index (rows, table);
+	g_print ("Indexed %u rows in %.3f ms\n", rows->len,
+		 g_timer_elapsed (timer, NULL) * 1000);
+
+	for (n = 0; n < iterations; n++) {
+		for (i = 0; search_table_searches[i] != NULL; i++) {
+			const gchar *search = search_table_searches[i];
+			const gchar *end;
+
+			/* Every prefix of the search, as it is typed */
+			for (end = g_utf8_next_char (search); ; end = g_utf8_next_char (end)) {
+				g_autofree gchar *text = g_strndup (search, end - search);
+
+				g_timer_start (timer);
+				search_table_corpus_count_matches (rows, text);
+				normalizing_time += g_timer_elapsed (timer, NULL);
+
+				g_timer_start (timer);
+				g_hash_table_unref (cc_search_table_match (table, text));
+				table_time += g_timer_elapsed (timer, NULL);
+
+				keystrokes++;
+				if (*end == '\0')
+					break;
+			}
+		}
+	}
+
+	g_print ("%u keystrokes over %u rows\n", keystrokes, rows->len);
+	g_print ("  normalizing every row: %.2f µs per keystroke\n",
+		 normalizing_time * G_USEC_PER_SEC / keystrokes);
+	g_print ("  search table:          %.2f µs per keystroke\n",
+		 table_time * G_USEC_PER_SEC / keystrokes);
+
+	return 0;
+}
@@ -0,0 +1,54 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <locale.h>
+
+#include "benchmark-utils.h"
+
+/* Sets the locale and parses the command line options shared by the
+ * benchmarks. @iterations holds the default, and is set to the number
+ * of iterations asked for, at least one. Returns FALSE, after printing
+ * why, if the options could not be parsed. */
+gboolean
+benchmark_init (int          *argc,
+		char       ***argv,
+		const gchar  *parameter_string,
+		gint         *iterations)
+{
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(GError) error = NULL;
+	GOptionEntry entries[] = {
+		{ "iterations", 'n', 0, G_OPTION_ARG_INT, iterations, "Number of iterations", "N" },
+		{ NULL }
+	};
+
+	setlocale (LC_ALL, "");
+
+	context = g_option_context_new (parameter_string);
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, argc, argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return FALSE;
+	}
+
+	if (*iterations < 1)
+		*iterations = 1;
+
+	return TRUE;
+}
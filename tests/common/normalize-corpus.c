@@ -0,0 +1,175 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Strings to normalize: sample names, every assigned code point, and
+ * random mixes of ASCII and other text. Also the implementation that
+ * cc_util_normalize_casefold_and_unaccent() replaced, to compare with. */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "normalize-corpus.h"
+
+#define RANDOM_SEED 42
+#define N_RANDOM_STRINGS 20000
+#define MAX_RANDOM_LENGTH 40
+
+static const gchar *samples[] = {
+	"",
+	"English (United States)",
+	"KEYBOARD shortcuts 123 !@#$%^&*()_+-=[]{};':\",./<>?`~|\\",
+	"Français (Canada)",
+	"Deutsch (Schweiz) — Straße",
+	"Português (Brasil)",
+	"Norsk bokmål",
+	"Türkçe İstanbul ıI",
+	"Ελληνικά ΣΊΣΥΦΟΣ",
+	"Русский язык",
+	"中文 (简体)",
+	"日本語 ｶﾀｶﾅ ＦＵＬＬＷＩＤＴＨ",
+	"한국어 조선말",
+	"עִבְרִית",
+	"العربية",
+	"हिन्दी",
+	"ﬁﬂ ﬀ Å K Ω ǅ",
+	"soft\302\255hyphen",
+	"e\314\201 a\314\200\314\201 o\314\210\315\205",
+	"\314\201leading mark",
+	"✈ Emoji 👍🏽 👨‍👩‍👧",
+	"Tab\tand\nnewline\001control",
+};
+
+#define IS_CDM_UCS4(c) (((c) >= 0x0300 && (c) <= 0x036F)  || \
+			((c) >= 0x1DC0 && (c) <= 0x1DFF)  || \
+			((c) >= 0x20D0 && (c) <= 0x20FF)  || \
+			((c) >= 0xFE20 && (c) <= 0xFE2F))
+
+#define IS_SOFT_HYPHEN(c) ((c) == 0x00AD)
+
+/* The previous implementation, which normalized and casefolded the whole
+ * string before stripping the marks in place */
+gchar *
+normalize_reference (const gchar *str)
+{
+	g_autofree gchar *normalized = NULL;
+	gchar *tmp;
+	int i = 0, j = 0, ilen;
+
+	if (str == NULL)
+		return NULL;
+
+	normalized = g_utf8_normalize (str, -1, G_NORMALIZE_NFKD);
+	tmp = g_utf8_casefold (normalized, -1);
+
+	ilen = strlen (tmp);
+
+	while (i < ilen) {
+		gunichar unichar;
+		gchar *next_utf8;
+		gint utf8_len;
+
+		unichar = g_utf8_get_char_validated (&tmp[i], -1);
+		if (unichar == (gunichar) -1 ||
+		    unichar == (gunichar) -2)
+			break;
+
+		next_utf8 = g_utf8_next_char (&tmp[i]);
+		utf8_len = next_utf8 - &tmp[i];
+
+		if (IS_CDM_UCS4 (unichar) || IS_SOFT_HYPHEN (unichar)) {
+			i += utf8_len;
+			continue;
+		}
+
+		if (i != j)
+			memmove (&tmp[j], &tmp[i], utf8_len);
+
+		i += utf8_len;
+		j += utf8_len;
+	}
+
+	tmp[j] = '\0';
+
+	return tmp;
+}
+
+static void
+add_code_points (GPtrArray *corpus,
+		 GArray    *pool)
+{
+	gunichar c;
+
+	for (c = 1; c <= 0x10FFFF; c++) {
+		gchar buf[8] = { 0 };
+
+		if (!g_unichar_validate (c) || !g_unichar_isdefined (c))
+			continue;
+
+		g_unichar_to_utf8 (c, buf);
+
+		/* On its own, and between ASCII letters it could combine with */
+		g_ptr_array_add (corpus, g_strdup (buf));
+		g_ptr_array_add (corpus, g_strdup_printf ("Ab%sCd", buf));
+		g_ptr_array_add (corpus, g_strdup_printf ("E%s\314\201%sz", buf, buf));
+
+		if (c >= 0x80)
+			g_array_append_val (pool, c);
+	}
+}
+
+static void
+add_random_strings (GPtrArray *corpus,
+		    GArray    *pool)
+{
+	g_autoptr(GRand) rand = g_rand_new_with_seed (RANDOM_SEED);
+	gint i, j;
+
+	for (i = 0; i < N_RANDOM_STRINGS; i++) {
+		GString *string = g_string_new (NULL);
+		gint length = g_rand_int_range (rand, 1, MAX_RANDOM_LENGTH);
+
+		for (j = 0; j < length; j++) {
+			/* Mostly ASCII, like the names we search */
+			if (g_rand_int_range (rand, 0, 4) > 0)
+				g_string_append_c (string, g_rand_int_range (rand, 1, 0x80));
+			else
+				g_string_append_unichar (string, g_array_index (pool, gunichar,
+										g_rand_int_range (rand, 0, pool->len)));
+		}
+
+		g_ptr_array_add (corpus, g_string_free (string, FALSE));
+	}
+}
+
+GPtrArray *
+normalize_corpus_new (void)
+{
+	g_autoptr(GArray) pool = NULL;
+	GPtrArray *corpus;
+	guint i;
+
+	corpus = g_ptr_array_new_with_free_func (g_free);
+	pool = g_array_new (FALSE, FALSE, sizeof (gunichar));
+
+	for (i = 0; i < G_N_ELEMENTS (samples); i++)
+		g_ptr_array_add (corpus, g_strdup (samples[i]));
+	add_code_points (corpus, pool);
+	add_random_strings (corpus, pool);
+
+	return corpus;
+}
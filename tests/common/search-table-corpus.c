@@ -0,0 +1,139 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* The strings of the rows of the language chooser, and what its filter
+ * function used to do with them before CcSearchTable */
+
+#include <config.h>
+
+#include <string.h>
+
+#define GNOME_DESKTOP_USE_UNSTABLE_API
+#include <libgnome-desktop/gnome-languages.h>
+
+#include "cc-util.h"
+#include "search-table-corpus.h"
+
+#define N_ROW_STRINGS 4
+
+const gchar *search_table_searches[] = {
+	"english united states",
+	"français",
+	"deutsch schweiz",
+	"português",
+	"中文",
+	"norsk bokmål",
+	"xyz",
+	NULL
+};
+
+static void
+free_row (gchar **strings)
+{
+	gint i;
+
+	for (i = 0; i < N_ROW_STRINGS; i++)
+		g_free (strings[i]);
+	g_free (strings);
+}
+
+/* The names of every locale, in itself and in the current locale */
+GPtrArray *
+search_table_corpus_new (void)
+{
+	g_auto(GStrv) locales = NULL;
+	GPtrArray *rows;
+	guint i;
+
+	rows = g_ptr_array_new_with_free_func ((GDestroyNotify) free_row);
+
+	locales = gnome_get_all_locales ();
+	for (i = 0; locales[i] != NULL; i++) {
+		g_autofree gchar *language_code = NULL;
+		g_autofree gchar *country_code = NULL;
+		gchar **strings;
+
+		if (!gnome_parse_locale (locales[i], &language_code, &country_code, NULL, NULL))
+			continue;
+
+		strings = g_new0 (gchar *, N_ROW_STRINGS);
+		strings[0] = gnome_get_language_from_code (language_code, locales[i]);
+		strings[1] = gnome_get_country_from_code (country_code, locales[i]);
+		strings[2] = gnome_get_language_from_code (language_code, NULL);
+		strings[3] = gnome_get_country_from_code (country_code, NULL);
+
+		g_ptr_array_add (rows, strings);
+	}
+
+	return rows;
+}
+
+void
+search_table_corpus_index (GPtrArray     *rows,
+			   CcSearchTable *table)
+{
+	guint i;
+
+	for (i = 0; i < rows->len; i++)
+		cc_search_table_add (table, GUINT_TO_POINTER (i + 1),
+				     g_ptr_array_index (rows, i), N_ROW_STRINGS);
+}
+
+static gboolean
+match_all (gchar       **words,
+	   const gchar  *str)
+{
+	gchar **w;
+
+	if (str == NULL)
+		return FALSE;
+
+	for (w = words; *w; ++w)
+		if (!strstr (str, *w))
+			return FALSE;
+
+	return TRUE;
+}
+
+/* Normalizes the strings of every row, as the filter function did */
+guint
+search_table_corpus_count_matches (GPtrArray   *rows,
+				   const gchar *text)
+{
+	g_autofree gchar *normalized = NULL;
+	g_auto(GStrv) words = NULL;
+	guint i, j, count = 0;
+
+	normalized = cc_util_normalize_casefold_and_unaccent (text);
+	words = g_strsplit_set (g_strstrip (normalized), " ", 0);
+
+	for (i = 0; i < rows->len; i++) {
+		gchar **strings = g_ptr_array_index (rows, i);
+
+		for (j = 0; j < N_ROW_STRINGS; j++) {
+			g_autofree gchar *row_string = NULL;
+
+			row_string = cc_util_normalize_casefold_and_unaccent (strings[j]);
+			if (match_all (words, row_string)) {
+				count++;
+				break;
+			}
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,37 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "cc-search-table.h"
+
+G_BEGIN_DECLS
+
+/* Searches typed into the language chooser */
+extern const gchar *search_table_searches[];
+
+GPtrArray *search_table_corpus_new           (void);
+
+void       search_table_corpus_index         (GPtrArray     *rows,
+					      CcSearchTable *table);
+
+guint      search_table_corpus_count_matches (GPtrArray     *rows,
+					      const gchar   *text);
+
+G_END_DECLS
@@ -0,0 +1,59 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <locale.h>
+
+#include "cc-util.h"
+#include "normalize-corpus.h"
+
+/* cc_util_normalize_casefold_and_unaccent() has to give the same results
+ * as the implementation it replaced, with or without a reused buffer */
+static void
+test_normalize_corpus (void)
+{
+	g_autoptr(GPtrArray) corpus = NULL;
+	g_autoptr(GString) buffer = NULL;
+	guint i;
+
+	corpus = normalize_corpus_new ();
+	buffer = g_string_new (NULL);
+
+	for (i = 0; i < corpus->len; i++) {
+		const gchar *str = g_ptr_array_index (corpus, i);
+		g_autofree gchar *expected = NULL;
+		g_autofree gchar *result = NULL;
+
+		expected = normalize_reference (str);
+		result = cc_util_normalize_casefold_and_unaccent (str);
+
+		g_assert_cmpstr (result, ==, expected);
+		g_assert_cmpstr (cc_util_normalize_casefold_and_unaccent_to_buffer (str, buffer), ==, expected);
+	}
+}
+
+int main (int argc, char **argv)
+{
+	setlocale (LC_ALL, "");
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/common/normalize/corpus", test_normalize_corpus);
+
+	return g_test_run ();
+}
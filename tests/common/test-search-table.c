@@ -0,0 +1,74 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <locale.h>
+
+#include "search-table-corpus.h"
+
+static guint
+count_matches_in_table (CcSearchTable *table,
+			const gchar   *text)
+{
+	g_autoptr(GHashTable) matches = NULL;
+
+	matches = cc_search_table_match (table, text);
+
+	return g_hash_table_size (matches);
+}
+
+/* Every prefix of the searches, as they are typed, has to match the
+ * same rows as normalizing the strings of every row did */
+static void
+test_search_table_matches (void)
+{
+	g_autoptr(CcSearchTable) table = NULL;
+	g_autoptr(GPtrArray) rows = NULL;
+	guint i;
+
+	rows = search_table_corpus_new ();
+	table = cc_search_table_new ();
+	search_table_corpus_index (rows, table);
+
+	for (i = 0; search_table_searches[i] != NULL; i++) {
+		const gchar *search = search_table_searches[i];
+		const gchar *end;
+
+		for (end = g_utf8_next_char (search); ; end = g_utf8_next_char (end)) {
+			g_autofree gchar *text = g_strndup (search, end - search);
+
+			g_test_message ("Searching '%s'", text);
+			g_assert_cmpuint (count_matches_in_table (table, text), ==,
+					  search_table_corpus_count_matches (rows, text));
+
+			if (*end == '\0')
+				break;
+		}
+	}
+}
+
+int main (int argc, char **argv)
+{
+	setlocale (LC_ALL, "");
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/common/search-table/matches", test_search_table_matches);
+
+	return g_test_run ();
+}
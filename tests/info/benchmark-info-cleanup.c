@@ -0,0 +1,76 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Runs info_cleanup() over a corpus of hardware strings, one per line,
+ * and prints how long it took. Only the text before the first tab is
+ * used, so the test corpus can be passed as is, which is the default. */
+
+#include <config.h>
+
+#include <glib.h>
+#include <string.h>
+#include "benchmark-utils.h"
+#include "info-cleanup.h"
+
+int main (int argc, char **argv)
+{
+	g_autoptr(GPtrArray) corpus = NULL;
+	g_autoptr(GTimer) timer = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *contents = NULL;
+	g_auto(GStrv) lines = NULL;
+	const gchar *filename;
+	gint iterations = 10000;
+	gdouble elapsed;
+	guint i;
+	gint n;
+
+	if (!benchmark_init (&argc, &argv, "[FILE] - benchmark info_cleanup()", &iterations))
+		return 1;
+
+	filename = argc > 1 ? argv[1] : TEST_SRCDIR "/info-cleanup-test.txt";
+	if (!g_file_get_contents (filename, &contents, NULL, &error)) {
+		g_printerr ("Failed to load '%s': %s\n", filename, error->message);
+		return 1;
+	}
+
+	corpus = g_ptr_array_new_with_free_func (g_free);
+	lines = g_strsplit (contents, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		if (*lines[i] == '#' || *lines[i] == '\0')
+			continue;
+		g_ptr_array_add (corpus, g_strndup (lines[i], strcspn (lines[i], "\t")));
+	}
+
+	if (corpus->len == 0) {
+		g_printerr ("No strings in '%s'\n", filename);
+		return 1;
+	}
+
+	timer = g_timer_new ();
+	for (n = 0; n < iterations; n++) {
+		for (i = 0; i < corpus->len; i++)
+			g_free (info_cleanup (g_ptr_array_index (corpus, i)));
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	g_print ("%u strings × %d runs in %.3f s, %.2f µs per string\n",
+		 corpus->len, iterations, elapsed,
+		 elapsed * G_USEC_PER_SEC / ((gdouble) corpus->len * iterations));
+
+	return 0;
+}
@@ -0,0 +1,256 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2020 The GNOME Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <gio/gdesktopappinfo.h>
+#include <string.h>
+
+#include "cc-shell-model.h"
+#include "cc-shell-model-private.h"
+
+#define N_PANELS 500
+#define N_RESORTS 20
+
+static const gchar *words[] = {
+  "wi-fi", "network", "bluetooth", "background", "notifications",
+  "search", "sharing", "sound", "power", "displays", "mouse",
+  "keyboard", "printers", "color", "region", "accessibility",
+};
+
+static GAppInfo *
+create_app_info (guint i)
+{
+  g_autoptr(GKeyFile) keyfile = NULL;
+  g_autofree gchar *name = NULL;
+  g_autofree gchar *description = NULL;
+  g_autofree gchar *keywords = NULL;
+  const gchar *word = words[i % G_N_ELEMENTS (words)];
+  const gchar *other = words[(i / G_N_ELEMENTS (words)) % G_N_ELEMENTS (words)];
+
+  name = g_strdup_printf ("%s %u", word, i);
+  description = g_strdup_printf ("Change %s and %s settings", word, other);
+  keywords = g_strdup_printf ("%s;%s;panel%u;", other, word, i);
+
+  keyfile = g_key_file_new ();
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP,
+                         G_KEY_FILE_DESKTOP_KEY_TYPE, G_KEY_FILE_DESKTOP_TYPE_APPLICATION);
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_NAME, name);
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_COMMENT, description);
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_EXEC, "true");
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_ICON, "preferences-system");
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP, "Keywords", keywords);
+
+  return G_APP_INFO (g_desktop_app_info_new_from_keyfile (keyfile));
+}
+
+static CcShellModel *
+create_model (void)
+{
+  CcShellModel *model;
+  guint i;
+
+  model = cc_shell_model_new ();
+
+  for (i = 0; i < N_PANELS; i++)
+    {
+      g_autoptr(GAppInfo) appinfo = create_app_info (i);
+      g_autofree gchar *id = g_strdup_printf ("panel%u", i);
+
+      g_assert_nonnull (appinfo);
+      cc_shell_model_add_item (model, CC_CATEGORY_HARDWARE, appinfo, id);
+    }
+
+  return model;
+}
+
+static void
+test_sort_order (void)
+{
+  g_autoptr(CcShellModel) model = create_model ();
+  g_autofree gchar *previous = NULL;
+  gchar *terms[] = { (gchar *) "sound", NULL };
+  GtkTreeModel *tree_model = GTK_TREE_MODEL (model);
+  GtkTreeIter iter;
+  gboolean name_matches = TRUE;
+  gboolean valid;
+
+  /* Without terms, rows are sorted by name */
+  valid = gtk_tree_model_get_iter_first (tree_model, &iter);
+  while (valid)
+    {
+      g_autofree gchar *name = NULL;
+
+      gtk_tree_model_get (tree_model, &iter, COL_CASEFOLDED_NAME, &name, -1);
+      g_assert_cmpint (g_strcmp0 (previous, name), <=, 0);
+
+      g_free (previous);
+      previous = g_steal_pointer (&name);
+
+      valid = gtk_tree_model_iter_next (tree_model, &iter);
+    }
+
+  /* Rows whose name matches come before all the others */
+  cc_shell_model_set_sort_terms (model, terms);
+
+  valid = gtk_tree_model_get_iter_first (tree_model, &iter);
+  while (valid)
+    {
+      g_autofree gchar *name = NULL;
+
+      gtk_tree_model_get (tree_model, &iter, COL_CASEFOLDED_NAME, &name, -1);
+
+      if (strstr (name, terms[0]) == NULL)
+        name_matches = FALSE;
+      else
+        g_assert_true (name_matches);
+
+      valid = gtk_tree_model_iter_next (tree_model, &iter);
+    }
+}
+
+/* What matching a row used to do, from the values of the row */
+static gboolean
+row_matches (GtkTreeModel *tree_model,
+             GtkTreeIter  *iter,
+             const gchar  *term)
+{
+  g_autofree gchar *name = NULL;
+  g_autofree gchar *description = NULL;
+  g_auto(GStrv) keywords = NULL;
+  guint i;
+
+  gtk_tree_model_get (tree_model, iter,
+                      COL_CASEFOLDED_NAME, &name,
+                      COL_CASEFOLDED_DESCRIPTION, &description,
+                      COL_KEYWORDS, &keywords,
+                      -1);
+
+  if (strstr (name, term) != NULL)
+    return TRUE;
+
+  if (description && strstr (description, term) != NULL)
+    return TRUE;
+
+  for (i = 0; keywords[i]; i++)
+    {
+      if (g_str_has_prefix (keywords[i], term))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Returns the search data of every row, by id */
+static GHashTable *
+check_rows (CcShellModel  *model,
+            gchar        **terms)
+{
+  GtkTreeModel *tree_model = GTK_TREE_MODEL (model);
+  GHashTable *entries;
+  GtkTreeIter iter;
+  guint64 previous_key = 0;
+  gboolean valid;
+
+  entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  valid = gtk_tree_model_get_iter_first (tree_model, &iter);
+  while (valid)
+    {
+      g_autofree gchar *id = NULL;
+      guint64 key;
+      guint i;
+
+      gtk_tree_model_get (tree_model, &iter, COL_ID, &id, -1);
+
+      /* The rows are in the order of their sort keys, which are unique
+       * since the names are */
+      key = cc_shell_model_iter_get_sort_key (model, &iter, terms);
+      if (g_hash_table_size (entries) > 0)
+        g_assert_cmpuint (previous_key, <, key);
+      previous_key = key;
+
+      for (i = 0; terms[i]; i++)
+        {
+          g_assert_cmpint (cc_shell_model_iter_matches_search (model, &iter, terms[i]), ==,
+                           row_matches (tree_model, &iter, terms[i]));
+          g_assert_cmpint (cc_shell_model_panel_matches_search (model, id, terms[i]), ==,
+                           row_matches (tree_model, &iter, terms[i]));
+        }
+
+      g_assert_nonnull (cc_shell_model_iter_get_search_entry (model, &iter));
+      g_hash_table_insert (entries,
+                           g_steal_pointer (&id),
+                           (gpointer) cc_shell_model_iter_get_search_entry (model, &iter));
+
+      valid = gtk_tree_model_iter_next (tree_model, &iter);
+    }
+
+  g_assert_cmpuint (g_hash_table_size (entries), ==, N_PANELS);
+
+  return entries;
+}
+
+static void
+test_resort (void)
+{
+  g_autoptr(CcShellModel) model = create_model ();
+  g_autoptr(GHashTable) initial_entries = NULL;
+  gchar *no_terms[] = { NULL };
+  gchar *terms[] = { NULL, NULL, NULL };
+  guint i;
+
+  initial_entries = check_rows (model, no_terms);
+
+  for (i = 0; i < N_RESORTS; i++)
+    {
+      g_autoptr(GHashTable) entries = NULL;
+      GHashTableIter iter;
+      gpointer id, entry;
+
+      terms[0] = (gchar *) words[i % G_N_ELEMENTS (words)];
+      terms[1] = i % 2 ? (gchar *) "settings" : NULL;
+
+      cc_shell_model_set_sort_terms (model, terms);
+
+      /* The search data of each row is made once, when it is added,
+       * and sorting only rescores it */
+      entries = check_rows (model, terms);
+
+      g_hash_table_iter_init (&iter, entries);
+      while (g_hash_table_iter_next (&iter, &id, &entry))
+        g_assert_true (g_hash_table_lookup (initial_entries, id) == entry);
+    }
+
+  /* Going back to no terms sorts the rows by name again */
+  cc_shell_model_set_sort_terms (model, no_terms);
+  g_hash_table_unref (check_rows (model, no_terms));
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/shell/model/sort-order", test_sort_order);
+  g_test_add_func ("/shell/model/resort", test_resort);
+
+  return g_test_run ();
+}